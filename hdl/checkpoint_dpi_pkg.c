@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint (fork based simulation snapshots)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// A checkpoint is a forked copy of the simulator process,
+// parked on a pipe until it is resumed or the simulation ends.
+//
+// Restoring a checkpoint resumes the parked copy, which first forks a new
+// parked copy of itself (so the checkpoint can be restored again),
+// and the process which requested the restore exits.
+// Checkpoints taken after the restored one belong to the abandoned run
+// and are removed.
+//
+// Each checkpoint keeps the write ends of the pipes of older checkpoints,
+// so any later process can resume them. When the last process holding
+// the write end of a pipe exits, the parked copy reads EOF and exits too,
+// so checkpoints are removed in a cascade when the simulation ends.
+//
+// The first process is a child subreaper, it adopts orphaned checkpoints
+// and waits for them, so the shell (make, ...) waits for the whole
+// simulation. Only single threaded simulators can be forked.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+
+#include "svdpi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// maximum number of checkpoints
+#define CHECKPOINT_MAX 256
+
+typedef struct {
+    pid_t     pid;       // parked process
+    int       fd;        // write end of the resume pipe
+    long long position;  // trace position
+    long long time;      // simulation time
+} checkpoint_t;
+
+// checkpoint table
+checkpoint_t checkpoint [CHECKPOINT_MAX];
+int          checkpoint_num = 0;
+
+// first simulator process (child subreaper)
+pid_t checkpoint_root = 0;
+
+// first process becomes a child subreaper
+int checkpoint_init () {
+    if (checkpoint_root)  return 0;
+    checkpoint_root = getpid();
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0) {
+        printf("DPI-C: Checkpoint subreaper setup failed with errno = %0d.\n", errno);
+        perror("DPI-C: prctl:");
+        return -1;
+    }
+    return 0;
+}
+
+// fork a parked copy of the simulator
+// (returns 0 in the running simulation, 1 after the checkpoint was restored, -1 on error)
+int checkpoint_save (long long position, long long time) {
+    int   fd [2];
+    pid_t pid;
+    char  msg;
+
+    if (checkpoint_num >= CHECKPOINT_MAX) {
+        printf("DPI-C: Checkpoint table is full.\n");
+        return -1;
+    }
+    if (checkpoint_init() != 0)  return -1;
+
+    for (int resumed = 0;; resumed = 1) {
+        if (pipe(fd) != 0) {
+            printf("DPI-C: Checkpoint pipe failed with errno = %0d.\n", errno);
+            perror("DPI-C: pipe:");
+            return -1;
+        }
+        // buffered output would be printed by each copy
+        fflush(NULL);
+        pid = fork();
+        if (pid == -1) {
+            printf("DPI-C: Checkpoint fork failed with errno = %0d.\n", errno);
+            perror("DPI-C: fork:");
+            close(fd[0]);
+            close(fd[1]);
+            return -1;
+        }
+        // running simulation
+        if (pid > 0) {
+            close(fd[0]);
+            checkpoint[checkpoint_num] = (checkpoint_t) { pid, fd[1], position, time };
+            checkpoint_num++;
+            return resumed;
+        }
+        // parked copy (waiting for a restore request or EOF)
+        close(fd[1]);
+        msg = 0;
+        while (read(fd[0], &msg, 1) == -1 && errno == EINTR);
+        if (msg != 'r')  _exit(0);
+        close(fd[0]);
+        printf("DPI-C: Restored checkpoint %0d (trace position %lld, time %lld).\n", checkpoint_num, position, time);
+        // fork a new parked copy, this process continues the simulation
+    }
+}
+
+// number of checkpoints
+int checkpoint_count () {
+    return checkpoint_num;
+}
+
+// trace position and simulation time of a checkpoint
+long long checkpoint_position (int n) {
+    return (n >= 0 && n < checkpoint_num) ? checkpoint[n].position : -1;
+}
+
+long long checkpoint_time (int n) {
+    return (n >= 0 && n < checkpoint_num) ? checkpoint[n].time : -1;
+}
+
+// resume checkpoint 'n' and exit (returns -1 on error)
+int checkpoint_restore (int n) {
+    char msg = 'r';
+
+    if (n < 0 || n >= checkpoint_num) {
+        printf("DPI-C: Checkpoint %0d does not exist.\n", n);
+        return -1;
+    }
+    // checkpoints after the restored one belong to the abandoned run
+    for (int i = n+1; i < checkpoint_num; i++) {
+        kill(checkpoint[i].pid, SIGKILL);
+        close(checkpoint[i].fd);
+    }
+    checkpoint_num = n+1;
+    fflush(NULL);
+    if (write(checkpoint[n].fd, &msg, 1) != 1) {
+        printf("DPI-C: Checkpoint %0d restore failed with errno = %0d.\n", n, errno);
+        perror("DPI-C: write:");
+        return -1;
+    }
+    // release the remaining checkpoints and leave the simulation to the resumed copy
+    for (int i = 0; i < checkpoint_num; i++) {
+        close(checkpoint[i].fd);
+    }
+    if (getpid() == checkpoint_root) {
+        // wait for all descendants (orphaned checkpoints are adopted)
+        while (wait(NULL) != -1 || errno == EINTR);
+    }
+    _exit(0);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+// checkpoint (fork based simulation snapshots)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+package checkpoint_dpi_pkg;
+
+    // fork a parked copy of the simulator
+    // (returns 0 in the running simulation, 1 after the checkpoint was restored, -1 on error)
+    import "DPI-C" function int checkpoint_save (
+        input longint position,
+        input longint time
+    );
+
+    // number of checkpoints
+    import "DPI-C" function int checkpoint_count ();
+
+    // trace position and simulation time of a checkpoint
+    import "DPI-C" function longint checkpoint_position (
+        input int n
+    );
+    import "DPI-C" function longint checkpoint_time (
+        input int n
+    );
+
+    // resume checkpoint and exit this simulation (returns -1 on error)
+    import "DPI-C" function int checkpoint_restore (
+        input int n
+    );
+
+endpackage: checkpoint_dpi_pkg
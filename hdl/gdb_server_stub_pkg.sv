@@ -9,6 +9,7 @@
 package gdb_server_stub_pkg;
 
     import socket_dpi_pkg::*;
+    import checkpoint_dpi_pkg::*;
     import gdb_shadow_pkg::*;
 
     // byte dynamic array type for casting to/from string
@@ -50,6 +51,8 @@ package gdb_server_stub_pkg;
             bit extended;     // extended remote mode
             bit register;     // read registers from (0-shadow, 1-DUT)
             bit memory;       // read memory from (0-shadow, 1-DUT)
+            int unsigned checkpoint;  // checkpoint interval in retired instructions (0-disabled)
+            bit restored;     // resumed from a checkpoint (GDB is not waiting for a stop reply)
         } stub_state_t;
 
         localparam stub_state_t STUB_STATE_INIT = '{
@@ -58,7 +61,9 @@ package gdb_server_stub_pkg;
             acknowledge: 1'b1,
             extended: 1'b0,
             register: 1'b0,
-            memory: 1'b0
+            memory: 1'b0,
+            checkpoint: 0,
+            restored: 1'b0
         };
 
         // initialize stub state
@@ -89,7 +94,6 @@ package gdb_server_stub_pkg;
 //          .FLEN   (FLEN),
             // number of all registers
             .GPRN   (GPRN),
-            .CSRN   (CSRN),
             // memory map (shadow memory map)
             .SIZE_T (SIZE_T),
             .MEMN   (MEMN  ),
@@ -137,6 +141,16 @@ package gdb_server_stub_pkg;
             ref retired_t ret
         );
 
+        // instructions retired in a clock cycle, superscalar cores override it
+        // to pack all instructions retired in a cycle (see 'shd.pack')
+        virtual task dut_retire (
+            ref retired_batch_t batch
+        );
+            retired_t ret;
+            dut_step(ret);
+            batch = {shd.pack(ret)};
+        endtask: dut_retire
+
         // TODO: handle PC write errors
         pure virtual task dut_jump (
             input  SIZE_T adr
@@ -377,13 +391,13 @@ package gdb_server_stub_pkg;
             // reason
             case (shd.rsn.ptype)
                 watch, rwatch, awatch: begin
-                    str = {str, $sformatf("%s:%h;", shd.rsn.ptype.name, shd.ret.lsu.adr)};
+                    str = {str, $sformatf("%s:%h;", shd.rsn.ptype.name, shd.reason_addr())};
                 end
                 swbreak, hwbreak: begin
                     str = {str, $sformatf("%s:;", shd.rsn.ptype.name)};
                 end
                 replaylog: begin
-                    str = {str, $sformatf("%s:%s;", shd.rsn.ptype.name, shd.cnt == 0 ? "begin" : "end")};
+                    str = {str, $sformatf("%s:%s;", shd.rsn.ptype.name, shd.count() == 0 ? "begin" : "end")};
                 end
             endcase
             // remove the trailing semicolon
@@ -443,6 +457,7 @@ package gdb_server_stub_pkg;
             input string str
         );
             int status;
+            int num;
 
             case (str)
                 "help": begin
@@ -452,7 +467,11 @@ package gdb_server_stub_pkg;
                                                       "* 'set register=dut/shadow' (reading registers from dut/shadow, default is shadow),\n",
                                                       "* 'set memory=dut/shadow' (reading memories from dut/shadow, default is shadow),\n",
                                                       "* 'reset assert' (assert reset for a few clock periods),\n",
-                                                      "* 'reset release' (synchronously release reset)."});
+                                                      "* 'reset release' (synchronously release reset),\n",
+                                                      "* 'checkpoint interval N' (fork a checkpoint every N retired instructions, 0 disables),\n",
+                                                      "* 'checkpoint save' (fork a checkpoint now),\n",
+                                                      "* 'checkpoint list' (list checkpoints),\n",
+                                                      "* 'checkpoint restore N' (resume DUT simulation from checkpoint N)."});
                 end
                 "set remote log on": begin
                     stub_state.remote_log = 1'b1;
@@ -496,8 +515,35 @@ package gdb_server_stub_pkg;
                     dut_reset_release;
                     status = rsp_query_monitor_reply("DUT reset released.\n");
                 end
+                "checkpoint save": begin
+                    // the resumed copy does not reply (GDB already received the reply to the restore command)
+                    if (rsp_checkpoint_save())  stub_state.restored = 1'b0;
+                    else  status = rsp_query_monitor_reply($sformatf("Saved checkpoint %0d at trace position %0d.\n", checkpoint_count()-1, shd.size()));
+                end
+                "checkpoint list": begin
+                    string lst = "";
+                    for (int i=0; i<checkpoint_count(); i++) begin
+                        lst = {lst, $sformatf("%0d: trace position %0d, time %0t\n", i, checkpoint_position(i), checkpoint_time(i))};
+                    end
+                    status = rsp_query_monitor_reply(checkpoint_count() ? lst : "No checkpoints.\n");
+                end
                 default begin
-                    status = rsp_query_monitor_reply("'monitor' command was not recognized.\n");
+                    if ($sscanf(str, "checkpoint interval %d", num) == 1) begin
+                        stub_state.checkpoint = num;
+                        status = rsp_query_monitor_reply($sformatf("Checkpoint interval set to %0d retired instructions.\n", num));
+                    end else
+                    if ($sscanf(str, "checkpoint restore %d", num) == 1) begin
+                        if (num < 0 || num >= checkpoint_count()) begin
+                            status = rsp_query_monitor_reply($sformatf("Checkpoint %0d does not exist.\n", num));
+                        end else begin
+                            // the simulation continues in the resumed copy (this process exits)
+                            status = rsp_query_monitor_reply($sformatf("Restoring checkpoint %0d at trace position %0d, flush GDB register cache with 'maintenance flush register-cache'.\n", num, checkpoint_position(num)));
+                            status = checkpoint_restore(num);
+                            $error("GDB: restoring checkpoint %0d failed.", num);
+                        end
+                    end else begin
+                        status = rsp_query_monitor_reply("'monitor' command was not recognized.\n");
+                    end
                 end
             endcase
         endtask: rsp_query_monitor
@@ -988,23 +1034,70 @@ package gdb_server_stub_pkg;
             return(1);
         endfunction: rsp_point
 
+    ///////////////////////////////////////
+    // checkpoints
+    ///////////////////////////////////////
+
+        // fork a checkpoint of the simulation
+        // (returns 1 in the copy resumed by 'monitor checkpoint restore')
+        function automatic bit rsp_checkpoint_save ();
+            case (checkpoint_save(shd.size(), $time))
+                0: return(1'b0);
+                1: begin
+                    // GDB is waiting for the reply to the packet after the restore command
+                    stub_state.restored = 1'b1;
+                    shd.sig = SIGTRAP;
+                    return(1'b1);
+                end
+                default: begin
+                    $warning("GDB: checkpoint at trace position %0d failed.", shd.size());
+                    return(1'b0);
+                end
+            endcase
+        endfunction: rsp_checkpoint_save
+
     ///////////////////////////////////////
     // RSP step/continue
     ///////////////////////////////////////
 
+        // periodic checkpoint of the DUT simulation (after 'num' instructions were recorded)
+        function automatic void rsp_checkpoint_periodic (
+            input int unsigned num
+        );
+            if (stub_state.checkpoint && (shd.size() / stub_state.checkpoint != (shd.size() - num) / stub_state.checkpoint)) begin
+                void'(rsp_checkpoint_save());
+            end
+        endfunction: rsp_checkpoint_periodic
+
         task rsp_forward_step;
-            retired_t ret;
+            retired_batch_t batch;
 
-            // record (if not in replay mode)
-            if (shd.cnt == shd.trc.size()-1) begin
+            // record (if not in replay mode), breakpoints match the instruction
+            // to be replayed next, so the trace is kept one instruction ahead
+            if (shd.count()+1 >= shd.size()) begin
                 // perform DUT step
-                dut_step(ret);
-                shd.trc.push_back(ret);
+                dut_retire(batch);
+                void'(shd.retire(batch, 1'b0));
             end
             // handle shadow and trace
             shd.forward();
+            rsp_checkpoint_periodic(batch.size());
         endtask: rsp_forward_step
 
+        // forward until the trace ahead of the shadow is consumed (or a stop),
+        // a DUT clock cycle costs a single DPI call regardless of retire width
+        task rsp_forward_run;
+            retired_batch_t batch;
+
+            // record (if not in replay mode)
+            if (shd.count()+1 >= shd.size()) begin
+                dut_retire(batch);
+            end
+            // push the batch and replay the shadow
+            void'(shd.retire(batch, 1'b1));
+            rsp_checkpoint_periodic(batch.size());
+        endtask: rsp_forward_run
+
         task rsp_step;
             int       status;
             string    pkt;
@@ -1035,8 +1128,9 @@ package gdb_server_stub_pkg;
             // forward step
             rsp_forward_step;
 
-            // response packet
-            status = rsp_stop_reply(shd.sig);
+            // response packet (not after a checkpoint restore)
+            if (stub_state.restored)  stub_state.restored = 1'b0;
+            else  status = rsp_stop_reply(shd.sig);
         endtask: rsp_step
 
         task rsp_continue ();
@@ -1069,7 +1163,7 @@ package gdb_server_stub_pkg;
 
             // step forward
             do begin
-                rsp_forward_step;
+                rsp_forward_run;
 
                 status = socket_recv(ch, MSG_PEEK | MSG_DONTWAIT);
 
@@ -1088,8 +1182,9 @@ package gdb_server_stub_pkg;
                 end
             end while (shd.sig == SIGNONE);
 
-            // send response
-            status = rsp_stop_reply(shd.sig);
+            // send response (not after a checkpoint restore)
+            if (stub_state.restored)  stub_state.restored = 1'b0;
+            else  status = rsp_stop_reply(shd.sig);
         endtask: rsp_continue
 
     ////////////////////////////////////////
@@ -1098,13 +1193,13 @@ package gdb_server_stub_pkg;
 
         function void rsp_backward_step;
             // record (if not replay)
-            if (shd.cnt == -1) begin
+            if (shd.size() == 0) begin
                 // DUT is still somewhere in the reset sequence
                 // TODO: return some kind of error
                 shd.sig = SIGTRAP;
                 return;
             end
-            else if (shd.cnt == 0) begin
+            else if (shd.count() == 0) begin
                 // already at the beginning of history, can't go further back
                 // TODO: maybe there is a better option than a trap, check what QEMU does
                 shd.sig = SIGTRAP;
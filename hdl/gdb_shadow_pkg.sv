@@ -45,6 +45,107 @@ package gdb_shadow_pkg;
 
     typedef int unsigned pkind_t;
 
+///////////////////////////////////////////////////////////////////////////////
+// C++ shadow (shadow::System) DPI-C API
+///////////////////////////////////////////////////////////////////////////////
+
+    // shadow construction/destruction (null if XLEN/GPRN do not match the C++ shadow)
+    import "DPI-C" function chandle hdldb_new (
+        input int harts,
+        input int xlen,
+        input int gprn
+    );
+    // check a memory region is inside the C++ shadow memory (returns 1 if it is)
+    import "DPI-C" function int hdldb_mem_region (
+        input chandle          sys,
+        input longint unsigned base,
+        input longint unsigned size
+    );
+    import "DPI-C" function void hdldb_free (
+        input chandle sys
+    );
+
+    // retired instruction record (GPR index 0 for no write, LSU size 0 for no access),
+    // the layout matches 'Record' in 'src/Dpi.cpp' (canonical little endian words)
+    typedef struct packed {
+        bit [64-1:0] lsu_dat;    // LSU read/write data
+        bit [64-1:0] lsu_adr;    // LSU address
+        bit [64-1:0] gpr_wdt;    // GPR write data
+        bit [64-1:0] ifu_pcn;    // next PC
+        bit [64-1:0] ifu_adr;    // PC
+        bit [32-1:0] reserved1;
+        bit [32-1:0] ifu_rdt;    // instruction
+        bit [24-1:0] reserved0;
+        bit [ 8-1:0] hart;
+        bit [ 8-1:0] ifu_siz;    // instruction size
+        bit [ 8-1:0] gpr_idx;    // GPR destination
+        bit [ 8-1:0] lsu_siz;    // LSU access size
+        bit [ 6-1:0] flags;
+        bit          lsu_wen;    // LSU write
+        bit          ifu_ill;    // illegal instruction
+    } retired_packed_t;
+
+    // instructions retired in a clock cycle (superscalar cores retire more than one)
+    typedef retired_packed_t retired_batch_t [];
+
+    // push instructions retired in a clock cycle, with 'run' set the shadow
+    // is replayed while the trace is ahead of it, so breakpoints/watchpoints
+    // are matched over the batch (returns 1 if the shadow stopped)
+    import "DPI-C" function int hdldb_retire (
+        input chandle          sys,
+        input retired_packed_t batch [],
+        input int              run
+    );
+
+    // forward/backward step (returns 1 if the shadow stopped at a breakpoint/watchpoint)
+    import "DPI-C" function int hdldb_forward  (input chandle sys);
+    import "DPI-C" function int hdldb_backward (input chandle sys);
+
+    // trace position and length
+    import "DPI-C" function longint hdldb_count (input chandle sys);
+    import "DPI-C" function longint hdldb_size  (input chandle sys);
+
+    // stop signal, reason (point type) and watchpoint address
+    import "DPI-C" function int              hdldb_signal      (input chandle sys);
+    import "DPI-C" function int              hdldb_reason      (input chandle sys);
+    import "DPI-C" function longint unsigned hdldb_reason_addr (input chandle sys);
+
+    // register access (GDB register number)
+    import "DPI-C" function longint unsigned hdldb_reg_read (
+        input chandle          sys,
+        input int              idx
+    );
+    import "DPI-C" function int hdldb_reg_write (
+        input chandle          sys,
+        input int              idx,
+        input longint unsigned val
+    );
+
+    // memory access (byte)
+    import "DPI-C" function byte hdldb_mem_read (
+        input chandle          sys,
+        input longint unsigned adr
+    );
+    import "DPI-C" function void hdldb_mem_write (
+        input chandle          sys,
+        input longint unsigned adr,
+        input byte             val
+    );
+
+    // breakpoint/watchpoint insert/remove
+    import "DPI-C" function int hdldb_point_insert (
+        input chandle          sys,
+        input int              ptype,
+        input longint unsigned adr,
+        input int              pkind
+    );
+    import "DPI-C" function int hdldb_point_remove (
+        input chandle          sys,
+        input int              ptype,
+        input longint unsigned adr,
+        input int              pkind
+    );
+
 ///////////////////////////////////////////////////////////////////////////////
 // GDB shadow class
 ///////////////////////////////////////////////////////////////////////////////
@@ -54,19 +155,15 @@ package gdb_shadow_pkg;
         parameter  int unsigned XLEN = 32,  // register/address/data width
         // choice between F/D/Q floating point support
 //      parameter  int unsigned FLEN = 32,  // floating point register width (use 0 to disable FPU registers)
-        // number of all registers
+        // number of all registers (CSRs are not part of the C++ shadow)
         parameter  int unsigned GPRN =   32,       // GPR number (use 16 for E extension)
-        parameter  int unsigned CSRN = 4096,       // CSR number  TODO: should be a list of indexes
-        // memory map (shadow memory map)
+        // memory map (checked against the C++ shadow memory, configured in 'src/Dpi.cpp')
         parameter  type         SIZE_T = int unsigned,  // could be longint (RV64), but it results in warnings
         parameter  int unsigned MEMN = 1,          // memory regions number
         parameter  type         MMAP_T = struct {SIZE_T base; SIZE_T size;},
         parameter  MMAP_T       MMAP [0:MEMN-1] = '{default: '{base: 0, size: 256}}
     );
 
-        // dictionary of array_t
-        typedef array_t dictionary_t [SIZE_T];
-
     ////////////////////////////////////////
     // retired instruction trace
     ////////////////////////////////////////
@@ -123,26 +220,8 @@ package gdb_shadow_pkg;
     // shadow state
     ////////////////////////////////////////
 
-        // registers
-        logic [XLEN-1:0] gpr [0:GPRN-1];  // GPR (general purpose register file)
-        bit   [XLEN-1:0] pc;              // PC  (program counter)
-//      logic [FLEN-1:0] fpr [0:  32-1];  // FPR (floating point register file)
-        logic [XLEN-1:0] csr [0:CSRN-1];  // CSR (configuration status registers)
-
-        // memories
-        array_t          mem [0:MEMN-1];  // array of address map regions
-
-        // memory mapped I/O registers (covers address space not covered by memories)
-        dictionary_t     i_o;
-
-        // instruction counter
-        SIZE_T           cnt;
-
-        // trace queue
-        retired_t        trc [$];
-
-        // current retired instruction
-        retired_t        ret;
+        // C++ shadow (registers, memories, trace, points)
+        chandle          sys;
 
         // signal
         signal_t         sig;
@@ -150,34 +229,88 @@ package gdb_shadow_pkg;
         // reason (point type/kind)
         point_t          rsn;
 
-        // associative array for hardware breakpoints/watchpoint
-        point_t          bpt [SIZE_T];
-        point_t          wpt [SIZE_T];
-
     ////////////////////////////////////////
     // constructor
     ////////////////////////////////////////
 
         // constructor
         function new ();
-            // RISC-V specific x0 (zero) initialization
-            gpr[0] = '0;
-            // initialize array of memory regions
-            for (int unsigned i=0; i<$size(MMAP); i++) begin
-                mem[i] = new[MMAP[i].size];
+            sys = hdldb_new(1, XLEN, GPRN);
+            if (sys == null)  $fatal(1, "GDB shadow: XLEN=%0d/GPRN=%0d are not supported by the C++ shadow.", XLEN, GPRN);
+            foreach (MMAP[i]) begin
+                if (!hdldb_mem_region(sys, MMAP[i].base, MMAP[i].size))  $fatal(1, "GDB shadow: memory region %0d is outside the C++ shadow memory.", i);
             end
-            // initialize I/O dictionaries
-            i_o.delete();
-            // initialize trace queue
-            trc.delete();
-            // initialize counter (the counter pnt to no instruction)
-            cnt = -1;
             // signal
             sig = SIGTRAP;
             // reason
-            rsn = "";
+            rsn = '{none, 0};
         endfunction: new
 
+    ////////////////////////////////////////
+    // trace
+    ////////////////////////////////////////
+
+        // trace position (number of replayed instructions)
+        function longint count ();
+            return(hdldb_count(sys));
+        endfunction: count
+
+        // trace length (number of retired instructions)
+        function longint size ();
+            return(hdldb_size(sys));
+        endfunction: size
+
+        // watchpoint address of the last stop
+        function bit [XLEN-1:0] reason_addr ();
+            return(hdldb_reason_addr(sys));
+        endfunction: reason_addr
+
+        // pack instruction retired by the DUT (CSR changes are not traced)
+        function automatic retired_packed_t pack (
+            input retired_t    ret,
+            input int unsigned hart = 0
+        );
+            int siz = ret.lsu.wdt.size() > 0 ? ret.lsu.wdt.size() : ret.lsu.rdt.size();
+            pack = '0;
+            pack.hart    = hart;
+            pack.ifu_adr = ret.ifu.adr;
+            pack.ifu_pcn = ret.ifu.pcn;
+            pack.ifu_siz = ret.ifu.rdt.size();
+            pack.ifu_ill = ret.ifu.ill;
+            if (ret.gpr.size() > 0) begin
+                pack.gpr_idx = ret.gpr[0].idx;
+                pack.gpr_wdt = ret.gpr[0].wdt;
+            end
+            pack.lsu_adr = ret.lsu.adr;
+            pack.lsu_siz = siz;
+            pack.lsu_wen = ret.lsu.wdt.size() > 0;
+            // instruction and LSU data bytes (little endian)
+            for (int unsigned i=0; i<ret.ifu.rdt.size(); i++) begin
+                pack.ifu_rdt[8*i+:8] = ret.ifu.rdt[i];
+            end
+            for (int unsigned i=0; i<siz; i++) begin
+                pack.lsu_dat[8*i+:8] = pack.lsu_wen ? ret.lsu.wdt[i] : ret.lsu.rdt[i];
+            end
+        endfunction: pack
+
+        // push instructions retired by the DUT in a clock cycle (a single DPI call),
+        // with 'run' set the shadow is replayed over the trace ahead of it
+        function automatic bit retire (
+            input retired_batch_t batch,
+            input bit             run
+        );
+            retire = hdldb_retire(sys, batch, run);
+            if (retire)  stop();
+        endfunction: retire
+
+        // push instruction retired by the DUT
+        function automatic void push (
+            input retired_t ret
+        );
+            retired_batch_t batch = {pack(ret)};
+            void'(retire(batch, 1'b0));
+        endfunction: push
+
     ////////////////////////////////////////
     // register access
     ////////////////////////////////////////
@@ -187,33 +320,14 @@ package gdb_shadow_pkg;
           input int unsigned   idx,
           input bit [XLEN-1:0] val
         );
-            if (idx < GPRN) begin
-                gpr[idx] = val;
-            end else
-            if (idx == GPRN) begin
-                pc = val;
-            end else
-            if (idx > GPRN) begin
-                csr[idx-1-GPRN] = val;
-            end
+            void'(hdldb_reg_write(sys, idx, val));
         endfunction: reg_write
 
         // read register from shadow copy
         function logic [XLEN-1:0] reg_read (
           input int unsigned   idx
         );
-            if (idx < GPRN) begin
-                return(gpr[idx]);
-            end else
-            if (idx == GPRN) begin
-                return(pc);
-            end else
-            if (idx > GPRN) begin
-                return(csr[idx-1-GPRN]);
-            end else
-            begin
-                return('x);
-            end
+            return(hdldb_reg_read(sys, idx));
         endfunction: reg_read
 
     ////////////////////////////////////////
@@ -226,18 +340,9 @@ package gdb_shadow_pkg;
             SIZE_T siz
         );
             array_t tmp = new[siz];
-            // reading from an address map block
-            for (int unsigned blk=0; blk<$size(MMAP); blk++) begin: map
-                if ((adr >= MMAP[blk].base) &&
-                    (adr <  MMAP[blk].base + MMAP[blk].size)) begin: slice
-                    tmp = {>>{mem[blk] with [adr - MMAP[blk].base +: siz]}};
-                    return tmp;
-                end: slice
-            end: map
-            // reading from an unmapped IO region (reads have higher priority)
-            // TODO: handle access to nonexistent entries with a warning?
-            // TODO: handle access with a size mismatch
-            tmp = i_o[adr];
+            for (int unsigned i=0; i<siz; i++) begin
+                tmp[i] = hdldb_mem_read(sys, adr+i);
+            end
             return tmp;
         endfunction: mem_read
 
@@ -246,136 +351,29 @@ package gdb_shadow_pkg;
             SIZE_T  adr,
             array_t dat
         );
-            // writing to an address map block
-            for (int unsigned blk=0; blk<$size(MMAP); blk++) begin: map
-                if ((adr >= MMAP[blk].base) &&
-                    (adr <  MMAP[blk].base + MMAP[blk].size)) begin: slice
-                    {>>{mem[blk] with [adr - MMAP[blk].base +: dat.size()]}} = dat;
-//                    for (int unsigned i=0; i<dat.size(); i++) begin: byt
-//                      mem[blk][adr - MMAP[blk].base] = dat[i];
-//                    end: byt
-                    return;
-                end: slice
-            end: map
-            // writing to an unmapped IO region (reads have higher priority)
-            i_o[adr] = dat;
+            for (int unsigned i=0; i<dat.size(); i++) begin
+                hdldb_mem_write(sys, adr+i, dat[i]);
+            end
         endfunction: mem_write
 
-    ////////////////////////////////////////
-    // update/record/replay/revert retired instruction to/from DUT shadow state
-    ////////////////////////////////////////
-
-        // update the shadow with state experienced by retired instruction (GPR/PC are no affected)
-        // for example CSR state changes and memory writes by a DMA
-        function automatic void update (
-            ref retired_t ret
-        );
-            // IFU/PC
-            mem_write(ret.ifu.adr, ret.ifu.rdt);
-            pc = ret.ifu.adr;
-            // CSR
-            for (int unsigned i=0; i<ret.csr.size(); i++) begin: csr_idx
-                csr[ret.csr[i].idx] = ret.csr[i].rdt;
-            end: csr_idx
-            // LSU
-            mem_write(ret.lsu.adr, ret.lsu.rdt);
-        endfunction: update
-
-        // remember the current shadow state for all shadow state changes to be able to revert later
-        function automatic void record (
-            ref retired_t ret
-        );
-            // IFU/PC
-            ret.ifu.rdt = mem_read(ret.ifu.adr, $size(ret.ifu.rdt));
-            ret.ifu.adr = pc;
-            // GPR
-            for (int unsigned i=0; i<ret.gpr.size(); i++) begin: gpr_idx
-                ret.gpr[i].rdt = gpr[ret.gpr[i].idx];
-            end: gpr_idx
-            // CSR
-            for (int unsigned i=0; i<ret.csr.size(); i++) begin: csr_idx
-                ret.csr[i].rdt = csr[ret.csr[i].idx];
-            end: csr_idx
-            // LSU
-            ret.lsu.rdt = mem_read(ret.lsu.adr, $size(ret.lsu.wdt));
-        endfunction: record
-
-        function automatic void replay (
-            ref retired_t ret
-        );
-            // PC
-            pc = ret.ifu.pcn;
-            // GPR remember the old value and apply the new one
-            for (int unsigned i=0; i<ret.gpr.size(); i++) begin: gpr_idx
-                gpr[ret.gpr[i].idx] = ret.gpr[i].wdt;
-            end: gpr_idx
-            // CSR remember the read value and apply written value
-            for (int unsigned i=0; i<ret.csr.size(); i++) begin: csr_idx
-                csr[ret.csr[i].idx] = ret.csr[i].wdt;
-            end: csr_idx
-            // memory
-            mem_write(ret.lsu.adr, ret.lsu.wdt);
-        endfunction: replay
-
-        function automatic void revert (
-            ref retired_t ret
-        );
-            // PC
-            pc = ret.ifu.adr;
-            // GPR remember the old value and apply the new one
-            for (int unsigned i=0; i<ret.gpr.size(); i++) begin: gpr_idx
-                gpr[ret.gpr[i].idx] = ret.gpr[i].rdt;
-            end: gpr_idx
-            // CSR remember the read value and apply written value
-            for (int unsigned i=0; i<ret.csr.size(); i++) begin: csr_idx
-                csr[ret.csr[i].idx] = ret.csr[i].rdt;
-            end: csr_idx
-            // memory
-            mem_write(ret.lsu.adr, ret.lsu.rdt);
-        endfunction: revert
-
     ////////////////////////////////////////
     // forward/backward steps
     ////////////////////////////////////////
 
+        // the stop signal/reason is only updated when the shadow stops
         function void forward ();
-            $display("DEBUG: FORWARD: trc.size() = %0d, trc[%0d] = %p", trc.size(), cnt, trc[cnt-1]);
-            // replay the previous retired instruction to the shadow
-            // if there is no previous retired instruction,
-            // there is nothing to apply to the shadow
-            if (cnt != -1) begin
-                replay(trc[cnt]);
-            end
-            // increment retirement counter
-            cnt++;
-            // update/record (if not in replay mode)
-            if (cnt == trc.size()) begin
-                update(trc[cnt]);
-                record(trc[cnt]);
-            end
-            // breakpoint/watchpoint
-            ret = trc[cnt];
-            breakpoint_match(ret);
-            watchpoint_match(ret);
+            if (hdldb_forward(sys))  stop();
         endfunction: forward
 
         function void backward ();
-            $display("DEBUG: BACKWARD-I: trc.size() = %0d, trc[%0d] = %p", trc.size(), cnt, trc[cnt]);
-            // revert the previous retired instruction to the shadow
-            // if there is no previous retired instruction,
-            // there is nothing to apply to the shadow
-            if (cnt != 0) begin
-                revert(trc[cnt-1]);
-            end
-            // decrement retirement counter
-            cnt--;
-            $display("DEBUG: BACKWARD-O: trc.size() = %0d, trc[%0d] = %p", trc.size(), cnt, trc[cnt]);
-            // breakpoint/watchpoint
-            ret = trc[cnt];
-            breakpoint_match(ret);
-            watchpoint_match(ret);
+            if (hdldb_backward(sys))  stop();
         endfunction: backward
 
+        function void stop ();
+            sig = signal_t'(hdldb_signal(sys));
+            rsn = '{ptype_t'(hdldb_reason(sys)), 0};
+        endfunction: stop
+
     ////////////////////////////////////////
     // GDB breakpoints/watchpoints insert/remove
     ////////////////////////////////////////
@@ -385,17 +383,7 @@ package gdb_shadow_pkg;
             SIZE_T  addr,
             pkind_t pkind
         );
-            // insert breakpoint/watchpoint into dictionary
-            case (ptype)
-                swbreak, hwbreak: begin
-                    bpt[addr] = '{ptype, pkind};
-                    return(bpt.size);
-                end
-                watch, rwatch, awatch: begin
-                    wpt[addr] = '{ptype, pkind};
-                    return(wpt.size);
-                end
-            endcase
+            return(hdldb_point_insert(sys, ptype, addr, pkind));
         endfunction: point_insert
 
         function automatic int point_remove (
@@ -403,72 +391,9 @@ package gdb_shadow_pkg;
             SIZE_T  addr,
             pkind_t pkind
         );
-            case (ptype)
-                swbreak, hwbreak: begin
-                    bpt.delete(addr);
-                    return(bpt.size);
-                end
-                watch, rwatch, awatch: begin
-                    wpt.delete(addr);
-                    return(wpt.size);
-                end
-            endcase
+            return(hdldb_point_remove(sys, ptype, addr, pkind));
         endfunction: point_remove
 
-    ////////////////////////////////////////
-    // GDB breakpoints/watchpoints matching
-    ////////////////////////////////////////
-
-        function automatic void breakpoint_match (
-            input retired_t ret
-        );
-            SIZE_T   adr = ret.ifu.adr;
-
-            // match illegal instruction
-            if (ret.ifu.ill) begin
-                sig = SIGILL;
-                $display("DEBUG: Triggered illegal instruction at address %h.", adr);
-            end else
-            // match EBREAK/C.EBREAK instruction (software breakpoint)
-            // TODO: there are also explicit SW breakpoints that depend on ILEN
-            if ((ret.ifu.rdt[0:3] == '{8'h73, 8'h00, 8'h10, 8'h00}) ||  // 32'h00100073
-                (ret.ifu.rdt[0:1] == '{8'h02, 8'h90})) begin  // 16'h9002
-                sig = SIGTRAP;
-                $display("DEBUG: Triggered SW breakpoint at address %h.", adr);
-            end else
-            // match hardware breakpoint
-            if (bpt.exists(adr)) begin
-                if (bpt[adr].ptype == hwbreak) begin
-                    // signal
-                    sig = SIGTRAP;
-                    // reason
-                    rsn = bpt[adr];
-                    $display("DEBUG: Triggered HW breakpoint at address %h.", adr);
-                end
-            end
-        endfunction: breakpoint_match
-
-        function automatic void watchpoint_match (
-            input retired_t ret
-        );
-            SIZE_T   adr =       ret.lsu.adr;
-            bit      wen = $size(ret.lsu.wdt) > 0;
-
-            // match hardware watchpoint
-            if (wpt.exists(adr)) begin
-                if (((wpt[adr].ptype == watch ) && wen == 1'b1) ||
-                    ((wpt[adr].ptype == rwatch) && wen == 1'b0) ||
-                    ((wpt[adr].ptype == awatch) )) begin
-                    // TODO: check is transfer size matches
-                    // signal
-                    sig = SIGTRAP;
-                    // reason
-                    rsn = wpt[adr];
-                    $display("DEBUG: Triggered HW watchpoint at address %h.", adr);
-                end
-            end
-        endfunction: watchpoint_match
-
     endclass: gdb_shadow
 
 endpackage: gdb_shadow_pkg
@@ -169,7 +169,6 @@ module nerv_gdb #(
                 ret.lsu.rdt = new[2**lsu_siz]({<<8{lsu_rdt}});
                 ret.lsu.wdt = new[2**lsu_siz]({<<8{lsu_wdt}});
             end
-            $display("DEBUG: dut_step: ret = %p", ret);
         endtask: dut_step
 
         virtual task dut_jump (
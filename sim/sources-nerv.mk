@@ -8,9 +8,14 @@ PATH_GDB=../../hdl
 
 # DPI-C code
 SRC+=${PATH_GDB}/socket_dpi_pkg.c
+SRC+=${PATH_GDB}/checkpoint_dpi_pkg.c
+
+# C++ shadow DPI-C library (built with meson)
+DPI_LIB=../../builddir/libhdldb-dpi
 
 # SystemVerilog bench (Test SV)
 TSV+=${PATH_GDB}/socket_dpi_pkg.sv
+TSV+=${PATH_GDB}/checkpoint_dpi_pkg.sv
 TSV+=${PATH_GDB}/gdb_shadow_pkg.sv
 TSV+=${PATH_GDB}/gdb_server_stub_pkg.sv
 
@@ -0,0 +1,279 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB shadow DPI-C API (live simulation shadow)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// The SystemVerilog stub ('gdb_shadow_pkg') pushes instructions retired by
+// the DUT, the shadow state, trace, breakpoints/watchpoints and replay/revert
+// are handled by 'shadow::System'. Arguments are scalars, except for the
+// batch of instructions retired in a clock cycle ('hdldb_retire'), which is
+// an open array accessed through the few IEEE 1800 DPI-C functions declared
+// below, so the API does not depend on 'svdpi.h'.
+//
+// Breakpoints match the instruction to be replayed next, so the stub keeps
+// one retired instruction ahead of the shadow. The instruction the shadow
+// stops at for the first time is applied with the state observed by the DUT
+// (instruction fetch and load data), the shadow memory is not preloaded.
+//
+// The live shadow is RV32 without CSRs (registers as in 'hdldb.hpp'). Its
+// memory map is a build configuration (the default is the NERV testbench
+// RAM), addresses outside the memory are I/O logged by replay. The stub
+// parameters are checked against it at construction.
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// C++ includes
+#include <vector>
+#include <limits>
+#include <print>
+
+// HDLDB includes
+#include "hdldb.hpp"
+
+// open array access (IEEE 1800 DPI-C, provided by the simulator)
+extern "C" {
+    typedef void* svOpenArrayHandle;
+    int   svLow  (const svOpenArrayHandle h, int d);
+    int   svHigh (const svOpenArrayHandle h, int d);
+    void* svGetArrElemPtr1 (const svOpenArrayHandle h, int indx1);
+}
+
+// live shadow memory (system memory shared by harts)
+#ifndef HDLDB_DPI_MEM_BASE
+#define HDLDB_DPI_MEM_BASE 0x0000'0000
+#endif
+#ifndef HDLDB_DPI_MEM_SIZE
+#define HDLDB_DPI_MEM_SIZE 0x0001'0000
+#endif
+
+namespace {
+
+    constexpr shadow::AddressBlock<XlenHdlDb> memSystem0Dpi { HDLDB_DPI_MEM_BASE, HDLDB_DPI_MEM_SIZE };
+
+    constexpr shadow::AddressMap<XlenHdlDb, 0, 0> AmapCoreDpi { };
+    constexpr shadow::AddressMap<XlenHdlDb, 1, 0> AmapSystemDpi { {memSystem0Dpi}, { } };
+
+    using MmapCoreDpi   = shadow::MemoryMap<XlenHdlDb, AmapCoreDpi>;
+    using MmapSystemDpi = shadow::MemoryMap<XlenHdlDb, AmapSystemDpi>;
+
+    using CoreDpi   = shadow::Core<RegHdlDb, MmapCoreDpi, PointHdlDb>;
+    using SystemDpi = shadow::System<XlenHdlDb, FlenHdlDb, VlenHdlDb, CoreDpi, MmapSystemDpi, PointHdlDb>;
+
+    // retired instruction record, canonical (little endian 32 bit words)
+    // representation of 'gdb_shadow_pkg::retired_packed_t'
+    struct Record {
+        std::uint8_t  flags;     // [0] illegal instruction, [1] LSU write
+        std::uint8_t  lsu_siz;   // LSU access size (0 for no access)
+        std::uint8_t  gpr_idx;   // GPR destination (0 for no write)
+        std::uint8_t  ifu_siz;   // instruction size
+        std::uint8_t  hart;
+        std::uint8_t  reserved0 [3];
+        std::uint32_t ifu_rdt;   // instruction
+        std::uint32_t reserved1;
+        std::uint64_t ifu_adr;   // PC
+        std::uint64_t ifu_pcn;   // next PC
+        std::uint64_t gpr_wdt;   // GPR write data
+        std::uint64_t lsu_adr;   // LSU address
+        std::uint64_t lsu_dat;   // LSU read/write data
+    };
+    static_assert(sizeof(Record) == 448/8, "record size must match 'retired_packed_t'");
+
+    struct Live {
+        SystemDpi   sys;
+        std::size_t updated = 0;      // trace positions with applied DUT state
+        bool        started = false;  // the shadow left reset (is at the first instruction)
+
+        Live (const std::size_t harts) : sys(harts) { };
+
+        // thread of the stopped hart
+        rsp::ThreadId thread () const { return {1, static_cast<int>(sys.m_hart) + 1}; };
+
+        // apply the state observed by the DUT to the shadow (memory blocks only, I/O is logged by replay)
+        void update (const std::size_t pos) {
+            const auto& ret = sys.retired(pos);
+            const rsp::ThreadId tid { 1, static_cast<int>(sys.m_order[pos].hart) + 1 };
+            auto write = [&](const XlenHdlDb adr, const std::vector<std::byte>& dat) {
+                const auto [base, end] { sys.mem_block(tid, adr) };
+                if (dat.empty() || base == end || end - adr < dat.size())  return;
+                std::vector<std::byte> tmp { dat };
+                sys.mem_write(tid, adr, tmp);
+            };
+            sys.m_cores[sys.m_order[pos].hart].writePc(ret.ifu.adr);
+            write(ret.ifu.adr, ret.ifu.rdt);
+            if (ret.lsu.wdt.empty())  write(ret.lsu.adr, ret.lsu.rdt);
+        };
+
+        // push a retired instruction (returns true if the first instruction matches a breakpoint)
+        bool push (const Record& rec);
+
+        // replay one instruction (returns true if the shadow stopped)
+        bool forward () {
+            bool stop;
+            if (!started) {
+                // the first retired instruction is where the DUT stopped, there is nothing to replay
+                started = true;
+                sys.stopped().m_signal = SIGTRAP;
+                sys.stopped().m_reason = {rsp::PointType::none, 0};
+                stop = true;
+            } else {
+                stop = sys.forward();
+            }
+            if (sys.count() == updated && updated < sys.size())  update(updated++);
+            return stop;
+        };
+    };
+
+    Live& live (void* handle) { return *static_cast<Live*>(handle); };
+
+    // little endian bytes of a value
+    std::vector<std::byte> bytes (std::uint64_t val, const int size) {
+        std::vector<std::byte> dat (size);
+        for (auto& b : dat) {
+            b = static_cast<std::byte>(val);
+            val >>= 8;
+        }
+        return dat;
+    }
+
+    bool Live::push (const Record& rec) {
+        Retired<XlenHdlDb, FlenHdlDb, VlenHdlDb> ret { };
+        ret.ifu.adr = rec.ifu_adr;
+        ret.ifu.pcn = rec.ifu_pcn;
+        ret.ifu.rdt = bytes(rec.ifu_rdt, rec.ifu_siz);
+        ret.ifu.ill = rec.flags & 0x1;
+        if (rec.gpr_idx != 0) {
+            ret.gpr.idx = rec.gpr_idx;
+            ret.gpr.wdt = { static_cast<XlenHdlDb>(rec.gpr_wdt) };
+        }
+        if (rec.lsu_siz > 0) {
+            ret.lsu.adr = rec.lsu_adr;
+            if (rec.flags & 0x2)  ret.lsu.wdt = bytes(rec.lsu_dat, rec.lsu_siz);
+            else                  ret.lsu.rdt = bytes(rec.lsu_dat, rec.lsu_siz);
+        }
+        ret.time = sys.size();
+        sys.push(rec.hart, std::move(ret));
+        if (sys.size() != 1)  return false;
+        // the shadow is at the first instruction before it is replayed, so it is matched here
+        update(updated++);
+        sys.m_hart = sys.m_order[0].hart;
+        sys.stopped().m_signal = SIGTRAP;
+        sys.stopped().m_reason = {rsp::PointType::none, 0};
+        return sys.stopped().matchBreak(sys.retired(0), sys);
+    }
+
+}
+
+extern "C" {
+
+    // returns NULL if the register width/number do not match the live shadow
+    void* hdldb_new (const int harts, const int xlen, const int gprn) {
+        if (xlen != 8 * sizeof(XlenHdlDb) || gprn != (ExtHdlDb.E ? 16 : 32)) {
+            std::println(stderr, "HDLDB: live shadow is RV{}{} (XLEN={}, GPRN={} requested).", 8 * sizeof(XlenHdlDb), ExtHdlDb.E ? 'E' : 'I', xlen, gprn);
+            return nullptr;
+        }
+        return new Live(harts);
+    }
+
+    // check a stub memory region is inside a live shadow memory block (returns 1 if it is)
+    int hdldb_mem_region (void* handle, const std::uint64_t base, const std::uint64_t size) {
+        auto& lv = live(handle);
+        if (base <= std::numeric_limits<XlenHdlDb>::max()) {
+            const auto [start, end] { lv.sys.mem_block(lv.thread(), base) };
+            if (start != end && size <= std::uint64_t{end} - base)  return 1;
+        }
+        std::println(stderr, "HDLDB: memory region [0x{:x}, 0x{:x}) is outside the live shadow memory [0x{:x}, 0x{:x}).",
+            base, base + size, memSystem0Dpi.base, std::uint64_t{memSystem0Dpi.base} + memSystem0Dpi.size);
+        return 0;
+    }
+
+    void hdldb_free (void* handle) {
+        delete static_cast<Live*>(handle);
+    }
+
+    // push instructions retired in a clock cycle (open array of 'retired_packed_t'),
+    // with 'run' set the shadow is replayed while the trace is ahead of it,
+    // so breakpoints/watchpoints are matched over the batch
+    // (returns 1 if the shadow stopped at a breakpoint/watchpoint)
+    int hdldb_retire (void* handle, const svOpenArrayHandle batch, const int run) {
+        auto& lv = live(handle);
+        bool stop = false;
+        for (int i=svLow(batch, 1); i<=svHigh(batch, 1); i++) {
+            Record rec;
+            std::memcpy(&rec, svGetArrElemPtr1(batch, i), sizeof(rec));
+            stop |= lv.push(rec);
+        }
+        if (!run || stop)  return stop;
+        // continue from the first instruction (a breakpoint on it was matched by 'push')
+        lv.started |= lv.sys.size() > 0;
+        // breakpoints match the instruction to be replayed next
+        while (lv.sys.count() + 1 < lv.sys.size()) {
+            if (lv.forward())  return 1;
+        }
+        return 0;
+    }
+
+    // forward/backward step (returns 1 if the shadow stopped at a breakpoint/watchpoint)
+    int hdldb_forward (void* handle) {
+        return live(handle).forward();
+    }
+
+    int hdldb_backward (void* handle) {
+        return live(handle).sys.backward();
+    }
+
+    // trace position and length
+    std::int64_t hdldb_count (void* handle) { return live(handle).sys.count(); }
+    std::int64_t hdldb_size  (void* handle) { return live(handle).sys.size (); }
+
+    // stop signal, reason (point type, -1 for none) and watchpoint address
+    int           hdldb_signal      (void* handle) { return live(handle).sys.stopped().m_signal; }
+    int           hdldb_reason      (void* handle) { return static_cast<int>(live(handle).sys.stopped().m_reason.type); }
+    std::uint64_t hdldb_reason_addr (void* handle) { return live(handle).sys.stopped().m_reason_addr; }
+
+    // register access (GDB register number, returns 0 for nonexistent registers)
+    std::uint64_t hdldb_reg_read (void* handle, const int idx) {
+        auto& lv = live(handle);
+        const auto reg { lv.sys.reg_readOne(lv.thread(), idx) };
+        std::uint64_t val = 0;
+        for (std::size_t i=0; i<std::min(reg.size(), sizeof(val)); i++)  val |= static_cast<std::uint64_t>(reg[i]) << (8*i);
+        return val;
+    }
+
+    int hdldb_reg_write (void* handle, const int idx, const std::uint64_t val) {
+        auto& lv = live(handle);
+        const std::size_t size = lv.sys.reg_readOne(lv.thread(), idx).size();
+        auto dat { bytes(val, size) };
+        return lv.sys.reg_writeOne(lv.thread(), idx, dat);
+    }
+
+    // memory access (byte)
+    std::uint8_t hdldb_mem_read (void* handle, const std::uint64_t adr) {
+        auto& lv = live(handle);
+        const auto dat { lv.sys.mem_read(lv.thread(), adr, 1) };
+        return dat.empty() ? 0 : static_cast<std::uint8_t>(dat[0]);
+    }
+
+    void hdldb_mem_write (void* handle, const std::uint64_t adr, const std::uint8_t val) {
+        auto& lv = live(handle);
+        std::byte dat { val };
+        lv.sys.mem_write(lv.thread(), adr, {&dat, 1});
+    }
+
+    // breakpoint/watchpoint insert/remove
+    int hdldb_point_insert (void* handle, const int type, const std::uint64_t adr, const int kind) {
+        auto& lv = live(handle);
+        return lv.sys.pointInsert(lv.thread(), static_cast<rsp::PointType>(type), adr, static_cast<rsp::PointKind>(kind));
+    }
+
+    int hdldb_point_remove (void* handle, const int type, const std::uint64_t adr, const int kind) {
+        auto& lv = live(handle);
+        return lv.sys.pointRemove(lv.thread(), static_cast<rsp::PointType>(type), adr, static_cast<rsp::PointKind>(kind));
+    }
+
+}
@@ -0,0 +1,335 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB trace import (Spike commit logs, RVFI-DII execution packets)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// C++ includes
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <span>
+#include <optional>
+#include <fstream>
+#include <future>
+#include <charconv>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+// HDLDB includes
+#include "Instruction.hpp"
+#include "Trace.hpp"
+
+namespace trace {
+
+    // retired instruction of a hart
+    // (commit logs do not contain the next PC, it is taken from the following instruction)
+    template <typename XLEN, typename FLEN, typename VLEN>
+    struct Imported {
+        std::size_t               hart;
+        bool                      pcn;  // next PC is known
+        Retired<XLEN, FLEN, VLEN> ret;
+    };
+
+    // little endian bytes of a value
+    template <typename T>
+    std::vector<std::byte> bytes (const T val, const std::size_t size) {
+        std::vector<std::byte> data (size);
+        std::memcpy(data.data(), &val, std::min(size, sizeof(T)));
+        return data;
+    }
+
+    // size of the load access of an instruction (0 for other instructions)
+    template <typename XLEN>
+    std::size_t loadSize (const std::uint32_t insn) {
+        if ((insn & 0x3) == 0x3) {
+            // LOAD/LOAD-FP opcode, width from funct3
+            if (((insn & 0x7f) == 0x03) || ((insn & 0x7f) == 0x07))  return std::size_t{1} << ((insn >> 12) & 0x3);
+            return 0;
+        }
+        // compressed loads (C.LW/C.FLD and the stack pointer relative variants),
+        // quadrant 0/2 funct3=011 is C.LD/C.LDSP on RV64 and C.FLW/C.FLWSP on RV32
+        switch (insn & 0xe003) {
+            case 0x4000: case 0x4002: return 4;
+            case 0x2000: case 0x2002: return 8;
+            case 0x6000: case 0x6002: return sizeof(XLEN) == 4 ? 4 : 8;
+            default: return 0;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // Spike commit log (spike --log-commits)
+    //   core   0: 3 0x0000000080000004 (0x02028593) x11 0x0000000080000020
+    //   core   0: 3 0x0000000080000010 (0x0007a703) x14 0x0000000000000005 mem 0x0000000080001000
+    //   core   0: 3 0x0000000080000014 (0x00e7a223) mem 0x0000000080001004 0x00000005
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // returns no value for lines which do not describe a committed instruction
+    template <typename XLEN, typename FLEN, typename VLEN>
+    std::optional<Imported<XLEN, FLEN, VLEN>> parseSpike (std::string_view line) {
+        Imported<XLEN, FLEN, VLEN> imp { };
+        auto& ret = imp.ret;
+
+        // split into whitespace separated tokens
+        std::array<std::string_view, 16> tok;
+        std::size_t num = 0;
+        for (std::size_t pos = 0; num < tok.size();) {
+            pos = line.find_first_not_of(" \t\r", pos);
+            if (pos == std::string_view::npos)  break;
+            const std::size_t end = std::min(line.find_first_of(" \t\r", pos), line.size());
+            tok[num++] = line.substr(pos, end - pos);
+            pos = end;
+        }
+        // core, hart:, privilege, PC, (instruction)
+        if (num < 5 || tok[0] != "core" || tok[1].back() != ':' || tok[2].size() != 1 || !tok[3].starts_with("0x"))  return std::nullopt;
+
+        auto hex = [](std::string_view str, auto& val) {
+            if (str.starts_with("0x"))  str.remove_prefix(2);
+            return std::from_chars(str.data(), str.data() + str.size(), val, 16).ec == std::errc{};
+        };
+        std::from_chars(tok[1].data(), tok[1].data() + tok[1].size() - 1, imp.hart);
+        std::uint64_t pc;
+        if (!hex(tok[3], pc))  return std::nullopt;
+        ret.ifu.adr = pc;
+        // instruction size is given by the number of printed digits
+        std::string_view insn_str { tok[4] };
+        if (insn_str.size() < 5 || insn_str.front() != '(' || insn_str.back() != ')')  return std::nullopt;
+        insn_str = insn_str.substr(3, insn_str.size() - 4);
+        std::uint32_t insn;
+        if (!hex(insn_str, insn))  return std::nullopt;
+        ret.ifu.rdt = bytes(insn, insn_str.size() / 2);
+
+        // register writes and memory access
+        for (std::size_t i=5; i+1<num; i+=2) {
+            std::uint64_t val;
+            if (tok[i] == "mem") {
+                hex(tok[i+1], val);
+                ret.lsu.adr = val;
+                if (i+2 < num && tok[i+2].starts_with("0x")) {
+                    // store (size given by the number of printed digits)
+                    std::uint64_t wdt;
+                    hex(tok[i+2], wdt);
+                    ret.lsu.wdt = bytes(wdt, (tok[i+2].size() - 2) / 2);
+                    i++;
+                } else if (const std::size_t size = loadSize<XLEN>(insn); size && !ret.gpr.wdt.empty()) {
+                    // load data from the destination register
+                    ret.lsu.rdt = bytes(ret.gpr.wdt[0], size);
+                }
+            } else if (tok[i].size() > 1 && tok[i][0] == 'x') {
+                unsigned idx;
+                std::from_chars(tok[i].data() + 1, tok[i].data() + tok[i].size(), idx);
+                hex(tok[i+1], val);
+                if (idx != 0) {
+                    ret.gpr.idx = idx;
+                    ret.gpr.wdt = { static_cast<XLEN>(val) };
+                }
+            } else if (tok[i].size() > 1 && tok[i][0] == 'f') {
+                unsigned idx;
+                std::from_chars(tok[i].data() + 1, tok[i].data() + tok[i].size(), idx);
+                hex(tok[i+1], val);
+                ret.fpr.idx = idx;
+                ret.fpr.wdt = static_cast<FLEN>(val);
+            } else if (tok[i].size() > 1 && tok[i][0] == 'c') {
+                // CSR 'c<number>_<name>'
+                unsigned idx;
+                std::from_chars(tok[i].data() + 1, tok[i].data() + tok[i].size(), idx);
+                hex(tok[i+1], val);
+                ret.csr.idx = idx;
+                ret.csr.wdt = static_cast<XLEN>(val);
+            }
+        }
+        return imp;
+    }
+
+    // Lines are parsed in parallel in chunks, 'consume' is called in file order.
+    template <typename XLEN, typename FLEN, typename VLEN, typename FUNC>
+    void readSpike (const std::string& filename, const unsigned threads, FUNC&& consume) {
+        using Chunk = std::vector<Imported<XLEN, FLEN, VLEN>>;
+        constexpr std::size_t CHUNK = 4 << 20;
+
+        std::ifstream file { filename, std::ios::binary };
+        if (!file)  throw std::runtime_error("can not open commit log " + filename);
+
+        std::deque<std::future<Chunk>> pending;
+        std::string rest;
+        auto drain = [&](const std::size_t limit) {
+            while (pending.size() > limit) {
+                for (auto& imp : pending.front().get())  consume(std::move(imp));
+                pending.pop_front();
+            }
+        };
+        while (file) {
+            // read a block of complete lines
+            std::string text { std::move(rest) };
+            const std::size_t size = text.size();
+            text.resize(size + CHUNK);
+            file.read(text.data() + size, CHUNK);
+            text.resize(size + file.gcount());
+            const std::size_t last = text.rfind('\n');
+            if (file && last != std::string::npos) {
+                rest = text.substr(last + 1);
+                text.resize(last + 1);
+            }
+            pending.push_back(std::async(std::launch::async, [text = std::move(text)] {
+                Chunk chunk;
+                std::string_view view { text };
+                while (!view.empty()) {
+                    const std::size_t end = std::min(view.find('\n'), view.size());
+                    if (auto imp { parseSpike<XLEN, FLEN, VLEN>(view.substr(0, end)) })  chunk.push_back(std::move(*imp));
+                    view.remove_prefix(std::min(end + 1, view.size()));
+                }
+                return chunk;
+            }));
+            drain(2 * std::max(threads, 1u));
+        }
+        drain(0);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // RVFI-DII execution packets (TestRIG, version 1)
+    ///////////////////////////////////////////////////////////////////////////////
+
+    struct RvfiPacket {
+        std::uint64_t order;
+        std::uint64_t pc_rdata;
+        std::uint64_t pc_wdata;
+        std::uint64_t insn;
+        std::uint64_t rs1_data;
+        std::uint64_t rs2_data;
+        std::uint64_t rd_wdata;
+        std::uint64_t mem_addr;
+        std::uint64_t mem_rdata;
+        std::uint64_t mem_wdata;
+        std::uint8_t  mem_rmask;
+        std::uint8_t  mem_wmask;
+        std::uint8_t  rs1_addr;
+        std::uint8_t  rs2_addr;
+        std::uint8_t  rd_addr;
+        std::uint8_t  trap;
+        std::uint8_t  halt;
+        std::uint8_t  intr;
+    };
+    static_assert(sizeof(RvfiPacket) == 88);
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    Imported<XLEN, FLEN, VLEN> fromRvfi (const RvfiPacket& pkt, const std::size_t hart = 0) {
+        Imported<XLEN, FLEN, VLEN> imp { hart, true, { } };
+        auto& ret = imp.ret;
+        ret.ifu.adr = pkt.pc_rdata;
+        ret.ifu.pcn = pkt.pc_wdata;
+        ret.ifu.rdt = bytes(pkt.insn, ((pkt.insn & 0x3) == 0x3) ? 4 : 2);
+        ret.ifu.ill = pkt.trap;
+        if (pkt.rd_addr != 0) {
+            ret.gpr.idx = pkt.rd_addr;
+            ret.gpr.wdt = { static_cast<XLEN>(pkt.rd_wdata) };
+        }
+        // byte masks select a contiguous access starting at the lowest set bit
+        auto access = [&](const std::uint8_t mask, const std::uint64_t data) {
+            const unsigned offset = std::countr_zero(mask);
+            ret.lsu.adr = pkt.mem_addr + offset;
+            return bytes(data >> (8*offset), std::popcount(mask));
+        };
+        if      (pkt.mem_wmask)  ret.lsu.wdt = access(pkt.mem_wmask, pkt.mem_wdata);
+        else if (pkt.mem_rmask)  ret.lsu.rdt = access(pkt.mem_rmask, pkt.mem_rdata);
+        return imp;
+    }
+
+    // packets are read in blocks, until the end of the file or a halt packet
+    template <typename XLEN, typename FLEN, typename VLEN, typename FUNC>
+    void readRvfi (const std::string& filename, FUNC&& consume) {
+        std::ifstream file { filename, std::ios::binary };
+        if (!file)  throw std::runtime_error("can not open RVFI trace " + filename);
+        std::vector<RvfiPacket> block (1 << 16);
+        while (file) {
+            file.read(reinterpret_cast<char *>(block.data()), block.size() * sizeof(RvfiPacket));
+            const std::size_t num = file.gcount() / sizeof(RvfiPacket);
+            for (std::size_t i=0; i<num; i++) {
+                if (block[i].halt)  return;
+                consume(fromRvfi<XLEN, FLEN, VLEN>(block[i]));
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // importer (writes imported instructions through the trace writer)
+    ///////////////////////////////////////////////////////////////////////////////
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    class Importer {
+        using RET = Retired<XLEN, FLEN, VLEN>;
+
+        Writer<XLEN, FLEN, VLEN, SYS> m_writer;
+        SYS&                          m_sys;
+        // instruction waiting for the next PC of its hart
+        std::vector<std::optional<RET>> m_pending;
+
+        void emit (const std::size_t hart, RET&& ret);
+
+    public:
+        Importer (const std::string& filename, SYS& sys) :
+            m_writer(filename, sys),
+            m_sys(sys),
+            m_pending(sys.harts())
+        { }
+        ~Importer () { finish(); };
+
+        Writer<XLEN, FLEN, VLEN, SYS>& writer () { return m_writer; };
+
+        void push (Imported<XLEN, FLEN, VLEN>&& imp);
+        // the last instruction of each hart falls through
+        void finish ();
+    };
+
+    // Logs do not contain memory contents, so fetched instructions the shadow
+    // does not know yet are added to the trace as memory records.
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void Importer<XLEN, FLEN, VLEN, SYS>::emit (const std::size_t hart, RET&& ret) {
+        const rsp::ThreadId thread { 1, static_cast<int>(hart)+1 };
+        // the first instruction address is the reset vector
+        auto& core = m_sys.m_cores[hart];
+        if ((core.count() == 0) && (core.readPc() != ret.ifu.adr)) {
+            core.writePc(ret.ifu.adr);
+            auto regs { m_sys.reg_readAll(thread) };
+            std::vector<std::byte> init (regs.begin(), regs.end());
+            m_writer.registers(hart, init);
+        }
+        const auto code { m_sys.mem_read(thread, ret.ifu.adr, ret.ifu.rdt.size()) };
+        if (!std::ranges::equal(code, ret.ifu.rdt))  m_writer.memory(hart, ret.ifu.adr, ret.ifu.rdt);
+        m_writer.retire(hart, std::move(ret));
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void Importer<XLEN, FLEN, VLEN, SYS>::push (Imported<XLEN, FLEN, VLEN>&& imp) {
+        if (imp.hart >= m_pending.size())  throw std::runtime_error("imported trace has more harts than the shadow");
+        auto& pending = m_pending[imp.hart];
+        if (pending) {
+            pending->ifu.pcn = imp.ret.ifu.adr;
+            emit(imp.hart, std::move(*pending));
+            pending.reset();
+        }
+        if (imp.pcn)  emit(imp.hart, std::move(imp.ret));
+        else          pending = std::move(imp.ret);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void Importer<XLEN, FLEN, VLEN, SYS>::finish () {
+        for (std::size_t h=0; h<m_pending.size(); h++) {
+            if (!m_pending[h])  continue;
+            m_pending[h]->ifu.pcn = m_pending[h]->ifu.adr + m_pending[h]->ifu.rdt.size();
+            emit(h, std::move(*m_pending[h]));
+            m_pending[h].reset();
+        }
+    }
+
+}
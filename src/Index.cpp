@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB trace index sidecar file (reconstructed trace and position indexes)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C includes
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// HDLDB includes
+#include "Index.hpp"
+
+namespace trace {
+
+    std::uint64_t hashFile (const std::string& filename) {
+        std::ifstream file { filename, std::ios::binary };
+        if (!file)  throw std::runtime_error("can not open trace file " + filename);
+        std::vector<char> buf (1 << 20);
+        std::uint64_t hash = 0xcbf29ce484222325;
+        while (file) {
+            file.read(buf.data(), buf.size());
+            for (std::streamsize i=0; i<file.gcount(); i++) {
+                hash = (hash ^ static_cast<std::uint8_t>(buf[i])) * 0x100000001b3;
+            }
+        }
+        return hash;
+    }
+
+    FileStamp stampFile (const std::string& filename) {
+        struct stat st;
+        if (::stat(filename.c_str(), &st) != 0)  throw std::runtime_error("can not open trace file " + filename);
+        return { static_cast<std::uint64_t>(st.st_size), static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec };
+    }
+
+    Mapping::Mapping (const std::string& filename) {
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)  throw std::runtime_error("can not open index file " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            m_size = st.st_size;
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            m_size = 0;
+            throw std::runtime_error("can not map index file " + filename);
+        }
+    }
+
+    Mapping::~Mapping () {
+        if (m_data != nullptr)  ::munmap(m_data, m_size);
+    }
+
+}
@@ -0,0 +1,326 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB trace index sidecar file (reconstructed trace and position indexes)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// C++ includes
+#include <string>
+#include <vector>
+#include <span>
+#include <array>
+#include <memory>
+#include <optional>
+#include <fstream>
+#include <spanstream>
+#include <stdexcept>
+#include <algorithm>
+
+// HDLDB includes
+#include "Trace.hpp"
+#include "FlatIndex.hpp"
+
+// Loading a trace re-executes every instruction on the ISS and indexes
+// the result, the sidecar keeps this work for the next time the same trace
+// (identified by its size and modification time) is opened. Sections are
+// 8 byte aligned, so the indexes are used directly from the mapped file and
+// columns are copied, the reconstructed instructions are decoded in blocks
+// on demand.
+namespace trace {
+
+    // file identification and format version
+    constexpr std::array<char, 8> INDEX_MAGIC { 'H', 'D', 'L', 'D', 'B', 'I', 'D', 'X' };
+    constexpr std::uint32_t INDEX_VERSION = 3;
+
+    // number of instructions in a block (unit of decoding)
+    constexpr std::size_t INDEX_BLOCK = 1 << 16;
+
+    // sections
+    enum class Section : std::size_t {
+        retired,       // retired instruction for each trace position
+        blocks,        // offset of each block in the 'retired' section
+        harts,         // hart of each trace position
+        col_pc,        // columns (see shadow::Columns)
+        col_pcn,
+        col_lsu_adr,
+        col_lsu_size,
+        col_gpr_idx,
+        col_fpr_idx,   // empty without the F extension
+        col_vec_idx,   // empty without the V extension
+        col_ill,
+        pc_keys,       // PC index (instruction address)
+        pc_offsets,
+        pc_positions,
+        wr_keys,       // store index (store address)
+        wr_offsets,
+        wr_positions,
+        count
+    };
+
+    // trace file identification (cheap, from file metadata)
+    struct FileStamp {
+        std::uint64_t size;
+        std::int64_t  mtime;  // modification time [ns]
+        bool operator== (const FileStamp&) const = default;
+    };
+
+    // file header (followed by sections)
+    struct IndexHeader {
+        std::array<char, 8> magic;
+        std::uint32_t       version;
+        std::uint32_t       xlen;
+        std::uint64_t       harts;
+        FileStamp           stamp;  // trace file size and modification time
+        std::uint64_t       hash;   // trace file hash (checked on request)
+        std::uint64_t       count;  // number of retired instructions
+        std::array<std::array<std::uint64_t, 2>, static_cast<std::size_t>(Section::count)> sections;  // offset, size
+    };
+    static_assert(std::is_trivially_copyable_v<IndexHeader>);
+    static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "index positions are stored as 64 bit values");
+
+    // trace file hash (FNV-1a)
+    std::uint64_t hashFile (const std::string& filename);
+
+    // trace file size and modification time
+    FileStamp stampFile (const std::string& filename);
+
+    // read only memory mapped file
+    class Mapping {
+        void*       m_data = nullptr;
+        std::size_t m_size = 0;
+    public:
+        explicit Mapping (const std::string& filename);
+        ~Mapping ();
+        Mapping (const Mapping&) = delete;
+        Mapping& operator= (const Mapping&) = delete;
+
+        std::span<const std::byte> data () const { return { static_cast<const std::byte*>(m_data), m_size }; };
+    };
+
+    // typed view of a section of the mapped file
+    template <typename T>
+    std::span<const T> section (std::span<const std::byte> data, const IndexHeader& hdr, const Section sec) {
+        const auto& [offset, size] = hdr.sections[static_cast<std::size_t>(sec)];
+        return { reinterpret_cast<const T*>(data.data() + offset), size / sizeof(T) };
+    }
+
+    // write the sidecar of the trace loaded into the shadow
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void writeIndex (const std::string& filename, const FileStamp stamp, const std::uint64_t hash, SYS& sys);
+
+    // load the trace from the sidecar (returns false if it is missing, corrupted or belongs to another trace),
+    // the trace hash is only compared if given
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    bool readIndex (const std::string& filename, const FileStamp stamp, const std::optional<std::uint64_t> hash, SYS& sys);
+
+    // load a trace, using the sidecar if valid, otherwise the sidecar is written,
+    // 'verify' compares a full hash of the trace against the sidecar
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    bool open (const std::string& filename, const std::string& index, SYS& sys, const bool verify = false);
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // writer
+    ///////////////////////////////////////////////////////////////////////////////
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void writeIndex (const std::string& filename, const FileStamp stamp, const std::uint64_t hash, SYS& sys) {
+        std::ofstream file { filename, std::ios::binary };
+        if (!file)  throw std::runtime_error("can not open index file " + filename);
+
+        IndexHeader hdr { INDEX_MAGIC, INDEX_VERSION, 8*sizeof(XLEN), sys.harts(), stamp, hash, sys.size(), { } };
+        put(file, hdr);
+
+        auto begin = [&](const Section sec) {
+            while (file.tellp() % 8)  file.put(0);
+            hdr.sections[static_cast<std::size_t>(sec)][0] = file.tellp();
+        };
+        auto end = [&](const Section sec) {
+            auto& [offset, size] = hdr.sections[static_cast<std::size_t>(sec)];
+            size = static_cast<std::uint64_t>(file.tellp()) - offset;
+        };
+        auto array = [&]<typename T>(const Section sec, std::span<const T> data) {
+            begin(sec);
+            file.write(reinterpret_cast<const char *>(data.data()), data.size_bytes());
+            end(sec);
+        };
+
+        // retired instructions
+        std::vector<std::uint64_t> blocks;
+        std::vector<std::uint8_t>  harts;
+        begin(Section::retired);
+        const std::uint64_t base = file.tellp();
+        for (std::size_t pos=0; pos<sys.size(); pos++) {
+            if (pos % INDEX_BLOCK == 0)  blocks.push_back(static_cast<std::uint64_t>(file.tellp()) - base);
+            harts.push_back(sys.m_order[pos].hart);
+            writeRetired(file, sys.retired(pos));
+        }
+        end(Section::retired);
+        array(Section::blocks, std::span<const std::uint64_t>(blocks));
+        array(Section::harts , std::span<const std::uint8_t >(harts ));
+
+        // columns
+        const auto& col = sys.m_columns;
+        array(Section::col_pc      , std::span(col.m_pc      ));
+        array(Section::col_pcn     , std::span(col.m_pcn     ));
+        array(Section::col_lsu_adr , std::span(col.m_lsu_adr ));
+        array(Section::col_lsu_size, std::span(col.m_lsu_size));
+        array(Section::col_gpr_idx , std::span(col.m_gpr_idx ));
+        if constexpr (requires { col.m_fpr_idx.data(); })  array(Section::col_fpr_idx, std::span(col.m_fpr_idx));
+        if constexpr (requires { col.m_vec_idx.data(); })  array(Section::col_vec_idx, std::span(col.m_vec_idx));
+        array(Section::col_ill     , std::span(col.m_ill     ));
+
+        // position indexes
+        const auto pc { sys.pcFlat() };
+        const auto wr { sys.wrFlat() };
+        array(Section::pc_keys,      pc.keys     ());
+        array(Section::pc_offsets,   pc.offsets  ());
+        array(Section::pc_positions, pc.positions());
+        array(Section::wr_keys,      wr.keys     ());
+        array(Section::wr_offsets,   wr.offsets  ());
+        array(Section::wr_positions, wr.positions());
+        sys.attachIndex(pc, wr);
+
+        file.seekp(0);
+        put(file, hdr);
+        if (!file)  throw std::runtime_error("writing index file " + filename + " failed");
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // reader
+    ///////////////////////////////////////////////////////////////////////////////
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    bool readIndex (const std::string& filename, const FileStamp stamp, const std::optional<std::uint64_t> hash, SYS& sys) {
+        if (!std::ifstream { filename })  return false;
+        auto map { std::make_shared<const Mapping>(filename) };
+        const auto data { map->data() };
+
+        IndexHeader hdr;
+        if (data.size() < sizeof(hdr))  return false;
+        std::memcpy(&hdr, data.data(), sizeof(hdr));
+        if (hdr.magic   != INDEX_MAGIC  )  return false;
+        if (hdr.version != INDEX_VERSION)  return false;
+        if (hdr.xlen    != 8*sizeof(XLEN))  return false;
+        if (hdr.harts   != sys.harts()  )  return false;
+        if (hdr.stamp   != stamp        )  return false;
+        if (hash && (hdr.hash != *hash))   return false;
+
+        // a sidecar inconsistent with its header is rejected (and rebuilt),
+        // the shadow is only modified after all checks passed
+        for (const auto& [offset, size] : hdr.sections) {
+            if ((offset % 8) || (offset > data.size()) || (size > data.size() - offset))  return false;
+        }
+        // every trace position has at least a hart byte
+        if (hdr.count > data.size())  return false;
+        auto length = [&](const Section sec) { return hdr.sections[static_cast<std::size_t>(sec)][1]; };
+        auto sized  = [&](const Section sec, const std::size_t elem) { return length(sec) % elem == 0; };
+
+        const auto retired { section<char         >(data, hdr, Section::retired) };
+        const auto blocks  { section<std::uint64_t>(data, hdr, Section::blocks ) };
+        const auto harts   { section<std::uint8_t >(data, hdr, Section::harts  ) };
+        if ((blocks.size() != (hdr.count + INDEX_BLOCK - 1) / INDEX_BLOCK) || (harts.size() != hdr.count) || !sized(Section::blocks, 8) ||
+            !std::ranges::is_sorted(blocks) || (!blocks.empty() && (blocks.front() != 0 || blocks.back() > retired.size()))) {
+            return false;
+        }
+        std::vector<std::size_t> num (sys.harts(), 0);
+        for (const std::size_t hart : harts) {
+            if (hart >= sys.harts())  return false;
+            num[hart]++;
+        }
+
+        // columns (extension columns are empty if the extension is not configured)
+        constexpr bool fpr = requires { sys.m_columns.m_fpr_idx.data(); };
+        constexpr bool vec = requires { sys.m_columns.m_vec_idx.data(); };
+        if ((length(Section::col_pc      ) != hdr.count * sizeof(XLEN)) ||
+            (length(Section::col_pcn     ) != hdr.count * sizeof(XLEN)) ||
+            (length(Section::col_lsu_adr ) != hdr.count * sizeof(XLEN)) ||
+            (length(Section::col_lsu_size) != hdr.count) ||
+            (length(Section::col_gpr_idx ) != hdr.count) ||
+            (length(Section::col_fpr_idx ) != (fpr ? hdr.count : 0)) ||
+            (length(Section::col_vec_idx ) != (vec ? hdr.count : 0)) ||
+            !sized(Section::col_ill, sizeof(std::size_t))) {
+            return false;
+        }
+        const auto ill { section<std::size_t>(data, hdr, Section::col_ill) };
+        if ((std::ranges::adjacent_find(ill, std::ranges::greater_equal{}) != ill.end()) || (!ill.empty() && ill.back() >= hdr.count))  return false;
+
+        // indexes are used from the mapped file
+        auto index = [&](const Section keys, const Section offsets, const Section positions) -> std::optional<shadow::FlatIndex<XLEN>> {
+            if (!sized(keys, sizeof(XLEN)) || !sized(offsets, sizeof(std::size_t)) || !sized(positions, sizeof(std::size_t)))  return { };
+            shadow::FlatIndex<XLEN> idx {
+                section<XLEN       >(data, hdr, keys),
+                section<std::size_t>(data, hdr, offsets),
+                section<std::size_t>(data, hdr, positions),
+                hdr.count, map
+            };
+            if (!idx.valid())  return { };
+            return idx;
+        };
+        const auto pc { index(Section::pc_keys, Section::pc_offsets, Section::pc_positions) };
+        const auto wr { index(Section::wr_keys, Section::wr_offsets, Section::wr_positions) };
+        if (!pc || !wr)  return false;
+
+        // trace order, entries are preallocated
+        sys.m_order.reserve(hdr.count);
+        std::ranges::fill(num, 0);
+        for (const std::size_t hart : harts)  sys.m_order.push_back({hart, num[hart]++});
+        for (std::size_t h=0; h<sys.harts(); h++)  sys.m_trace[h].resize(num[h]);
+
+        auto column = [&]<typename T>(const Section sec, std::vector<T>& vec) {
+            const auto src { section<T>(data, hdr, sec) };
+            vec.assign(src.begin(), src.end());
+        };
+        auto& col = sys.m_columns;
+        column(Section::col_pc      , col.m_pc      );
+        column(Section::col_pcn     , col.m_pcn     );
+        column(Section::col_lsu_adr , col.m_lsu_adr );
+        column(Section::col_lsu_size, col.m_lsu_size);
+        column(Section::col_gpr_idx , col.m_gpr_idx );
+        if constexpr (fpr)  column(Section::col_fpr_idx, col.m_fpr_idx);
+        if constexpr (vec)  column(Section::col_vec_idx, col.m_vec_idx);
+        column(Section::col_ill     , col.m_ill     );
+        col.m_lsu_max = 0;
+        for (std::size_t pos=0; pos<col.size(); pos++)  col.m_lsu_max = std::max(col.m_lsu_max, static_cast<std::uint8_t>(col.lsuSize(pos)));
+
+        // retired instructions are decoded from the mapped file when used
+        sys.m_blocks.attach(hdr.count, INDEX_BLOCK, [map, retired, blocks, count = hdr.count](SYS& s, const std::size_t blk) {
+            const std::size_t first = blk * INDEX_BLOCK;
+            const std::size_t last  = std::min<std::size_t>(first + INDEX_BLOCK, count);
+            const std::size_t end   = (blk+1 < blocks.size()) ? blocks[blk+1] : retired.size();
+            std::ispanstream is { retired.subspan(blocks[blk], end - blocks[blk]) };
+            for (std::size_t pos=first; pos<last; pos++) {
+                auto& ret = s.m_trace[s.m_order[pos].hart][s.m_order[pos].index];
+                ret = readRetired<XLEN, FLEN, VLEN>(is);
+                ret.time = pos;
+            }
+        });
+
+        sys.attachIndex(*pc, *wr);
+        return true;
+    }
+
+    // returns true if the sidecar was used
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    bool open (const std::string& filename, const std::string& index, SYS& sys, const bool verify) {
+        const FileStamp stamp { stampFile(filename) };
+        const std::optional<std::uint64_t> hash { verify ? std::optional { hashFile(filename) } : std::nullopt };
+        if (readIndex<XLEN, FLEN, VLEN>(index, stamp, hash, sys)) {
+            // initial memory/register contents are always taken from the trace
+            load<XLEN, FLEN, VLEN>(filename, sys, false);
+            return true;
+        }
+        load<XLEN, FLEN, VLEN>(filename, sys);
+        writeIndex<XLEN, FLEN, VLEN>(index, stamp, hash ? *hash : hashFile(filename), sys);
+        return false;
+    }
+
+}
@@ -6,6 +6,8 @@
 // Licensed under CERN-OHL-P v2 or later
 ///////////////////////////////////////////////////////////////////////////////
 
+#pragma once
+
 // C includes
 #include <cstdint>
 #include <cstddef>
@@ -65,13 +67,15 @@ struct RetiredCsr {
 template <typename XLEN>
 struct RetiredLsu {
     XLEN      adr;     // data address
-    std::vector<std::byte> rdt;  // read  data
+    std::vector<std::byte> rdt;  // read  data (as observed by the DUT, loads and AMO)
     std::vector<std::byte> wdt;  // write data
+    std::vector<std::byte> old;  // memory contents before a store (filled by replay, used by revert)
 };
 
 // instruction retirement history log entry
 template <typename XLEN, typename FLEN, typename VLEN>
 struct Retired {
+    std::int64_t     time;  // retirement time (orders harts in a multi-hart trace)
     RetiredIfu<XLEN> ifu;
     RetiredGpr<XLEN> gpr;
     RetiredFpr<FLEN> fpr;
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB trace file (divergence only trace record)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <algorithm>
+
+// HDLDB includes
+#include "Trace.hpp"
+
+namespace trace {
+
+    void writeHeader (std::ostream& os, const Header& hdr) {
+        os.write(MAGIC.data(), MAGIC.size());
+        put(os, hdr.version);
+        put(os, hdr.xlen);
+        put(os, hdr.harts);
+    }
+
+    Header readHeader (std::istream& is) {
+        std::array<char, MAGIC.size()> magic;
+        is.read(magic.data(), magic.size());
+        if (!is || !std::ranges::equal(magic, MAGIC))  throw std::runtime_error("not a HDLDB trace file");
+        Header hdr;
+        hdr.version = get<std::uint32_t>(is);
+        hdr.xlen    = get<std::uint8_t >(is);
+        hdr.harts   = get<std::uint16_t>(is);
+        if (!is)  throw std::runtime_error("trace file header truncated");
+        return hdr;
+    }
+
+    void writeRecord (std::ostream& os, const Record& rec) {
+        put(os, rec.kind);
+        put(os, rec.hart);
+        put(os, rec.count);
+    }
+
+    // returns false at the end of file
+    bool readRecord (std::istream& is, Record& rec) {
+        rec.kind = get<Kind>(is);
+        if (is.eof())  return false;
+        rec.hart  = get<std::uint8_t >(is);
+        rec.count = get<std::uint64_t>(is);
+        if (!is)  throw std::runtime_error("trace file truncated");
+        return true;
+    }
+
+    // data size followed by data
+    void writeBytes (std::ostream& os, std::span<const std::byte> data) {
+        put<std::uint32_t>(os, data.size());
+        os.write(reinterpret_cast<const char *>(data.data()), data.size());
+    }
+
+    std::vector<std::byte> readBytes (std::istream& is) {
+        std::vector<std::byte> data (get<std::uint32_t>(is));
+        is.read(reinterpret_cast<char *>(data.data()), data.size());
+        return data;
+    }
+
+}
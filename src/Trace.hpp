@@ -0,0 +1,348 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB trace file (divergence only trace record)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// C++ includes
+#include <string>
+#include <vector>
+#include <span>
+#include <array>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+
+// HDLDB includes
+#include <rsp.hpp>
+#include "Instruction.hpp"
+#include "Iss.hpp"
+
+// The recorder only logs events the ISS can not deduce from the shadow state
+// (load values, interrupts, DUT divergences), everything else is reconstructed
+// by re-executing the program when the trace is loaded.
+namespace trace {
+
+    // file identification and format version
+    constexpr std::array<char, 8> MAGIC { 'H', 'D', 'L', 'D', 'B', 'T', 'R', 'C' };
+    constexpr std::uint32_t VERSION = 1;
+
+    // record kinds
+    enum class Kind : std::uint8_t {
+        end       = 0,  // number of instructions retired by a hart
+        memory    = 1,  // initial memory contents
+        registers = 2,  // initial register contents
+        load      = 3,  // load value (I/O, shared memory, modified by a bus master)
+        retired   = 4   // complete retired instruction (not modeled by the ISS or diverged)
+    };
+
+    // file header
+    struct Header {
+        std::uint32_t version;
+        std::uint8_t  xlen;
+        std::uint16_t harts;
+    };
+
+    // record header
+    struct Record {
+        Kind          kind;
+        std::uint8_t  hart;
+        std::uint64_t count;  // hart instruction counter
+    };
+
+    // fixed size values (little endian hosts)
+    template <typename T>
+    void put (std::ostream& os, const T& val) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        os.write(reinterpret_cast<const char *>(&val), sizeof(T));
+    }
+
+    template <typename T>
+    T get (std::istream& is) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T val { };
+        is.read(reinterpret_cast<char *>(&val), sizeof(T));
+        return val;
+    }
+
+    // file/record headers and variable size data
+    void   writeHeader (std::ostream& os, const Header& hdr);
+    Header readHeader  (std::istream& is);
+    void   writeRecord (std::ostream& os, const Record& rec);
+    bool   readRecord  (std::istream& is, Record& rec);
+    void                   writeBytes (std::ostream& os, std::span<const std::byte> data);
+    std::vector<std::byte> readBytes  (std::istream& is);
+
+    // retired instruction (register/memory read data is captured by the shadow on replay)
+    template <typename XLEN, typename FLEN, typename VLEN>
+    void writeRetired (std::ostream& os, const Retired<XLEN, FLEN, VLEN>& ret);
+    template <typename XLEN, typename FLEN, typename VLEN>
+    Retired<XLEN, FLEN, VLEN> readRetired (std::istream& is);
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // writer
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // The writer follows the DUT with the given shadow, each retired instruction
+    // is first predicted by the ISS and only logged if the prediction differs.
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    class Writer {
+        using ISS = shadow::Iss<XLEN, FLEN, VLEN>;
+        using RET = Retired<XLEN, FLEN, VLEN>;
+
+        std::ofstream              m_file;
+        SYS&                       m_sys;
+        // hart instruction counters
+        std::vector<std::uint64_t> m_count;
+        // number of logged records (statistics)
+        std::size_t                m_logged = 0;
+
+    public:
+        Writer (const std::string& filename, SYS& sys);
+        ~Writer ();
+
+        // initial state (before the first retired instruction)
+        void memory    (const std::size_t hart, const XLEN addr, std::span<std::byte> data);
+        void registers (const std::size_t hart, std::span<std::byte> data);
+
+        // retired instruction
+        void retire (const std::size_t hart, RET ret);
+
+        std::size_t logged () const { return m_logged; };
+    };
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    Writer<XLEN, FLEN, VLEN, SYS>::Writer (const std::string& filename, SYS& sys) :
+        m_file(filename, std::ios::binary),
+        m_sys(sys),
+        m_count(sys.harts(), 0)
+    {
+        if (!m_file)  throw std::runtime_error("can not open trace file " + filename);
+        writeHeader(m_file, {VERSION, 8*sizeof(XLEN), static_cast<std::uint16_t>(sys.harts())});
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    Writer<XLEN, FLEN, VLEN, SYS>::~Writer () {
+        for (std::size_t h=0; h<m_count.size(); h++) {
+            writeRecord(m_file, {Kind::end, static_cast<std::uint8_t>(h), m_count[h]});
+        }
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void Writer<XLEN, FLEN, VLEN, SYS>::memory (const std::size_t hart, const XLEN addr, std::span<std::byte> data) {
+        writeRecord(m_file, {Kind::memory, static_cast<std::uint8_t>(hart), 0});
+        put<XLEN>(m_file, addr);
+        writeBytes(m_file, data);
+        m_sys.mem_write({1, static_cast<int>(hart)+1}, addr, data);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void Writer<XLEN, FLEN, VLEN, SYS>::registers (const std::size_t hart, std::span<std::byte> data) {
+        writeRecord(m_file, {Kind::registers, static_cast<std::uint8_t>(hart), 0});
+        writeBytes(m_file, data);
+        m_sys.reg_writeAll({1, static_cast<int>(hart)+1}, data);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void Writer<XLEN, FLEN, VLEN, SYS>::retire (const std::size_t hart, RET ret) {
+        const rsp::ThreadId thread { 1, static_cast<int>(hart)+1 };
+        auto& core = m_sys.m_cores[hart];
+        auto read = [&](const XLEN adr, const std::size_t size) { return m_sys.mem_read(thread, adr, size); };
+
+        // DUT load value (deducible if the shadow contains the same value)
+        const bool load = ret.lsu.wdt.empty() && !ret.lsu.rdt.empty();
+        auto value = [&](const XLEN adr, const std::size_t size) {
+            return load ? std::span<const std::byte>(ret.lsu.rdt) : std::span<const std::byte>(read(adr, size));
+        };
+
+        RET pred;
+        Kind kind = Kind::retired;
+        if (ISS::execute(core, read, value, pred) && ISS::same(pred, ret)) {
+            kind = Kind::end;  // nothing to log
+            if (load) {
+                // loads from memory shared between harts are always logged,
+                // since harts are reconstructed independently
+                const bool shared = (m_sys.harts() > 1) && !core.contains(pred.lsu.adr);
+                const auto mem { read(pred.lsu.adr, ret.lsu.rdt.size()) };
+                if (shared || !std::ranges::equal(mem, ret.lsu.rdt))  kind = Kind::load;
+            }
+        }
+
+        switch (kind) {
+            case Kind::load:
+                writeRecord(m_file, {kind, static_cast<std::uint8_t>(hart), m_count[hart]});
+                writeBytes(m_file, ret.lsu.rdt);
+                m_logged++;
+                break;
+            case Kind::retired:
+                writeRecord(m_file, {kind, static_cast<std::uint8_t>(hart), m_count[hart]});
+                writeRetired(m_file, ret);
+                m_logged++;
+                break;
+            default: break;
+        }
+
+        // follow the DUT
+        m_count[hart]++;
+        m_sys.push(hart, std::move(ret));
+        m_sys.seek(m_sys.size());
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // reader
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Load a trace into the shadow, the shadow is left at the trace start.
+    // Instructions are reconstructed by the ISS from the shadow state, which
+    // follows the trace end while loading (initial state records come first),
+    // harts are interleaved in the order their records were written.
+    // Without 'instructions' only the initial state is loaded (records are skipped).
+    template <typename XLEN, typename FLEN, typename VLEN, typename SYS>
+    void load (const std::string& filename, SYS& sys, const bool instructions = true) {
+        using ISS = shadow::Iss<XLEN, FLEN, VLEN>;
+        using RET = Retired<XLEN, FLEN, VLEN>;
+
+        std::ifstream file { filename, std::ios::binary };
+        if (!file)  throw std::runtime_error("can not open trace file " + filename);
+        const Header hdr { readHeader(file) };
+        if (hdr.version != VERSION)          throw std::runtime_error("unsupported trace file version");
+        if (hdr.xlen != 8*sizeof(XLEN))      throw std::runtime_error("trace file XLEN mismatch");
+        if (hdr.harts > sys.harts())         throw std::runtime_error("trace file has more harts than the shadow");
+
+        std::vector<std::uint64_t> count (sys.harts(), 0);
+        std::int64_t time = 0;
+
+        // append retired instruction to the trace and replay it
+        auto retire = [&](const std::size_t hart, RET&& ret) {
+            ret.time = time++;
+            count[hart]++;
+            sys.push(hart, std::move(ret));
+            sys.forward();
+        };
+        // re-execute instructions until the hart counter reaches the next record
+        auto expand = [&](const std::size_t hart, const std::uint64_t until) {
+            const rsp::ThreadId thread { 1, static_cast<int>(hart)+1 };
+            auto read = [&](const XLEN adr, const std::size_t size) { return sys.mem_read(thread, adr, size); };
+            while (count[hart] < until) {
+                RET ret;
+                if (!ISS::execute(sys.m_cores[hart], read, read, ret)) {
+                    throw std::runtime_error("trace reconstruction failed, instruction not modeled by the ISS");
+                }
+                retire(hart, std::move(ret));
+            }
+        };
+
+        Record rec;
+        while (readRecord(file, rec)) {
+            if (rec.hart >= hdr.harts)  throw std::runtime_error("trace file record with invalid hart");
+            const rsp::ThreadId thread { 1, static_cast<int>(rec.hart)+1 };
+            switch (rec.kind) {
+                case Kind::memory: {
+                    const XLEN addr { get<XLEN>(file) };
+                    auto data { readBytes(file) };
+                    sys.mem_write(thread, addr, data);
+                    break;
+                }
+                case Kind::registers: {
+                    auto data { readBytes(file) };
+                    sys.reg_writeAll(thread, data);
+                    break;
+                }
+                case Kind::load: {
+                    const auto data { readBytes(file) };
+                    if (!instructions)  break;
+                    expand(rec.hart, rec.count);
+                    auto read  = [&](const XLEN adr, const std::size_t size) { return sys.mem_read(thread, adr, size); };
+                    auto value = [&](const XLEN, const std::size_t) { return std::span<const std::byte>(data); };
+                    RET ret;
+                    if (!ISS::execute(sys.m_cores[rec.hart], read, value, ret)) {
+                        throw std::runtime_error("trace reconstruction failed, load not modeled by the ISS");
+                    }
+                    retire(rec.hart, std::move(ret));
+                    break;
+                }
+                case Kind::retired: {
+                    auto ret { readRetired<XLEN, FLEN, VLEN>(file) };
+                    if (!instructions)  break;
+                    expand(rec.hart, rec.count);
+                    retire(rec.hart, std::move(ret));
+                    break;
+                }
+                case Kind::end:
+                    if (instructions)  expand(rec.hart, rec.count);
+                    break;
+                default:
+                    throw std::runtime_error("trace file record of unknown kind");
+            }
+            if (!file)  throw std::runtime_error("trace file truncated");
+        }
+        // back to the initial state
+        sys.seek(0);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // retired instruction serialization
+    ///////////////////////////////////////////////////////////////////////////////
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    void writeRetired (std::ostream& os, const Retired<XLEN, FLEN, VLEN>& ret) {
+        // IFU
+        put<XLEN>(os, ret.ifu.adr);
+        put<XLEN>(os, ret.ifu.pcn);
+        writeBytes(os, ret.ifu.rdt);
+        put<std::uint8_t>(os, ret.ifu.ill);
+        // GPR
+        put<std::uint8_t>(os, ret.gpr.idx);
+        put<std::uint8_t>(os, ret.gpr.wdt.size());
+        for (const XLEN wdt : ret.gpr.wdt)  put<XLEN>(os, wdt);
+        // FPR/VEC/CSR
+        put(os, ret.fpr.idx);
+        put(os, ret.fpr.wdt);
+        put(os, ret.vec.idx);
+        put(os, ret.vec.wdt);
+        put(os, ret.csr.idx);
+        put(os, ret.csr.wdt);
+        // LSU (store revert data is reconstructed by replay)
+        put<XLEN>(os, ret.lsu.adr);
+        writeBytes(os, ret.lsu.rdt);
+        writeBytes(os, ret.lsu.wdt);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    Retired<XLEN, FLEN, VLEN> readRetired (std::istream& is) {
+        Retired<XLEN, FLEN, VLEN> ret { };
+        // IFU
+        ret.ifu.adr = get<XLEN>(is);
+        ret.ifu.pcn = get<XLEN>(is);
+        ret.ifu.rdt = readBytes(is);
+        ret.ifu.ill = get<std::uint8_t>(is);
+        // GPR
+        ret.gpr.idx = get<std::uint8_t>(is);
+        ret.gpr.wdt.resize(get<std::uint8_t>(is));
+        for (XLEN& wdt : ret.gpr.wdt)  wdt = get<XLEN>(is);
+        // FPR/VEC/CSR
+        ret.fpr.idx = get<decltype(ret.fpr.idx)>(is);
+        ret.fpr.wdt = get<decltype(ret.fpr.wdt)>(is);
+        ret.vec.idx = get<decltype(ret.vec.idx)>(is);
+        ret.vec.wdt = get<decltype(ret.vec.wdt)>(is);
+        ret.csr.idx = get<decltype(ret.csr.idx)>(is);
+        ret.csr.wdt = get<decltype(ret.csr.wdt)>(is);
+        // LSU
+        ret.lsu.adr = get<XLEN>(is);
+        ret.lsu.rdt = readBytes(is);
+        ret.lsu.wdt = readBytes(is);
+        return ret;
+    }
+
+}
@@ -0,0 +1,327 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB waveform import (VCD, FST) of a RVFI style retirement interface
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+
+// C++ includes
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <deque>
+#include <unordered_map>
+#include <fstream>
+#include <future>
+#include <ranges>
+#include <algorithm>
+#include <stdexcept>
+
+// FST reader (GTKWave 'fstapi')
+#ifdef HDLDB_FST
+#include <fstapi.h>
+#endif
+
+// HDLDB includes
+#include "Import.hpp"
+
+namespace trace {
+
+    // retirement interface signals
+    enum class Wave : std::size_t {
+        clock, valid, pc_rdata, pc_wdata, insn, trap, rd_addr, rd_wdata,
+        mem_addr, mem_rmask, mem_wmask, mem_rdata, mem_wdata,
+        count
+    };
+
+    constexpr std::array<std::string_view, static_cast<std::size_t>(Wave::count)> waveKeys {
+        "clock", "valid", "pc_rdata", "pc_wdata", "insn", "trap", "rd_addr", "rd_wdata",
+        "mem_addr", "mem_rmask", "mem_wmask", "mem_rdata", "mem_wdata"
+    };
+
+    // Mapping of retirement interface signals to waveform signal names,
+    // the default names are RVFI signals ('clock' is 'clk').
+    struct WaveMap {
+        std::string scope;  // hierarchical scope of signals (any scope if empty)
+        std::array<std::string, waveKeys.size()> names;
+
+        WaveMap () {
+            for (std::size_t i=0; i<waveKeys.size(); i++)  names[i] = "rvfi_" + std::string(waveKeys[i]);
+            names[static_cast<std::size_t>(Wave::clock)] = "clk";
+        }
+
+        // 'key=name,...' (for example 'clock=clk_i,valid=ret_vld')
+        void set (std::string_view map) {
+            for (const auto item : std::views::split(map, ',')) {
+                const std::string_view str { item };
+                const auto eq = str.find('=');
+                const auto it = std::ranges::find(waveKeys, str.substr(0, eq));
+                if (eq == std::string_view::npos || it == waveKeys.end()) {
+                    throw std::runtime_error("invalid waveform signal mapping " + std::string(str));
+                }
+                names[it - waveKeys.begin()] = str.substr(eq + 1);
+            }
+        }
+
+        // find the interface signal for a hierarchical waveform signal name
+        std::size_t match (std::string_view path) const {
+            for (std::size_t i=0; i<names.size(); i++) {
+                const std::string& name = names[i];
+                if (!path.ends_with(name))  continue;
+                const std::string_view head { path.substr(0, path.size() - name.size()) };
+                if (scope.empty() ? (head.empty() || head.ends_with('.')) : (head == scope + ".")) return i;
+            }
+            return waveKeys.size();
+        }
+    };
+
+    // The state of all signals at the end of the previous timestamp is kept,
+    // on a rising clock edge the signals are sampled from it (before the edge).
+    template <typename XLEN, typename FLEN, typename VLEN>
+    class WaveSampler {
+        using Values = std::array<std::uint64_t, waveKeys.size()>;
+        Values m_cur  { };
+        Values m_last { };
+        bool   m_pcn;  // next PC signal is mapped
+
+        std::uint64_t last (const Wave sig) const { return m_last[static_cast<std::size_t>(sig)]; };
+    public:
+        WaveSampler (const bool pcn) : m_pcn(pcn) { };
+
+        void change (const std::size_t sig, const std::uint64_t val) { m_cur[sig] = val; };
+
+        // end of a timestamp
+        template <typename FUNC>
+        void time (FUNC&& consume) {
+            constexpr std::size_t clk = static_cast<std::size_t>(Wave::clock);
+            if (!m_last[clk] && m_cur[clk] && last(Wave::valid)) {
+                const RvfiPacket pkt {
+                    .order     = 0,
+                    .pc_rdata  = last(Wave::pc_rdata),
+                    .pc_wdata  = last(Wave::pc_wdata),
+                    .insn      = last(Wave::insn),
+                    .rs1_data  = 0,
+                    .rs2_data  = 0,
+                    .rd_wdata  = last(Wave::rd_wdata),
+                    .mem_addr  = last(Wave::mem_addr),
+                    .mem_rdata = last(Wave::mem_rdata),
+                    .mem_wdata = last(Wave::mem_wdata),
+                    .mem_rmask = static_cast<std::uint8_t>(last(Wave::mem_rmask)),
+                    .mem_wmask = static_cast<std::uint8_t>(last(Wave::mem_wmask)),
+                    .rs1_addr  = 0,
+                    .rs2_addr  = 0,
+                    .rd_addr   = static_cast<std::uint8_t>(last(Wave::rd_addr)),
+                    .trap      = static_cast<std::uint8_t>(last(Wave::trap)),
+                    .halt      = 0,
+                    .intr      = 0
+                };
+                auto imp { fromRvfi<XLEN, FLEN, VLEN>(pkt) };
+                imp.pcn = m_pcn;
+                consume(std::move(imp));
+            }
+            m_last = m_cur;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // VCD
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // value change of a mapped signal (or a timestamp)
+    struct VcdChange {
+        static constexpr std::uint32_t TIME = ~std::uint32_t{0};
+        std::uint32_t sig;
+        std::uint64_t val;
+    };
+
+    // parse value changes in a block of lines (only mapped signals are kept)
+    inline std::vector<VcdChange> parseVcd (std::string_view text, const std::unordered_map<std::string, std::uint32_t>& ids) {
+        std::vector<VcdChange> changes;
+        auto lookup = [&](std::string_view id) -> std::uint32_t {
+            const auto it = ids.find(std::string(id));
+            return (it == ids.end()) ? VcdChange::TIME : it->second;
+        };
+        while (!text.empty()) {
+            const std::size_t end = std::min(text.find('\n'), text.size());
+            std::string_view line { text.substr(0, end) };
+            text.remove_prefix(std::min(end + 1, text.size()));
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' '))  line.remove_suffix(1);
+            if (line.empty())  continue;
+            switch (line[0]) {
+                case '#':
+                    changes.push_back({VcdChange::TIME, 0});
+                    break;
+                case '0': case '1': case 'x': case 'X': case 'z': case 'Z':
+                    if (const auto sig = lookup(line.substr(1)); sig != VcdChange::TIME)  changes.push_back({sig, line[0] == '1'});
+                    break;
+                case 'b': case 'B': {
+                    const std::size_t sp = line.find(' ');
+                    if (sp == std::string_view::npos)  break;
+                    const auto sig = lookup(line.substr(sp + 1));
+                    if (sig == VcdChange::TIME)  break;
+                    // unknown bits read as 0
+                    std::uint64_t val = 0;
+                    for (const char c : line.substr(1, sp - 1))  val = (val << 1) | (c == '1');
+                    changes.push_back({sig, val});
+                    break;
+                }
+                default: break;  // real values, keywords
+            }
+        }
+        return changes;
+    }
+
+    // The header is parsed sequentially, value changes are parsed in parallel
+    // in blocks of lines and applied to the sampler in file order.
+    template <typename XLEN, typename FLEN, typename VLEN, typename FUNC>
+    void readVcd (const std::string& filename, const WaveMap& map, const unsigned threads, FUNC&& consume) {
+        constexpr std::size_t CHUNK = 4 << 20;
+
+        std::ifstream file { filename, std::ios::binary };
+        if (!file)  throw std::runtime_error("can not open VCD file " + filename);
+
+        // header (declarations)
+        std::unordered_map<std::string, std::uint32_t> ids;
+        std::array<bool, waveKeys.size()> found { };
+        std::vector<std::string> scope;
+        std::string tok;
+        while (file >> tok && tok != "$enddefinitions") {
+            if (tok == "$scope") {
+                std::string type, name;
+                file >> type >> name;
+                scope.push_back(name);
+            } else if (tok == "$upscope") {
+                if (!scope.empty())  scope.pop_back();
+            } else if (tok == "$var") {
+                std::string type, width, id, name;
+                file >> type >> width >> id >> name;
+                std::string path;
+                for (const auto& s : scope)  path += s + ".";
+                const std::size_t sig = map.match(path + name);
+                if (sig < waveKeys.size()) {
+                    ids.emplace(id, sig);
+                    found[sig] = true;
+                }
+            } else {
+                continue;
+            }
+            // skip to the end of the declaration
+            while (tok != "$end" && file >> tok);
+        }
+        while (file >> tok && tok != "$end");
+        for (const auto sig : {Wave::clock, Wave::valid, Wave::pc_rdata, Wave::insn}) {
+            if (!found[static_cast<std::size_t>(sig)]) {
+                throw std::runtime_error("VCD file does not contain signal " + map.names[static_cast<std::size_t>(sig)]);
+            }
+        }
+
+        WaveSampler<XLEN, FLEN, VLEN> sampler { found[static_cast<std::size_t>(Wave::pc_wdata)] };
+        std::deque<std::future<std::vector<VcdChange>>> pending;
+        auto drain = [&](const std::size_t limit) {
+            while (pending.size() > limit) {
+                for (const auto& chg : pending.front().get()) {
+                    if (chg.sig == VcdChange::TIME)  sampler.time(consume);
+                    else                             sampler.change(chg.sig, chg.val);
+                }
+                pending.pop_front();
+            }
+        };
+        std::string rest;
+        while (file) {
+            std::string text { std::move(rest) };
+            const std::size_t size = text.size();
+            text.resize(size + CHUNK);
+            file.read(text.data() + size, CHUNK);
+            text.resize(size + file.gcount());
+            const std::size_t last = text.rfind('\n');
+            if (file && last != std::string::npos) {
+                rest = text.substr(last + 1);
+                text.resize(last + 1);
+            }
+            pending.push_back(std::async(std::launch::async, [text = std::move(text), &ids] {
+                return parseVcd(text, ids);
+            }));
+            drain(2 * std::max(threads, 1u));
+        }
+        drain(0);
+        // the last timestamp
+        sampler.time(consume);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    // FST
+    ///////////////////////////////////////////////////////////////////////////////
+
+#ifdef HDLDB_FST
+    // value changes are delivered by the FST library in time order
+    template <typename XLEN, typename FLEN, typename VLEN, typename FUNC>
+    void readFst (const std::string& filename, const WaveMap& map, FUNC&& consume) {
+        void* ctx = fstReaderOpen(filename.c_str());
+        if (ctx == nullptr)  throw std::runtime_error("can not open FST file " + filename);
+
+        // map signal handles (handles are 1 based)
+        std::vector<std::uint32_t> handles (fstReaderGetMaxHandle(ctx) + 1, VcdChange::TIME);
+        std::array<bool, waveKeys.size()> found { };
+        std::vector<std::string> scope;
+        fstReaderIterateHierRewind(ctx);
+        while (const struct fstHier* h = fstReaderIterateHier(ctx)) {
+            switch (h->htyp) {
+                case FST_HT_SCOPE:
+                    scope.emplace_back(h->u.scope.name, h->u.scope.name_length);
+                    break;
+                case FST_HT_UPSCOPE:
+                    if (!scope.empty())  scope.pop_back();
+                    break;
+                case FST_HT_VAR: {
+                    std::string path;
+                    for (const auto& s : scope)  path += s + ".";
+                    std::string_view name { h->u.var.name, h->u.var.name_length };
+                    name = name.substr(0, name.find(' '));  // strip range
+                    const std::size_t sig = map.match(path + std::string(name));
+                    if (sig < waveKeys.size()) {
+                        handles[h->u.var.handle] = sig;
+                        found[sig] = true;
+                        fstReaderSetFacProcessMask(ctx, h->u.var.handle);
+                    }
+                    break;
+                }
+                default: break;
+            }
+        }
+        if (!found[static_cast<std::size_t>(Wave::clock)] || !found[static_cast<std::size_t>(Wave::valid)]) {
+            fstReaderClose(ctx);
+            throw std::runtime_error("FST file does not contain the retirement interface signals");
+        }
+
+        struct Context {
+            WaveSampler<XLEN, FLEN, VLEN>     sampler;
+            const std::vector<std::uint32_t>& handles;
+            FUNC&                             consume;
+            std::uint64_t                     time;
+            bool                              started;
+        } user { WaveSampler<XLEN, FLEN, VLEN>{found[static_cast<std::size_t>(Wave::pc_wdata)]}, handles, consume, 0, false };
+
+        auto callback = [](void* data, std::uint64_t time, fstHandle handle, const unsigned char* value) {
+            auto& ctx = *static_cast<Context*>(data);
+            if (ctx.started && time != ctx.time)  ctx.sampler.time(ctx.consume);
+            ctx.time    = time;
+            ctx.started = true;
+            std::uint64_t val = 0;
+            for (; *value; value++)  val = (val << 1) | (*value == '1');
+            ctx.sampler.change(ctx.handles[handle], val);
+        };
+        fstReaderIterBlocks(ctx, callback, &user, nullptr);
+        user.sampler.time(consume);
+        fstReaderClose(ctx);
+    }
+#endif
+
+}
@@ -9,6 +9,7 @@
 // C++ includes
 #include <print>
 #include <memory>
+#include <cstdlib>
 
 // C++ libraries
 #include <cxxopts.hpp>
@@ -27,9 +28,12 @@ int main(int argc, char* argv[]) {
         ("s,socket", "UNIX socket", cxxopts::value<std::string>()->default_value("unix-socket"))
         ("i,input", "HDL simulation trace record input file name", cxxopts::value<std::string>())
         ("o,output", "HDLDB processed trace output file name", cxxopts::value<std::string>())
+        ("verify", "Check the processed trace against a full hash of the input trace", cxxopts::value<bool>()->default_value("false"))
+        ("n,harts", "Number of harts (RSP threads)", cxxopts::value<std::size_t>()->default_value("1"))
+        ("stats", "Print server statistics on exit", cxxopts::value<bool>()->default_value("false"))
+        ("timeline", "Chrome trace event JSON file of server activity (written on detach)", cxxopts::value<std::string>())
     ;
 
-    SystemHdlDb shadow { };
     std::unique_ptr<ProtocolHdlDb> protocol;
 
     try {
@@ -38,16 +42,37 @@ int main(int argc, char* argv[]) {
             std::print("{}", options.help());
             return 0;
         }
+        // the server exits on the 'kill' packet
+        if (result["stats"].as<bool>()) {
+            std::atexit([] { std::print("{}", rsp::stats().report()); });
+        }
+        if (result.count("timeline")) {
+            rsp::timeline().enable(result["timeline"].as<std::string>());
+        }
+        // DUT shadow with the given number of harts
+        SystemHdlDb shadow { result["harts"].as<std::size_t>() };
+        // reconstruct the recorded trace
+        if (result.count("input")) {
+            const std::string input { result["input"].as<std::string>() };
+            // the processed trace (sidecar) is reused if it belongs to the same trace
+            if (result.count("output")) {
+                const bool cached = trace::open<XlenHdlDb, FlenHdlDb, VlenHdlDb>(input, result["output"].as<std::string>(), shadow, result["verify"].as<bool>());
+                std::println("{} processed trace file.", cached ? "Reused" : "Written");
+            } else {
+                trace::load<XlenHdlDb, FlenHdlDb, VlenHdlDb>(input, shadow);
+            }
+            std::println("Loaded {} retired instructions from trace.", shadow.size());
+        }
         // if port is defined, open TCP socket port, otherwise
         // use a defined or default UNIX socket name
         if (result.count("port")) {
             std::uint16_t socket_port = result["port"].as<std::uint16_t>();
-            protocol = std::make_unique<ProtocolHdlDb>(socket_port, shadow);
+            protocol = std::make_unique<ProtocolHdlDb>(socket_port, std::move(shadow));
             std::println("Server will listen on TCP port {}.", socket_port);
         } else {
             std::string socket_name = result["socket"].as<std::string>();
             std::println("Server will listen on TCP port {}.", socket_name);
-            protocol = std::make_unique<ProtocolHdlDb>(socket_name, shadow);
+            protocol = std::make_unique<ProtocolHdlDb>(socket_name, std::move(shadow));
         }
     } catch (const std::exception& e) {
         std::cerr << "Error parsing options: " << e.what() << std::endl;
@@ -19,6 +19,8 @@
 #include "Registers.hpp"
 #include "System.hpp"
 #include "Protocol.hpp"
+#include "Trace.hpp"
+#include "Index.hpp"
 
 
 // 32/64 bit selection
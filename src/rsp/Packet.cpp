@@ -31,20 +31,26 @@
 
 // HDLDB includes
 #include "Packet.hpp"
+#include "Timeline.hpp"
 
 namespace rsp {
 
-    void Packet::log (std::string_view packet_data) const {
-        std::cout << packet_data;
+    // the payload is not copied into a formatted string
+    void Packet::log (std::string_view direction, std::string_view packet_data) const {
+        std::cout << "REMOTE: " << direction << " " << packet_data << "\n";
     }
 
     std::string_view Packet::rx (bool acknowledge) {
         ssize_t status;
         size_t size = 0;
-        do {
+        // the timeline starts after the first bytes arrive (without the wait for the client)
+        status = recv({m_buffer.data(), m_buffer.size()}, 0);
+        size += status;
+        TimelineScope scope { "rx" };
+        while (size < 3 || m_buffer[size-3] != static_cast<std::byte>('#')) {
             status = recv({m_buffer.data() + size, m_buffer.size() - size}, 0);
             size += status;
-        } while (m_buffer[size-3] != static_cast<std::byte>('#'));
+        }
 
         std::string_view packet { reinterpret_cast<char const*>(m_buffer.data()), static_cast<size_t>(size) };
         std::string_view packet_data     = packet.substr(1, size-4);
@@ -52,7 +58,7 @@ namespace rsp {
         int unsigned checksum_packet;
         auto [ptr, ec] = std::from_chars(packet_checksum.data(), packet_checksum.data()+2, checksum_packet, 16);
 
-        log(std::format("REMOTE: <- {}\n", packet_data));
+        log("<-", packet_data);
 
         // calculate payload checksum
         std::span payload { reinterpret_cast<uint8_t const*>(packet_data.data()), packet_data.size() };
@@ -68,23 +74,36 @@ namespace rsp {
         return packet_data;
     }
 
+    // The payload is sent in place between the '$' header and the '#xx' trailer
+    // (gather send), so the packet is never assembled in a separate buffer.
     void Packet::tx (std::string_view packet_data, bool acknowledge) const {
-        log(std::format("REMOTE: -> {}\n", packet_data));
+        TimelineScope scope { "tx", packet_data };
+        log("->", packet_data);
 
         // calculate payload checksum
         std::span payload { reinterpret_cast<uint8_t const*>(packet_data.data()), packet_data.size() };
         uint8_t checksum { static_cast<uint8_t>(std::accumulate(cbegin(payload), cend(payload), 0)) };
 
-        // format packet
-        std::string packet { std::format("${}#{:02x}", packet_data, checksum) };
+        // packet framing
+        static constexpr char hex [] = "0123456789abcdef";
+        char header  [1] { '$' };
+        char trailer [3] { '#', hex[checksum >> 4], hex[checksum & 0xf] };
+        std::array<iovec, 3> iov {{
+            { header                              , sizeof(header)     },
+            { const_cast<char*>(packet_data.data()), packet_data.size() },
+            { trailer                             , sizeof(trailer)    }
+        }};
 
-        // send packet
-        ssize_t status;
-        size_t size = 0;
-        do {
-            status = send({ reinterpret_cast<std::byte const*>(packet.data() + size), packet.size() - size }, 0);
-            size += status;
-        } while (size < packet.size());
+        // send packet (continue after partial sends)
+        std::size_t i = 0;
+        while (i < iov.size()) {
+            std::size_t status = send(std::span(iov).subspan(i), 0);
+            for (; i < iov.size() && status >= iov[i].iov_len; i++)  status -= iov[i].iov_len;
+            if (i < iov.size()) {
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + status;
+                iov[i].iov_len -= status;
+            }
+        }
 
         // check acknowledge
         if (acknowledge) {
@@ -29,7 +29,7 @@ namespace rsp {
         std::string m_log;
 
         // logging
-        void log(std::string_view) const;
+        void log(std::string_view direction, std::string_view packet_data) const;
 
     public:
         // constructor
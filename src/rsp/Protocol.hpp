@@ -8,23 +8,34 @@
 
 #pragma once
 
+// C includes
+#include <cstring>
+#include <cctype>
+
 // C++ includes
 #include <numeric>
+#include <array>
 #include <string>
 #include <string_view>
 #include <map>
 #include <iostream>
 #include <print>
-#include <sstream>
 #include <spanstream> // TODO: learn to use this
 #include <vector>
 #include <set>
 #include <ranges>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 
 // HDLDB includes
 #include <rsp.hpp>
 #include <Packet.hpp>
 #include <Points.hpp>
+#include <AgentExpr.hpp>
+#include <Stats.hpp>
+#include <Timeline.hpp>
+#include <Speculative.hpp>
 
 namespace rsp {
 
@@ -53,14 +64,37 @@ namespace rsp {
             {"multiprocess"   , "-"},
             {"ReverseStep"    , "+"},
             {"ReverseContinue", "+"},
-            {"QStartNoAckMode", "+"}
+            {"QStartNoAckMode", "+"},
+            {"ConditionalBreakpoints", "+"},  // agent expressions are evaluated on Z0/Z1 hits
+            {"BreakpointCommands"    , "+"},  // target side 'dprintf' (agent 'printf' bytecode)
+            {"ConditionalTracepoints", "+"},
+            {"EnableDisableTracepoints", "+"},
+            {"qXfer:features:read"  , "+"},
+            {"qXfer:memory-map:read", "+"},
+            {"Qbtrace:bts"          , "+"},  // branch trace (from the recorded trace)
+            {"Qbtrace:off"          , "+"},
+            {"Qbtrace-conf:bts:size", "+"},
+            {"qXfer:btrace:read"    , "+"},
+            {"qXfer:btrace-conf:read", "+"}
         };
         std::map<std::string, std::string> m_features_client { };
 
         std::map<char, ThreadId> m_operation { };
 
+        // tracepoint upload iterator (qTfP/qTsP)
+        std::size_t m_trace_upload = 0;
+
+        // qXfer object generated on the first chunk read
+        std::string m_xfer;
+
+        // transmit buffer reused by hex encoded responses (no allocation once grown)
+        std::string m_tx;
+
         SHADOW m_shadow;
 
+        // responses precomputed after a stop (destroyed before the shadow)
+        Speculative m_spec;
+
     public:
         // constructor/destructor
         Protocol (std::string_view name, SHADOW shadow);
@@ -72,9 +106,11 @@ namespace rsp {
         void tx (std::string_view);
 
         // conversion
+        bool                   ishex   (std::string_view hex) const;
         std::vector<std::byte> hex2bin (std::string_view hex) const;
         std::string            hex2str (std::string_view hex) const;
         std::string            bin2hex (std::span<std::byte> bin) const;
+        void                   bin2hex (std::string& hex, std::span<const std::byte> bin) const;
         std::string            str2hex (std::string_view str) const;
 
         // packet parsers
@@ -88,12 +124,16 @@ namespace rsp {
         void thread      (std::string_view packet);
         void signal      (std::string_view packet);
 
+        bool run_resume  (std::string_view packet);
         void run_step    (std::string_view packet);
         void run_continue(std::string_view packet);
         void run_backward(std::string_view packet);
+        void run_vcont   (std::string_view packet);
         void reset       ();
 
         void query       (std::string_view packet);
+        void tracepoint  (std::string_view packet);
+        void btrace      (std::string_view packet);
         void verbose     (std::string_view packet);
         void extended    ();
         void detach      ();
@@ -106,8 +146,8 @@ namespace rsp {
         void loop ();
 
         void rsp_signal          ();
-        void stop_reply          (int index = -1, XLEN value = 0,  // register
-                                  ThreadId thread = {1, -1}, int core = -1);  // thread/core
+        void stop_reply          ();
+        void speculate           ();
         void error_number_reply  (std::uint8_t value);
         void error_text_reply    (std::string_view text = "");
         void error_lldb_reply    (std::uint8_t value = 0, std::string_view text = "");
@@ -117,6 +157,9 @@ namespace rsp {
         void query_supported     (std::string_view);
         void query_monitor       (std::string_view);
         void query_monitor_reply (std::string_view);
+        void query_monitor_writer(std::string_view);
+        void query_xfer          (std::string_view, std::string_view);
+        void trace_frame         (int frame);
 
         std::string thread_format (ThreadId threadId);
         ThreadId thread_scan (std::string_view str);
@@ -131,13 +174,13 @@ namespace rsp {
     template <typename XLEN, typename SHADOW>
     Protocol<XLEN, SHADOW>::Protocol (std::string_view name, SHADOW shadow) :
         Packet(name),
-        m_shadow(shadow)
+        m_shadow(std::move(shadow))
     { }
 
     template <typename XLEN, typename SHADOW>
     Protocol<XLEN, SHADOW>::Protocol (std::uint16_t port, SHADOW shadow) :
         Packet(port),
-        m_shadow(shadow)
+        m_shadow(std::move(shadow))
     { }
 
     template <typename XLEN, typename SHADOW>
@@ -149,11 +192,15 @@ namespace rsp {
 
     template <typename XLEN, typename SHADOW>
     std::string_view Protocol<XLEN, SHADOW>::rx () {
-        return Packet::rx(!m_state.startNoAckMode);
+        std::string_view packet { Packet::rx(!m_state.startNoAckMode) };
+        // payload with '$' and '#xx' framing
+        stats().m_bytes_rx.add(packet.size() + 4);
+        return packet;
     }
 
     template <typename XLEN, typename SHADOW>
     void Protocol<XLEN, SHADOW>::tx (std::string_view packet) {
+        stats().m_bytes_tx.add(packet.size() + 4);
         Packet::tx(packet, !m_state.startNoAckMode);
     }
 
@@ -161,45 +208,62 @@ namespace rsp {
     // conversion
     ////////////////////////////////////////
 
+    // even number of hexadecimal digits
+    template <typename XLEN, typename SHADOW>
+    bool Protocol<XLEN, SHADOW>::ishex (std::string_view hex) const {
+        return (hex.size() % 2 == 0) && std::ranges::all_of(hex, [](const char ch) { return std::isxdigit(static_cast<unsigned char>(ch)) != 0; });
+    }
+
     template <typename XLEN, typename SHADOW>
     std::vector<std::byte> Protocol<XLEN, SHADOW>::hex2bin (std::string_view hex) const {
         std::vector<std::byte> bin ( hex.size()/2 );
-//        for (size_t i = 0; i < hex.length(); i += 2) {
-//            std::string_view str = hex.substr(i, 2);
-//            std::byte byte = static_cast<std::byte>(std::stoi(str.data(), nullptr, 16));
-//            bin.push_back(byte);
-//        }
+        for (size_t i = 0; i < bin.size(); i++) {
+            std::uint8_t byte = 0;
+            auto [ptr, ec] = std::from_chars(hex.data() + 2*i, hex.data() + 2*i + 2, byte, 16);
+            // invalid digits decode as 0 (packets are checked with 'ishex' first)
+            if (ec != std::errc{} || ptr != hex.data() + 2*i + 2)  byte = 0;
+            bin[i] = static_cast<std::byte>(byte);
+        }
         return bin;
     }
 
     template <typename XLEN, typename SHADOW>
     std::string Protocol<XLEN, SHADOW>::hex2str (std::string_view hex) const {
         std::string str ( hex.size()/2, ' ' );
-//        for (size_t i = 0; i < hex.length(); i += 2) {
-//            std::string_view str = hex.substr(i, 2);
-//            std::byte byte = static_cast<std::byte>(std::stoi(str.data(), nullptr, 16));
-//            bin.push_back(byte);
-//        }
+        for (size_t i = 0; i < str.size(); i++) {
+            std::uint8_t byte = 0;
+            auto [ptr, ec] = std::from_chars(hex.data() + 2*i, hex.data() + 2*i + 2, byte, 16);
+            if (ec != std::errc{} || ptr != hex.data() + 2*i + 2)  byte = 0;
+            str[i] = static_cast<char>(byte);
+        }
         return str;
     }
 
     template <typename XLEN, typename SHADOW>
     std::string Protocol<XLEN, SHADOW>::bin2hex (std::span<std::byte> bin) const {
-        std::ostringstream hex;
-        for (auto& element: bin) {
-            hex << std::format("{:02x}", static_cast<uint8_t>(element));
-        }
-        std::string str { hex.str() };
+        std::string str;
+        bin2hex(str, bin);
         return str;
     }
 
+    // append to a (reused) buffer
     template <typename XLEN, typename SHADOW>
-    std::string Protocol<XLEN, SHADOW>::str2hex (std::string_view str) const {
-        std::ostringstream hex;
-        for (auto& element: str) {
-            hex << std::format("{:02x}", element);
+    void Protocol<XLEN, SHADOW>::bin2hex (std::string& hex, std::span<const std::byte> bin) const {
+        static constexpr char digit [] = "0123456789abcdef";
+        const std::size_t size = hex.size();
+        hex.resize(size + 2*bin.size());
+        char* ptr = hex.data() + size;
+        for (const auto element: bin) {
+            *ptr++ = digit[std::to_integer<std::uint8_t>(element) >> 4];
+            *ptr++ = digit[std::to_integer<std::uint8_t>(element) & 0xf];
         }
-        return hex.str();
+    }
+
+    template <typename XLEN, typename SHADOW>
+    std::string Protocol<XLEN, SHADOW>::str2hex (std::string_view str) const {
+        std::string hex;
+        bin2hex(hex, std::as_bytes(std::span(str)));
+        return hex;
     }
 
     ///////////////////////////////////////
@@ -213,52 +277,96 @@ namespace rsp {
         stop_reply();
     }
 
-    // TODO: Send a exception packet "T <value>"
+    // registers sent with each stop reply, so GDB does not need a 'g' packet
+    // to show the current location and unwind the first frame (PC, SP, RA, FP)
+    constexpr std::array<unsigned int, 4> EXPEDITED { 32, 2, 1, 8 };
+
+    // stop reply 'T' packet with expedited registers, thread and stop reason
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/Stop-Reply-Packets.html
     template <typename XLEN, typename SHADOW>
-    void Protocol<XLEN, SHADOW>::stop_reply (int index, XLEN value,  // register
-                                             ThreadId thread, int core)  // thread/core
+    void Protocol<XLEN, SHADOW>::stop_reply ()
     {
-        // reply with signal/register/thread/core/reason
-        std::string str { std::format("T{:02x}", m_shadow.m_core.m_signal) };
-//          // register
-//        if (index != -1) {
-//            switch (sizeof(XLEN)*8) {
-//                case 32: str += std::format(";{:0x}:P{:08x}", index, value);
-//                case 64: str += std::format(";{:0x}:P{:016x}", index, value);
-//            }
-//        }
-//        // thread
-//        if (thread.pid != -1) {
-//            str += std::format(";thread:{}", thread_format(thread));
-//        }
-//        // core
-//        if (core != -1) {
-//            str += std::format(";core:{:x}", core);
-//        }
-//        // reason
-//        switch (m_shadow.m_core.m_reason.type) {
-//            case rsp::PointType::watch:
-//                str += std::format(";{}:{:x}", "watch", m_shadow.ret.lsu.adr);
-//                break;
-//            case rsp::PointType::rwatch:
-//                str += std::format(";{}:{:x}", "rwatch", m_shadow.ret.lsu.adr);
-//                break;
-//            case rsp::PointType::awatch:
-//                str += std::format(";{}:{:x}", "awatch", m_shadow.ret.lsu.adr);
-//                break;
-//            case rsp::PointType::swbreak:
-//                str += std::format(";{}:", "swbreak");
-//                break;
-//            case rsp::PointType::hwbreak:
-//                str += std::format(";{}:", "hwbreak");
-//                break;
-//            case rsp::PointType::replaylog:
-//                str += std::format(";{}:{}", "replaylog", m_shadow.cnt == 0 ? "begin" : "end");
-//                break;
-//        }
+        // replay statistics are accumulated by the shadow during a run
+        m_shadow.statsFlush();
+        // breakpoint command output is console output of the resumed target
+        if (!m_shadow.m_console.empty()) {
+            tx("O" + str2hex(m_shadow.m_console));
+            m_shadow.m_console.clear();
+        }
+        // all-stop, the thread is the hart which caused the stop
+        const ThreadId thread { 1, static_cast<int>(m_shadow.m_hart) + 1 };
+        // signal
+        std::string str { std::format("T{:02x}", m_shadow.stopped().m_signal) };
+        // expedited registers (target byte order)
+        for (const auto regnum : EXPEDITED) {
+            auto val { m_shadow.reg_readOne(thread, regnum) };
+            if (!val.empty()) {
+                str += std::format("{:x}:{};", regnum, bin2hex(val));
+            }
+        }
+        // thread
+        str += std::format("thread:{};", thread_format(thread));
+        // reason
+        const auto reason { m_shadow.stopped().m_reason };
+        switch (reason.type) {
+            case rsp::PointType::watch:
+                str += std::format("watch:{:x};", m_shadow.stopped().m_reason_addr);
+                break;
+            case rsp::PointType::rwatch:
+                str += std::format("rwatch:{:x};", m_shadow.stopped().m_reason_addr);
+                break;
+            case rsp::PointType::awatch:
+                str += std::format("awatch:{:x};", m_shadow.stopped().m_reason_addr);
+                break;
+            case rsp::PointType::swbreak:
+                if (m_features_client["swbreak"] == "+")  str += "swbreak:;";
+                break;
+            case rsp::PointType::hwbreak:
+                if (m_features_client["hwbreak"] == "+")  str += "hwbreak:;";
+                break;
+            case rsp::PointType::replaylog:
+                str += std::format("replaylog:{};", m_shadow.count() == 0 ? "begin" : "end");
+                break;
+            default:
+                break;
+        }
         tx(str);
-    //    // reply with signal (current signal by default)
-    //    tx(std::format("S{:02x}", m_shadow.signal));
+        speculate();
+    }
+
+    // memory windows around PC (prologue analysis, disassembly) and above SP (frame unwinding)
+    constexpr std::size_t SPEC_PC_BEFORE = 256;
+    constexpr std::size_t SPEC_PC_AFTER  = 64;
+    constexpr std::size_t SPEC_STACK     = 512;
+
+    // precompute the responses GDB asks for after a stop
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::speculate ()
+    {
+        m_spec.start([this] (std::stop_token cancel) {
+            TimelineScope scope { "speculate" };
+            const ThreadId thread { 1, static_cast<int>(m_shadow.m_hart) + 1 };
+            Speculative::Responses res { m_shadow.count(), m_shadow.m_hart, bin2hex(m_shadow.reg_readAll(thread)), {} };
+            // register value (target byte order is little endian)
+            auto reg = [&](const unsigned int regnum) {
+                XLEN val = 0;
+                auto data { m_shadow.reg_readOne(thread, regnum) };
+                std::memcpy(&val, data.data(), std::min(data.size(), sizeof(XLEN)));
+                return val;
+            };
+            // only memory blocks are read, reading I/O would modify the shadow
+            auto window = [&](const XLEN addr, const std::size_t before, const std::size_t after) {
+                if (cancel.stop_requested())  return;
+                const auto [base, end] { m_shadow.mem_block(thread, addr) };
+                if (base == end)  return;
+                const XLEN lo = (addr - base > before) ? static_cast<XLEN>(addr - before) : base;
+                const XLEN hi = (end  - addr > after ) ? static_cast<XLEN>(addr + after ) : end;
+                res.mem.push_back({lo, bin2hex(m_shadow.mem_read(thread, lo, hi - lo))});
+            };
+            window(reg(32), SPEC_PC_BEFORE, SPEC_PC_AFTER);
+            window(reg(2) , 0             , SPEC_STACK   );
+            return res;
+        });
     }
 
     // send ERROR number reply (GDB only)
@@ -335,51 +443,100 @@ namespace rsp {
     // https://sourceware.org/gdb/current/onlinedocs/gdb.html/General-Query-Packets.html#General-Query-Packets
     template <typename XLEN, typename SHADOW>
     void Protocol<XLEN, SHADOW>::query_monitor (std::string_view str) {
-        switch (std::hash<std::string_view>{}(str)) {
+        // commands with arguments
+        if (str.starts_with("writer ")) {
+            query_monitor_writer(str.substr(7));
+            return;
+        }
+        // the hash is a character sum, each case confirms the exact command
+        switch (lit2hash(str)) {
             case lit2hash("help"):
+                if (str != "help")  break;
                 query_monitor_reply("HELP: Available monitor commands:\n"
                     "* 'set remote log on/off',\n"
                     "* 'set waveform dump on/off',\n"
                     "* 'set memory=dut/shadow' (reading memories from dut/shadow, default is shadow),\n"
                     "* 'reset assert' (assert reset for a few clock periods),\n"
-                    "* 'reset release' (synchronously release reset).");
-                break;
+                    "* 'reset release' (synchronously release reset),\n"
+                    "* 'stats' (server statistics),\n"
+                    "* 'stats reset' (clear server statistics),\n"
+                    "* 'writer ADDR' (last store to ADDR before the current trace position).");
+                return;
             case lit2hash("set remote log on"):
+                if (str != "set remote log on")  break;
                 m_state.remote_log = true;
                 query_monitor_reply("Enabled remote logging to STDOUT.\n");
-                break;
+                return;
             case lit2hash("set remote log off"):
+                if (str != "set remote log off")  break;
                 m_state.remote_log = false;
                 query_monitor_reply("Disabled remote logging.\n");
-                break;
+                return;
             case lit2hash("set waveform dump on"):
+                if (str != "set waveform dump on")  break;
 //                $dumpon;
                 query_monitor_reply("Enabled waveform dumping.\n");
-                break;
+                return;
             case lit2hash("set waveform dump off"):
+                if (str != "set waveform dump off")  break;
 //                $dumpoff;
                 query_monitor_reply("Disabled waveform dumping.\n");
-                break;
+                return;
             case lit2hash("set memory=dut"):
+                if (str != "set memory=dut")  break;
                 m_state.dut_memory = true;
                 query_monitor_reply("Reading memory directly from DUT.\n");
-                break;
+                return;
             case lit2hash("set memory=shadow"):
+                if (str != "set memory=shadow")  break;
                 m_state.dut_memory = false;
                 query_monitor_reply("Reading memory from shadow copy.\n");
-                break;
+                return;
             case lit2hash("reset assert"):
+                if (str != "reset assert")  break;
 //                dut_reset_assert;
                 // TODO: rethink whether to reset the shadow or keep it
                 //shd = new();
                 query_monitor_reply("DUT reset asserted.\n");
-                break;
+                return;
             case lit2hash("reset release"):
+                if (str != "reset release")  break;
 //                dut_reset_release;
                 query_monitor_reply("DUT reset released.\n");
-                break;
+                return;
+            case lit2hash("stats"):
+                if (str != "stats")  break;
+                m_shadow.statsFlush();
+                query_monitor_reply(stats().report());
+                return;
+            case lit2hash("stats reset"):
+                if (str != "stats reset")  break;
+                m_shadow.statsFlush();
+                stats().reset();
+                query_monitor_reply("Statistics cleared.\n");
+                return;
             default:
-                query_monitor_reply("'monitor' command was not recognized.\n");
+                break;
+        }
+        query_monitor_reply("'monitor' command was not recognized.\n");
+    }
+
+    // last store to an address (from the store index)
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::query_monitor_writer (std::string_view str) {
+        std::uint64_t addr;
+        const bool hex = str.starts_with("0x");
+        if (hex)  str.remove_prefix(2);
+        if (std::from_chars(str.data(), str.data() + str.size(), addr, hex ? 16 : 10).ec != std::errc{}) {
+            query_monitor_reply("Invalid address.\n");
+            return;
+        }
+        const auto positions { m_shadow.wrIndex(static_cast<XLEN>(addr)) };
+        const auto it { std::ranges::lower_bound(positions, m_shadow.count()) };
+        if (it == positions.begin()) {
+            query_monitor_reply(std::format("No store to 0x{:x} before trace position {}.\n", addr, m_shadow.count()));
+        } else {
+            query_monitor_reply(std::format("Last store to 0x{:x} at trace position {} ({} stores in trace).\n", addr, *std::prev(it), positions.size()));
         }
     }
 
@@ -420,6 +577,32 @@ namespace rsp {
         tx(std::views::join_with(response, ';') | std::ranges::to<std::string>());
     }
 
+    // reply with the 'offset,length' chunk of a qXfer object
+    // ('m' if there is more data, 'l' for the last chunk)
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::query_xfer (std::string_view data, std::string_view args) {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+        auto [ptr, ec] = std::from_chars(args.data(), args.data() + args.size(), offset, 16);
+        if ((ec != std::errc{}) || (ptr == args.data() + args.size()) || (*ptr != ',')) {
+            error_number_reply(0);
+            return;
+        }
+        std::from_chars(ptr + 1, args.data() + args.size(), length, 16);
+        const auto chunk { data.substr(std::min(offset, data.size()), length) };
+        std::string str { (offset + chunk.size() < data.size()) ? "m" : "l" };
+        // binary data escaping
+        for (const char c : chunk) {
+            if ((c == '#') || (c == '$') || (c == '}') || (c == '*')) {
+                str += '}';
+                str += static_cast<char>(c ^ 0x20);
+            } else {
+                str += c;
+            }
+        }
+        tx(str);
+    }
+
     template <typename XLEN, typename SHADOW>
     void Protocol<XLEN, SHADOW>::query (std::string_view packet) {
         std::string str;
@@ -442,11 +625,31 @@ namespace rsp {
             tx("OK");
             m_state.enableErrorStrings = true;
         } else
+        // target description 'qXfer:features:read:target.xml:offset,length'
+        if (const auto cmd {"qXfer:features:read:target.xml:"sv}; packet.starts_with(cmd)) {
+            query_xfer(m_shadow.targetXml(), packet.substr(cmd.length()));
+        } else
+        // memory map 'qXfer:memory-map:read::offset,length'
+        if (const auto cmd {"qXfer:memory-map:read::"sv}; packet.starts_with(cmd)) {
+            query_xfer(m_shadow.memoryMapXml(), packet.substr(cmd.length()));
+        } else
+        // branch trace
+        if (packet.starts_with("Qbtrace") || packet.starts_with("qXfer:btrace")) {
+            btrace(packet);
+        } else
+        // unknown qXfer object/annex
+        if (packet.starts_with("qXfer:")) {
+            error_number_reply(0);
+        } else
+        // tracepoint packets
+        if (packet.starts_with("QT") || packet.starts_with("qT")) {
+            tracepoint(packet);
+        } else
         // query first thread info
         if (packet == "qfThreadInfo") {
-            // TODO: hendle real number of cores
+            // each hart is a thread
             std::vector<std::string> response { };
-            for (int i=0; i<1; i++) {
+            for (int i=0; i<static_cast<int>(m_shadow.harts()); i++) {
                 ThreadId thread { 1, i+1 };
                 response.push_back(thread_format(thread));
             }
@@ -461,12 +664,11 @@ namespace rsp {
         if (const auto cmd {"qThreadExtraInfo,"sv}; packet.starts_with(cmd)) {
             ThreadId thread = thread_scan(packet.substr(cmd.length()));
 //            std::println("DEBUG: qThreadExtraInfo: str = {}, thread = {:0d}, THREADS[{:0d}-1] = {}", str, thread, thread, THREADS[thread-1]);
-//            tx(bin2hex(THREADS[thr-1]));
+            tx(str2hex(std::format("hart {}", m_shadow.hart(thread))));
         } else
         // query first thread info
         if (packet == "qC") {
-            // TODO
-            ThreadId thread { 1, 1 };
+            ThreadId thread { 1, static_cast<int>(m_shadow.m_hart) + 1 };
             tx("QC" + thread_format(thread));
         } else
         // query whether the remote server attached to an existing process or created a new process
@@ -480,6 +682,284 @@ namespace rsp {
         }
     }
 
+    ////////////////////////////////////////
+    // RSP branch trace
+    ////////////////////////////////////////
+
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/General-Query-Packets.html#qXfer-btrace-read
+    // BTS style branch trace is produced from the instruction addresses
+    // of the Hg selected hart trace, so the whole history is transferred in bulk.
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::btrace (std::string_view packet) {
+        const std::size_t hart { m_shadow.hart(m_operation['g']) };
+        auto& trace = m_shadow.m_btrace[hart];
+
+        // enable/disable
+        if (packet == "Qbtrace:bts") {
+            if (trace.m_enabled) {
+                error_number_reply(1);
+                return;
+            }
+            trace.m_enabled = true;
+            trace.m_read = 0;
+            tx("OK");
+        } else
+        if (packet == "Qbtrace:off") {
+            if (!trace.m_enabled) {
+                error_number_reply(1);
+                return;
+            }
+            trace.m_enabled = false;
+            tx("OK");
+        } else
+        // buffer size 'Qbtrace-conf:bts:size=value'
+        if (const auto cmd {"Qbtrace-conf:bts:size="sv}; packet.starts_with(cmd)) {
+            std::size_t size = 0;
+            std::from_chars(packet.data() + cmd.length(), packet.data() + packet.size(), size, 16);
+            trace.m_size = size;
+            tx("OK");
+        } else
+        // 'qXfer:btrace:read:all|new|delta:offset,length'
+        if (const auto cmd {"qXfer:btrace:read:"sv}; packet.starts_with(cmd)) {
+            const auto str { packet.substr(cmd.length()) };
+            const auto colon = str.find(':');
+            if (!trace.m_enabled || (colon == std::string_view::npos)) {
+                error_number_reply(1);
+                return;
+            }
+            // the XML is generated on the first chunk, following chunks read the same object
+            if (str.substr(colon + 1).starts_with("0,")) {
+                // replayed entries of a trace loaded from a sidecar are decoded
+                m_shadow.m_blocks.ensure(m_shadow, 0, m_shadow.count());
+                auto xml { trace.read(m_shadow.m_trace[hart], m_shadow.m_cores[hart].count(), str.substr(0, colon)) };
+                if (!xml) {
+                    error_number_reply(2);
+                    return;
+                }
+                m_xfer = std::move(*xml);
+            }
+            query_xfer(m_xfer, str.substr(colon + 1));
+        } else
+        // 'qXfer:btrace-conf:read::offset,length'
+        if (const auto cmd {"qXfer:btrace-conf:read::"sv}; packet.starts_with(cmd)) {
+            if (packet.substr(cmd.length()).starts_with("0,"))  m_xfer = trace.conf();
+            query_xfer(m_xfer, packet.substr(cmd.length()));
+        } else
+        // processor trace is not supported
+        {
+            tx("");
+        }
+    }
+
+    ////////////////////////////////////////
+    // RSP tracepoints
+    ////////////////////////////////////////
+
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/Tracepoint-Packets.html
+    // The trace is already recorded, so 'QTStart' collects all frames in a single pass,
+    // and 'QTFrame' moves the shadow to the frame position instead of storing collected data.
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::tracepoint (std::string_view packet) {
+        auto& trace = m_shadow.m_tracepoints;
+
+        // split packet arguments separated by ':'
+        auto split = [](std::string_view str) {
+            std::vector<std::string_view> args { };
+            for (const auto token : std::views::split(str, ":"sv)) {
+                args.emplace_back(token);
+            }
+            return args;
+        };
+        // parse hex number
+        auto number = [](std::string_view str) {
+            std::uint64_t val = 0;
+            std::from_chars(str.data(), str.data() + str.size(), val, 16);
+            return val;
+        };
+
+        // delete tracepoints and frames
+        if (packet == "QTinit") {
+            trace_frame(-1);
+            trace.clear();
+            tx("OK");
+        } else
+        // tracepoint definition 'QTDP:n:addr:ena:step:pass[:Fflen][:Xlen,bytes][-]'
+        // tracepoint actions    'QTDP:-n:addr:[S]action...[-]'
+        if (const auto cmd {"QTDP:"sv}; packet.starts_with(cmd)) {
+            std::string_view str { packet.substr(cmd.length()) };
+            // more packets follow
+            if (str.ends_with('-'))  str.remove_suffix(1);
+            auto args { split(str) };
+            if (args.size() < 2) {
+                error_number_reply(1);
+                return;
+            }
+            if (args[0].starts_with('-')) {
+                const auto key { std::make_pair(static_cast<unsigned int>(number(args[0].substr(1))), static_cast<XLEN>(number(args[1]))) };
+                auto it = trace.m_points.find(key);
+                if (it == trace.m_points.end()) {
+                    error_number_reply(2);
+                    return;
+                }
+                for (std::size_t i=2; i<args.size(); i++) {
+                    it->second.actions.emplace_back(args[i]);
+                }
+            } else {
+                if (args.size() < 5) {
+                    error_number_reply(1);
+                    return;
+                }
+                shadow::Tracepoint<XLEN> tp {
+                    .number  = static_cast<unsigned int>(number(args[0])),
+                    .addr    = static_cast<XLEN>(number(args[1])),
+                    .enabled = args[2] == "E",
+                    .step    = number(args[3]),
+                    .pass    = number(args[4]),
+                };
+                for (std::size_t i=5; i<args.size(); i++) {
+                    // condition (agent expression bytecode)
+                    if (args[i].starts_with('X')) {
+                        const auto pos = args[i].find(',');
+                        if (pos == std::string_view::npos)  continue;
+                        const std::string_view hex { args[i].substr(pos+1, 2*number(args[i].substr(1, pos-1))) };
+                        if (!ishex(hex)) {
+                            error_number_reply(1);
+                            return;
+                        }
+                        tp.cond.emplace_back(hex2bin(hex));
+                    }
+                    // TODO: fast tracepoints 'Fflen' are not supported
+                }
+                trace.m_points.insert_or_assign(std::make_pair(tp.number, tp.addr), std::move(tp));
+            }
+            tx("OK");
+        } else
+        // enable/disable tracepoint 'QTEnable:n:addr'
+        if (packet.starts_with("QTEnable:") || packet.starts_with("QTDisable:")) {
+            auto args { split(packet) };
+            if (args.size() < 3) {
+                error_number_reply(1);
+                return;
+            }
+            auto it = trace.m_points.find(std::make_pair(static_cast<unsigned int>(number(args[1])), static_cast<XLEN>(number(args[2]))));
+            if (it == trace.m_points.end()) {
+                error_number_reply(2);
+                return;
+            }
+            it->second.enabled = args[0] == "QTEnable";
+            tx("OK");
+        } else
+        // start trace run (collect all frames)
+        if (packet == "QTStart") {
+            trace_frame(-1);
+            trace.run(m_shadow);
+            tx("OK");
+        } else
+        // stop trace run
+        if (packet == "QTStop") {
+            trace.m_running = false;
+            tx("OK");
+        } else
+        // trace run status
+        if (packet == "qTStatus") {
+            std::string str { trace.m_running ? "T1" : "T0" };
+            if (!trace.m_running) {
+                if      (!trace.m_started)     str += ";tnotrun:0";
+                else if (trace.m_stop_pass)    str += std::format(";tpasscount:{:x}", trace.m_stop_pass);
+                else                           str += ";tstop::0";
+            }
+            str += std::format(";tframes:{:x};tcreated:{:x};circular:0;disconn:0", trace.m_frames.size(), trace.m_frames.size());
+            tx(str);
+        } else
+        // tracepoint status 'qTP:n:addr'
+        if (const auto cmd {"qTP:"sv}; packet.starts_with(cmd)) {
+            auto args { split(packet.substr(cmd.length())) };
+            if (args.empty()) {
+                error_number_reply(1);
+                return;
+            }
+            auto it = trace.m_points.find(std::make_pair(static_cast<unsigned int>(number(args[0])), static_cast<XLEN>(number(args.size() > 1 ? args[1] : ""sv))));
+            if (it == trace.m_points.end()) {
+                error_number_reply(2);
+                return;
+            }
+            tx(std::format("V{:x}:0", it->second.hits));
+        } else
+        // select trace frame
+        if (const auto cmd {"QTFrame:"sv}; packet.starts_with(cmd)) {
+            auto args { split(packet.substr(cmd.length())) };
+            // number of arguments of the frame selection type
+            const std::string_view type { args.empty() ? ""sv : args[0] };
+            const std::size_t expected = (type == "pc" || type == "tdp") ? 2 : (type == "range" || type == "outside") ? 3 : 1;
+            if (args.size() < expected) {
+                error_number_reply(1);
+                return;
+            }
+            int frame;
+            if (args[0] == "pc") {
+                const XLEN addr = number(args[1]);
+                frame = trace.find([&](const auto& f) { return f.addr == addr; });
+            } else
+            if (args[0] == "tdp") {
+                const unsigned int num = number(args[1]);
+                frame = trace.find([&](const auto& f) { return f.number == num; });
+            } else
+            if (args[0] == "range" || args[0] == "outside") {
+                const XLEN start = number(args[1]);
+                const XLEN end   = number(args[2]);
+                const bool range = args[0] == "range";
+                frame = trace.find([&](const auto& f) { return ((f.addr >= start) && (f.addr <= end)) == range; });
+            } else
+            if (args[0] == "-1") {
+                frame = -1;
+            } else {
+                frame = number(args[0]);
+                if (static_cast<std::size_t>(frame) >= trace.m_frames.size())  frame = -1;
+            }
+            trace_frame(frame);
+            if (frame < 0)  tx("F-1");
+            else            tx(std::format("F{:x}T{:x}", frame, trace.m_frames[frame].number));
+        } else
+        // upload tracepoint definitions
+        if (packet == "qTfP" || packet == "qTsP") {
+            if (packet == "qTfP")  m_trace_upload = 0;
+            if (m_trace_upload >= trace.m_points.size()) {
+                tx("l");
+                return;
+            }
+            const auto& tp = std::next(trace.m_points.begin(), m_trace_upload++)->second;
+            tx(std::format("T{:x}:{:x}:{}:{:x}:{:x}", tp.number, tp.addr, tp.enabled ? 'E' : 'D', tp.step, tp.pass));
+        } else
+        // upload trace state variables (not supported)
+        if (packet == "qTfV" || packet == "qTsV") {
+            tx("l");
+        } else
+        // accepted, but not needed, since nothing is collected
+        if (packet == "QTro" || packet.starts_with("QTro:") ||
+            packet.starts_with("QTDPsrc:") || packet.starts_with("QTDV:") ||
+            packet.starts_with("QTBuffer:") || packet.starts_with("QTNotes:") ||
+            packet.starts_with("QTDisconnected:")) {
+            tx("OK");
+        } else
+        // not supported (fast tracepoints, trace buffer access, ...)
+        {
+            tx("");
+        }
+    }
+
+    // move the shadow to the trace frame position (-1 returns to the position before the first selected frame)
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::trace_frame (int frame) {
+        auto& trace = m_shadow.m_tracepoints;
+        if (frame < 0) {
+            if (trace.m_frame >= 0)  m_shadow.seek(trace.m_cursor);
+        } else {
+            if (trace.m_frame <  0)  trace.m_cursor = m_shadow.count();
+            m_shadow.seek(trace.m_frames[frame].position);
+        }
+        trace.m_frame = frame;
+    }
+
     ////////////////////////////////////////
     // RSP verbose
     ////////////////////////////////////////
@@ -496,24 +976,11 @@ namespace rsp {
         } else
         // list actions supported by the ‘vCont?’ packet
         if (packet == "vCont?") {
-            tx("vCont;c;C;s;S");
+            tx("vCont;c;C;s;S;t;r");
         } else
         // parse 'vCont' packet
-        if (const auto cmd {"vCont"sv}; packet.starts_with(cmd)) {
-            auto str { packet.substr(cmd.length()) };
-            for (const auto token : std::views::split(str, ";"sv) | std::views::drop(1)) {
-                std::string_view item { token };
-                char action { item[0] };
-                auto length = item.length();
-                if (item.contains(':') > 0) {
-                    ThreadId thread { thread_scan(item.substr(2, length-2)) };
-                    // TODO
-                } else {
-                    // TODO
-                }
-            }
-            // TODO
-            stop_reply();
+        if (packet.starts_with("vCont;")) {
+            run_vcont(packet);
         } else
         // not supported, send empty response packet
         // also 'vMustReplyEmpty'
@@ -539,17 +1006,30 @@ namespace rsp {
 
     //    std::println("DBG: rsp_mem_read: adr = %08x, len=%08x", adr, len);
 
+        // precomputed after the last stop
+        if (!m_state.dut_memory) {
+            const auto hex { m_spec.mem(m_shadow.count(), m_shadow.hart(m_operation['g']), addr, size) };
+            if (hex) {
+                stats().m_spec_hits.add();
+                tx(*hex);
+                return;
+            }
+            stats().m_spec_misses.add();
+        }
+
         // read from memory
         std::span<std::byte> data;
         if (m_state.dut_memory) {
             data = dut_mem_read(addr, size);
         } else {
-            data = m_shadow.mem_read(m_operation['m'], addr, size);
+            data = m_shadow.mem_read(m_operation['g'], addr, size);
         }
     //    std::println("DBG: rsp_mem_read: pkt = %s", pkt);
 
-        // send response
-        tx(bin2hex(data));
+        // send response (encoded into the reused transmit buffer)
+        m_tx.clear();
+        bin2hex(m_tx, data);
+        tx(m_tx);
     }
 
     template <typename XLEN, typename SHADOW>
@@ -565,13 +1045,17 @@ namespace rsp {
         //    std::println("DBG: rsp_mem_write: adr = 'h%08h, len = 'd%0d", adr, len);
 
         // remove the header from the packet, only data remains
-        std::string_view hex { packet.substr(packet.size() - 2*len, 2*len) };
+        std::string_view hex { packet.substr(std::min(packet.find(':') + 1, packet.size())) };
         //    std::println("DBG: rsp_mem_write: str = %s", str);
+        if (hex.size() != 2*std::size_t{len} || !ishex(hex)) {
+            error_number_reply(1);
+            return;
+        }
 
         // write memory
 //        dut_mem_write(adr+i,                 dat  ));
         auto tmp { hex2bin(hex) };
-        m_shadow.mem_write(m_operation['M'], adr, tmp);
+        m_shadow.mem_write(m_operation['g'], adr, tmp);
 
         // send response
         tx("OK");
@@ -583,22 +1067,35 @@ namespace rsp {
 
     template <typename XLEN, typename SHADOW>
     void Protocol<XLEN, SHADOW>::reg_readall (std::string_view packet) {
+        // precomputed after the last stop
+        if (const auto regs { m_spec.regs(m_shadow.count(), m_shadow.hart(m_operation['g'])) }) {
+            stats().m_spec_hits.add();
+            tx(*regs);
+            return;
+        }
+        stats().m_spec_misses.add();
+
         // register value
         auto val { m_shadow.reg_readAll(m_operation['g']) };
 
-        // send response
-        auto response { bin2hex(val) };
-        tx(response);
+        // send response (encoded into the reused transmit buffer)
+        m_tx.clear();
+        bin2hex(m_tx, val);
+        tx(m_tx);
     };
 
     template <typename XLEN, typename SHADOW>
     void Protocol<XLEN, SHADOW>::reg_writeall(std::string_view packet) {
         // register value
+        if (!ishex(packet.substr(1))) {
+            error_number_reply(1);
+            return;
+        }
         auto val { hex2bin(packet.substr(1, packet.size()-1)) };
 
         // write DUT/shadow
 //        dut_reg_writeall(val);
-        m_shadow.reg_writeAll(m_operation['G'], val);
+        m_shadow.reg_writeAll(m_operation['g'], val);
 
         // send response
         tx("OK");
@@ -615,11 +1112,18 @@ namespace rsp {
         int status = std::sscanf(packet.data(), "p%x", &idx);
 
         // read DUT/shadow
-        auto val = m_shadow.reg_readOne(m_operation['p'], idx);
+        auto val = m_shadow.reg_readOne(m_operation['g'], idx);
 
-        // send response
-        std::string_view response { bin2hex(val) };
-        tx(response);
+        // unknown register
+        if (val.empty()) {
+            error_number_reply(1);
+            return;
+        }
+
+        // send response (encoded into the reused transmit buffer)
+        m_tx.clear();
+        bin2hex(m_tx, val);
+        tx(m_tx);
     };
 
     template <typename XLEN, typename SHADOW>
@@ -629,10 +1133,17 @@ namespace rsp {
         int status = std::sscanf(packet.data(), "P%x=", &idx);
 
         // register value
-        auto val = hex2bin(packet.substr(packet.size()-sizeof(XLEN), sizeof(XLEN)));
+        if ((status != 1) || (packet.find('=') == std::string_view::npos) || !ishex(packet.substr(packet.find('=') + 1))) {
+            error_number_reply(1);
+            return;
+        }
+        auto val = hex2bin(packet.substr(packet.find('=') + 1));
 
         // write DUT/shadow
-        m_shadow.reg_writeOne(m_operation['P'], idx, val);
+        if (!m_shadow.reg_writeOne(m_operation['g'], idx, val)) {
+            error_number_reply(1);
+            return;
+        }
         // debug
 //        switch (sizeof(XLEN)*8) {
 //            case 32: std::cout << std::format("DEBUG: GPR[{:0d}] <= 32'h{:08x}", idx, val);
@@ -647,12 +1158,190 @@ namespace rsp {
     // RSP forward/reverse step/continue
     ///////////////////////////////////////
 
+    // number of instructions replayed between checks for an interrupt from the client
+    // (checking the socket on every instruction would dominate the replay time)
+    constexpr std::size_t INTERRUPT_INTERVAL = 1 << 16;
+
+    // 's[addr]', 'c[addr]', 'Ssig[;addr]', 'Csig[;addr]'
+    // Signals are ignored, since the trace is replayed as recorded. For the
+    // same reason the replay can only resume at the current PC, other
+    // addresses are rejected (returns false after the error reply).
     template <typename XLEN, typename SHADOW>
-    void Protocol<XLEN, SHADOW>::run_step    (std::string_view packet) {};
+    bool Protocol<XLEN, SHADOW>::run_resume  (std::string_view packet) {
+        std::string_view str { packet.substr(1) };
+        if (packet[0] == 'S' || packet[0] == 'C') {
+            const auto pos = str.find(';');
+            str = (pos == std::string_view::npos) ? ""sv : str.substr(pos+1);
+        }
+        if (str.empty())  return true;
+        XLEN addr;
+        auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), addr, 16);
+        XLEN pc;
+        std::memcpy(&pc, m_shadow.reg_readOne(ThreadId{1, static_cast<int>(m_shadow.m_hart) + 1}, 32).data(), sizeof(pc));
+        if ((ec != std::errc{}) || (ptr != str.data() + str.size()) || (addr != pc)) {
+            error_number_reply(1);
+            return false;
+        }
+        return true;
+    }
+
     template <typename XLEN, typename SHADOW>
-    void Protocol<XLEN, SHADOW>::run_continue(std::string_view packet) {};
+    void Protocol<XLEN, SHADOW>::run_step    (std::string_view packet) {
+        if (!run_resume(packet))  return;
+        // forward step (other harts retire in between, until the selected hart retires)
+        const ThreadId thread { m_operation['c'] };
+        const std::size_t hart { m_shadow.hart(thread) };
+        while (!m_shadow.forward() && (thread.tid > 0) && (m_shadow.m_hart != hart));
+        // response packet
+        stop_reply();
+    };
+
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::run_continue(std::string_view packet) {
+        if (!run_resume(packet))  return;
+        // step forward until a breakpoint/watchpoint or the end of the trace
+        // (positions which can not match a point are skipped)
+        for (std::size_t i=1; m_shadow.skipForward(), !m_shadow.forward(); i++) {
+            // in case of Ctrl+C (character 0x03)
+            if ((i % INTERRUPT_INTERVAL == 0) && interrupt()) {
+                m_shadow.stopped().m_signal = SIGINT;
+                break;
+            }
+        }
+        // response packet
+        stop_reply();
+    };
+
     template <typename XLEN, typename SHADOW>
-    void Protocol<XLEN, SHADOW>::run_backward(std::string_view packet) {};
+    void Protocol<XLEN, SHADOW>::run_backward(std::string_view packet) {
+        // backward step
+        if (packet == "bs") {
+            const ThreadId thread { m_operation['c'] };
+            const std::size_t hart { m_shadow.hart(thread) };
+            while (!m_shadow.backward() && (thread.tid > 0) && (m_shadow.m_hart != hart));
+        } else
+        // backward continue
+        if (packet == "bc") {
+            for (std::size_t i=1; m_shadow.skipBackward(), !m_shadow.backward(); i++) {
+                // in case of Ctrl+C (character 0x03)
+                if ((i % INTERRUPT_INTERVAL == 0) && interrupt()) {
+                    m_shadow.stopped().m_signal = SIGINT;
+                    break;
+                }
+            }
+        }
+        // response packet
+        stop_reply();
+    };
+
+    // 'vCont[;action[:thread-id]]...'
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/Packets.html#vCont-packet
+    // Harts always retire in the recorded order, so actions only define
+    // when each hart stops the replay (all-stop):
+    //   c/C/t - only on breakpoints/watchpoints,
+    //   s/S   - after the hart retires an instruction,
+    //   r     - after the hart leaves the address range [start, end).
+    // A signal (C/S) can not be injected into a recording, only the signal
+    // the hart stopped with is accepted (its effect is part of the recording).
+    template <typename XLEN, typename SHADOW>
+    void Protocol<XLEN, SHADOW>::run_vcont (std::string_view packet) {
+        struct Action {
+            char type;   // 0 if there is no action for the hart
+            XLEN start;
+            XLEN end;
+            int  signal;
+        };
+        std::vector<Action> actions (m_shadow.harts(), Action{0, 0, 0, 0});
+
+        // the leftmost action applying to a hart is used
+        for (const auto token : std::views::split(packet, ";"sv) | std::views::drop(1)) {
+            std::string_view item { token };
+            if (item.empty())  continue;
+            Action action { item[0], 0, 0, 0 };
+            const auto colon = item.find(':');
+            const auto args { item.substr(1, (colon == std::string_view::npos) ? std::string_view::npos : colon - 1) };
+            switch (action.type) {
+                case 'c':
+                case 's':
+                case 't':
+                    break;
+                case 'C':
+                case 'S': {
+                    auto [ptr, ec] = std::from_chars(args.data(), args.data() + args.size(), action.signal, 16);
+                    if (ec != std::errc{}) {
+                        error_number_reply(1);
+                        return;
+                    }
+                    break;
+                }
+                case 'r': {
+                    const auto comma = args.find(',');
+                    if (comma == std::string_view::npos) {
+                        error_number_reply(1);
+                        return;
+                    }
+                    std::uint64_t start = 0, end = 0;
+                    std::from_chars(args.data(), args.data() + comma, start, 16);
+                    std::from_chars(args.data() + comma + 1, args.data() + args.size(), end, 16);
+                    action.start = start;
+                    action.end   = end;
+                    break;
+                }
+                default:
+                    error_number_reply(1);
+                    return;
+            }
+            // action for a single hart or all remaining harts
+            const ThreadId thread { (colon == std::string_view::npos) ? ThreadId{1, -1} : thread_scan(item.substr(colon + 1)) };
+            for (std::size_t h=0; h<actions.size(); h++) {
+                if (actions[h].type != 0)  continue;
+                if ((thread.tid <= 0) || (m_shadow.hart(thread) == h))  actions[h] = action;
+            }
+        }
+
+        // signals other than the recorded stop signal can not be delivered
+        for (std::size_t h=0; h<actions.size(); h++) {
+            const auto& action { actions[h] };
+            if (((action.type == 'C') || (action.type == 'S')) && (action.signal != m_shadow.m_cores[h].m_signal)) {
+                error_number_reply(1);
+                return;
+            }
+        }
+
+        // the first stop of a step/range action is found from the columns
+        // (checked after the hart retires, so the PC is the next PC),
+        // positions before it which can not match a point are skipped
+        const bool stepping = std::ranges::any_of(actions, [](const Action& action) {
+            return (action.type == 's') || (action.type == 'S') || (action.type == 'r');
+        });
+        std::size_t limit = m_shadow.size();
+        for (std::size_t pos=m_shadow.count(); stepping && (pos<m_shadow.size()); pos++) {
+            const auto& action { actions[m_shadow.m_order[pos].hart] };
+            const XLEN  pcn    { m_shadow.m_columns.m_pcn[pos] };
+            if ((action.type == 's') || (action.type == 'S') ||
+                ((action.type == 'r') && ((pcn < action.start) || (pcn >= action.end)))) {
+                limit = pos + 1;
+                break;
+            }
+        }
+
+        // replay until a point or an action stop condition
+        for (std::size_t i=1; m_shadow.skipForward(limit), !m_shadow.forward(); i++) {
+            const auto& action { actions[m_shadow.m_hart] };
+            if ((action.type == 's') || (action.type == 'S'))  break;
+            if (action.type == 'r') {
+                const XLEN pc = m_shadow.stopped().readPc();
+                if ((pc < action.start) || (pc >= action.end))  break;
+            }
+            // in case of Ctrl+C (character 0x03)
+            if ((i % INTERRUPT_INTERVAL == 0) && interrupt()) {
+                m_shadow.stopped().m_signal = SIGINT;
+                break;
+            }
+        }
+        // response packet
+        stop_reply();
+    }
 
     ////////////////////////////////////////
     // RSP breakpoints/watchpoints
@@ -668,17 +1357,48 @@ namespace rsp {
         rsp::PointKind kind;
 
         switch (sizeof(XLEN)*8) {
-            case 32: status = std::sscanf(packet.data(), "%c%x,%8x,%x", &command, &type_tmp, &addr, &kind);
-            case 64: status = std::sscanf(packet.data(), "%c%x,%16x,%x", &command, &type_tmp, &addr, &kind);
+            case 32: status = std::sscanf(packet.data(), "%c%x,%8x,%x", &command, &type_tmp, &addr, &kind); break;
+            case 64: status = std::sscanf(packet.data(), "%c%x,%16x,%x", &command, &type_tmp, &addr, &kind); break;
         }
         type = static_cast<rsp::PointType>(type_tmp);
 
-        // insert/remove
+        // conditions and commands (agent expression bytecode)
+        // 'Z0,addr,kind;Xlen,expr...;cmds:persist,Xlen,expr...'
+        std::vector<shadow::AgentExpr> cond { };
+        std::vector<shadow::AgentExpr> cmds { };
+        for (const auto token : std::views::split(packet, ";"sv) | std::views::drop(1)) {
+            std::string_view item { token };
+            auto* list = &cond;
+            // the 'persist' flag is ignored, the shadow does not run without GDB
+            if (const auto cmd {"cmds:"sv}; item.starts_with(cmd)) {
+                list = &cmds;
+                item.remove_prefix(std::min(item.find(',') + 1, item.size()));
+            }
+            // expressions are concatenated without separators
+            while (item.starts_with('X')) {
+                std::size_t len = 0;
+                auto [ptr, ec] = std::from_chars(item.data() + 1, item.data() + item.size(), len, 16);
+                std::size_t pos = ptr - item.data() + 1;  // skip ','
+                if ((ec != std::errc{}) || (pos > item.size()) || (item[pos-1] != ',') || !ishex(item.substr(pos, 2*len)) || (item.size() - pos < 2*len)) {
+                    error_number_reply(1);
+                    return;
+                }
+                list->emplace_back(hex2bin(item.substr(pos, 2*len)));
+                item.remove_prefix(std::min(pos + 2*len, item.size()));
+            }
+        }
+
+        // insert/remove (idempotent, GDB reinserts all points around each resume)
         switch (command) {
-            case 'z': m_shadow.pointRemove(m_operation[command], type, addr, kind);
-            case 'Z': m_shadow.pointInsert(m_operation[command], type, addr, kind);
+            case 'z': status = m_shadow.pointRemove(m_operation[command], type, addr, kind); break;
+            case 'Z': status = m_shadow.pointInsert(m_operation[command], type, addr, kind, std::move(cond), std::move(cmds)); break;
         }
 
+        // unsupported point type (empty response)
+        if (status < 0) {
+            tx("");
+            return;
+        }
         // send  response
         tx("OK");
     };
@@ -706,6 +1426,9 @@ namespace rsp {
         // send response (GDB cliend will close the socket connection)
         tx("OK");
 
+        // the session timeline is complete
+        if (timeline().enabled())  timeline().write();
+
         // re-initialize stub state
         //m_state = STUB_STATE_INIT;
 
@@ -733,6 +1456,20 @@ namespace rsp {
 
     template <typename XLEN, typename SHADOW>
     void Protocol<XLEN, SHADOW>::parse (std::string_view packet) {
+        TimelineScope scope { "parse", packet };
+        // precomputed responses are dropped by packets which may change the shadow
+        switch (packet[0]) {
+            case 'm':
+            case 'g':
+            case 'p':
+            case 'H':
+            // breakpoints/watchpoints do not change the shadow state
+            case 'z':
+            case 'Z':
+            case '?': m_spec.sync(); break;
+            case 'q': if (!packet.starts_with("qRcmd"))  { m_spec.sync(); break; }  [[fallthrough]];
+            default: m_spec.invalidate();
+        };
         switch (packet[0]) {
         //  case "x": mem_bin_read ();
         //  case "X": mem_bin_write();
@@ -779,7 +1516,10 @@ namespace rsp {
                 Socket::recv(tmp_char);
             } else {
                 packet = rx();
+                const auto start { std::chrono::steady_clock::now() };
+                const char cmd { packet[0] };
                 parse(packet);
+                stats().packet(cmd, std::chrono::steady_clock::now() - start);
             }
         } while (true);
     }
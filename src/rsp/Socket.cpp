@@ -188,6 +188,19 @@ namespace rsp {
         return status;
     }
 
+    ssize_t Socket::send (std::span<const iovec> data, int flags) const {
+        msghdr msg { };
+        msg.msg_iov    = const_cast<iovec*>(data.data());
+        msg.msg_iovlen = data.size();
+        ssize_t status { ::sendmsg(m_clientFd, &msg, flags) };
+        if (status == -1) {
+            // https://en.wikipedia.org/wiki/Errno.h
+            throw std::system_error(errno, std::generic_category(), "SEND failed");
+            return -1;
+        }
+        return status;
+    }
+
     // receiver
     ssize_t Socket::recv (std::span<std::byte> data, int flags) const {
         ssize_t status { ::recv(m_clientFd, data.data(), data.size(), flags) };
@@ -199,4 +212,18 @@ namespace rsp {
         return status;
     }
 
+    // non-blocking check for interrupt (Ctrl+C) from client
+    bool Socket::interrupt () const {
+        std::byte ch;
+        ssize_t status { ::recv(m_clientFd, &ch, 1, MSG_PEEK | MSG_DONTWAIT) };
+        // if empty (or EAGAIN)
+        if (status != 1)  return false;
+        // in case of Ctrl+C (character 0x03) remove it from the socket
+        if (ch == std::byte{0x03}) {
+            ::recv(m_clientFd, &ch, 1, 0);
+            return true;
+        }
+        return false;
+    }
+
 }
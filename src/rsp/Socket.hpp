@@ -20,6 +20,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 // C includes
@@ -65,10 +66,14 @@ namespace rsp {
         // accept UNIX/TCP connection from client
         void accept ();
 
-        // transmitter
+        // transmitter (gather: a single call for multiple buffers)
         ssize_t send (std::span<const std::byte> data, int flags = 0) const;
+        ssize_t send (std::span<const iovec>     data, int flags = 0) const;
         // receiver
         ssize_t recv (std::span<      std::byte> data, int flags = 0) const;
+
+        // non-blocking check for interrupt (Ctrl+C) from client
+        bool interrupt () const;
     };
 
 }
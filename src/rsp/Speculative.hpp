@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// RSP responses precomputed after a stop
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+
+// C++ includes
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace rsp {
+
+    // After a stop reply GDB almost always reads all registers ('g'), memory
+    // around PC (disassembly) and the stack frame at SP. These responses are
+    // encoded on a worker thread while the stop reply travels to GDB.
+    // Responses belong to a trace position and hart, any packet which can
+    // change the shadow state drops them. The worker only reads the shadow,
+    // the protocol waits for it before handling the next packet, a packet
+    // which drops the responses cancels the computation instead.
+    // The worker thread persists, each stop starts a new job generation.
+    class Speculative {
+    public:
+        // hex encoded memory [base, base + hex.size()/2)
+        struct Window {
+            std::uint64_t base;
+            std::string   hex;
+        };
+
+        struct Responses {
+            std::size_t         cursor;  // trace position
+            std::size_t         hart;
+            std::string         regs;    // 'g' response
+            std::vector<Window> mem;     // 'm' responses
+        };
+
+        // computation, the stop token is polled between steps
+        using Compute = std::function<Responses (std::stop_token)>;
+
+    private:
+        std::mutex                  m_mutex;
+        std::condition_variable_any m_cv;
+        Compute                     m_job;             // pending job
+        std::stop_source            m_cancel;          // cancels the current job
+        std::uint64_t               m_generation = 0;  // started jobs
+        std::uint64_t               m_done       = 0;  // finished (or dropped) jobs
+        std::optional<Responses>    m_ready;
+        std::jthread                m_worker;          // last, stops first
+
+        void work (std::stop_token stop);
+
+        // wait until the worker is idle (called with the lock held)
+        void idle (std::unique_lock<std::mutex>& lock) {
+            m_cv.wait(lock, [this] { return m_done == m_generation; });
+        };
+
+    public:
+        Speculative () : m_worker([this] (std::stop_token stop) { work(stop); }) { };
+        ~Speculative () { invalidate(); };
+
+        // start computing responses (returned by 'compute')
+        void start (Compute compute) {
+            std::unique_lock lock { m_mutex };
+            m_cancel.request_stop();
+            idle(lock);
+            m_ready.reset();
+            m_cancel = std::stop_source { };
+            m_job    = std::move(compute);
+            m_generation++;
+            m_cv.notify_all();
+        };
+
+        // wait for the worker (before the shadow is accessed)
+        void sync () {
+            std::unique_lock lock { m_mutex };
+            idle(lock);
+        };
+
+        // drop responses (shadow state changed), a running computation is cancelled
+        void invalidate () {
+            std::unique_lock lock { m_mutex };
+            m_cancel.request_stop();
+            if (m_job) {
+                m_job = nullptr;
+                m_done = m_generation;
+            }
+            idle(lock);
+            m_ready.reset();
+        };
+
+        // precomputed responses (if computed for the given position and hart)
+        const std::string* regs (const std::size_t cursor, const std::size_t hart) const {
+            if (!m_ready || m_ready->cursor != cursor || m_ready->hart != hart)  return nullptr;
+            return &m_ready->regs;
+        };
+        std::optional<std::string_view> mem (const std::size_t cursor, const std::size_t hart, const std::uint64_t addr, const std::uint64_t size) const {
+            if (!m_ready || m_ready->cursor != cursor || m_ready->hart != hart)  return std::nullopt;
+            for (const auto& win : m_ready->mem) {
+                if ((addr >= win.base) && (addr - win.base + size <= win.hex.size()/2)) {
+                    return std::string_view(win.hex).substr(2*(addr - win.base), 2*size);
+                }
+            }
+            return std::nullopt;
+        };
+    };
+
+    inline void Speculative::work (std::stop_token stop) {
+        std::unique_lock lock { m_mutex };
+        while (m_cv.wait(lock, stop, [this] { return static_cast<bool>(m_job); })) {
+            const Compute         job    { std::exchange(m_job, nullptr) };
+            const std::uint64_t   gen    { m_generation };
+            const std::stop_token cancel { m_cancel.get_token() };
+            lock.unlock();
+            Responses res { job(cancel) };
+            lock.lock();
+            // partial responses of a cancelled job are dropped
+            if (!cancel.stop_requested())  m_ready = std::move(res);
+            m_done = gen;
+            m_cv.notify_all();
+        }
+    }
+
+}
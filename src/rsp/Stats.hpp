@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB server statistics
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+
+// C++ includes
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string>
+#include <format>
+
+namespace rsp {
+
+    // Counters are relaxed atomics, they are only ordered when a report is
+    // requested, so updating them costs an uncontended add on the hot path.
+
+    // counter
+    class Counter {
+        std::atomic<std::uint64_t> m_val { 0 };
+    public:
+        void add (const std::uint64_t n = 1) { m_val.fetch_add(n, std::memory_order_relaxed); };
+        std::uint64_t get () const { return m_val.load(std::memory_order_relaxed); };
+        void reset () { m_val.store(0, std::memory_order_relaxed); };
+    };
+
+    // latency histogram with log2 buckets (bucket 'i' counts values in [2^(i-1), 2^i) ns)
+    class Histogram {
+        static constexpr std::size_t BUCKETS = 48;
+        std::array<Counter, BUCKETS> m_bucket;
+        Counter                      m_count;
+        Counter                      m_sum;
+    public:
+        void add (const std::uint64_t ns) {
+            m_bucket[std::min<std::size_t>(std::bit_width(ns), BUCKETS-1)].add();
+            m_count.add();
+            m_sum.add(ns);
+        };
+        std::uint64_t count () const { return m_count.get(); };
+        std::uint64_t sum   () const { return m_sum  .get(); };
+        // upper bucket bound of the given quantile
+        std::uint64_t quantile (const double q) const;
+        void reset ();
+    };
+
+    inline std::uint64_t Histogram::quantile (const double q) const {
+        const std::uint64_t rank = static_cast<std::uint64_t>(q * count());
+        std::uint64_t acc = 0;
+        for (std::size_t i=0; i<BUCKETS; i++) {
+            acc += m_bucket[i].get();
+            if (acc > rank)  return std::uint64_t{1} << i;
+        }
+        return std::uint64_t{1} << (BUCKETS-1);
+    }
+
+    inline void Histogram::reset () {
+        for (auto& bucket : m_bucket)  bucket.reset();
+        m_count.reset();
+        m_sum.reset();
+    }
+
+    class Stats {
+    public:
+        // packets by command character
+        std::array<Histogram, 128> m_packet;
+        // socket traffic
+        Counter m_bytes_rx;
+        Counter m_bytes_tx;
+        // replay
+        Counter m_replayed;      // instructions replayed forward
+        Counter m_reverted;      // instructions reverted
+        Counter m_seeks;         // trace position seeks
+        Counter m_pc_hits;       // PC index lookups with trace positions
+        Counter m_pc_misses;     // PC index lookups of never executed addresses
+        Counter m_allocations;   // trace storage reallocations
+        // lazily loaded trace blocks
+        Counter m_block_prefetched;  // decoded by the prefetch worker
+        Counter m_block_misses;      // decoded by the replay (not prefetched in time)
+        // responses precomputed after a stop
+        Counter m_spec_hits;     // served from the precomputed responses
+        Counter m_spec_misses;   // 'g'/'m' packets computed from the shadow
+
+        // measure the time spent on a packet
+        void packet (const char cmd, const std::chrono::steady_clock::duration time) {
+            m_packet[cmd & 0x7f].add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+        };
+
+        std::string report () const;
+        void reset ();
+    };
+
+    inline std::string Stats::report () const {
+        std::string str { "packet   count      p50 [us]   p99 [us]  p999 [us]  total [ms]\n" };
+        for (std::size_t cmd=0; cmd<m_packet.size(); cmd++) {
+            const auto& hist = m_packet[cmd];
+            if (hist.count() == 0)  continue;
+            str += std::format("  '{:c}' {:10} {:10.1f} {:10.1f} {:10.1f} {:11.3f}\n", static_cast<char>(cmd), hist.count(),
+                hist.quantile(0.5) / 1e3, hist.quantile(0.99) / 1e3, hist.quantile(0.999) / 1e3, hist.sum() / 1e6);
+        }
+        const std::uint64_t lookups = m_pc_hits.get() + m_pc_misses.get();
+        str += std::format("bytes received {}, sent {}\n", m_bytes_rx.get(), m_bytes_tx.get());
+        str += std::format("instructions replayed {}, reverted {}, seeks {}\n", m_replayed.get(), m_reverted.get(), m_seeks.get());
+        str += std::format("PC index lookups {}, hit rate {:.1f}%\n", lookups, lookups ? 100.0 * m_pc_hits.get() / lookups : 0.0);
+        str += std::format("trace allocations {}\n", m_allocations.get());
+        str += std::format("trace blocks prefetched {}, missed {}\n", m_block_prefetched.get(), m_block_misses.get());
+        str += std::format("precomputed responses served {}, missed {}\n", m_spec_hits.get(), m_spec_misses.get());
+        return str;
+    }
+
+    inline void Stats::reset () {
+        for (auto& hist : m_packet)  hist.reset();
+        m_bytes_rx.reset();
+        m_bytes_tx.reset();
+        m_replayed.reset();
+        m_reverted.reset();
+        m_seeks.reset();
+        m_pc_hits.reset();
+        m_pc_misses.reset();
+        m_allocations.reset();
+        m_block_prefetched.reset();
+        m_block_misses.reset();
+        m_spec_hits.reset();
+        m_spec_misses.reset();
+    }
+
+    // server wide statistics (shared by the protocol and the shadow)
+    inline Stats& stats () {
+        static Stats s;
+        return s;
+    }
+
+}
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB server activity timeline (Chrome/Perfetto trace event JSON)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+
+// C++ includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <format>
+#include <algorithm>
+
+namespace rsp {
+
+    // Scoped instrumentation points record complete events into a buffer
+    // owned by the recording thread (its lock is only contended by write),
+    // buffers of all threads are merged when the timeline is written,
+    // buffers of exited threads are dropped once their events are written.
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    class Timeline {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // complete event ('X' phase)
+        struct Event {
+            const char*          name;     // string literal
+            std::array<char, 24> detail;   // packet prefix (zero terminated)
+            Clock::time_point    begin;
+            Clock::duration      duration;
+        };
+
+    private:
+        struct Buffer {
+            std::size_t        tid;
+            std::mutex         mutex;            // recording thread vs. write
+            std::vector<Event> events;
+            bool               retired = false;  // recording thread exited
+        };
+
+        // retires the buffer when the recording thread exits
+        struct Owner {
+            Buffer* buffer = nullptr;
+            ~Owner () {
+                if (buffer == nullptr)  return;
+                std::lock_guard lock { buffer->mutex };
+                buffer->retired = true;
+            }
+        };
+
+        std::atomic<bool>                    m_enabled { false };
+        std::string                          m_filename;
+        Clock::time_point                    m_origin;
+        std::mutex                           m_mutex;    // buffer registration
+        std::size_t                          m_tid = 0;
+        std::vector<std::unique_ptr<Buffer>> m_buffers;
+
+        // buffer of the calling thread (registered on first use)
+        Buffer& local ();
+
+    public:
+        bool enabled () const { return m_enabled.load(std::memory_order_relaxed); };
+        // start recording, the timeline is written into 'filename'
+        void enable (const std::string& filename);
+
+        void record (const char* name, std::string_view detail, const Clock::time_point begin, const Clock::time_point end);
+
+        // write recorded events and start a new timeline
+        void write ();
+    };
+
+    inline Timeline::Buffer& Timeline::local () {
+        thread_local Owner owner;
+        if (owner.buffer == nullptr) {
+            std::lock_guard lock { m_mutex };
+            m_buffers.push_back(std::make_unique<Buffer>(++m_tid));
+            owner.buffer = m_buffers.back().get();
+        }
+        return *owner.buffer;
+    }
+
+    inline void Timeline::enable (const std::string& filename) {
+        m_filename = filename;
+        m_origin   = Clock::now();
+        m_enabled.store(true, std::memory_order_relaxed);
+    }
+
+    inline void Timeline::record (const char* name, std::string_view detail, const Clock::time_point begin, const Clock::time_point end) {
+        Event event { name, { }, begin, end - begin };
+        // JSON string characters only
+        const std::size_t size = std::min(detail.size(), event.detail.size() - 1);
+        std::ranges::transform(detail.substr(0, size), event.detail.begin(), [](const char c) {
+            return (c < 0x20 || c > 0x7e || c == '"' || c == '\\') ? '.' : c;
+        });
+        Buffer& buffer = local();
+        std::lock_guard lock { buffer.mutex };
+        buffer.events.push_back(event);
+    }
+
+    inline void Timeline::write () {
+        std::lock_guard lock { m_mutex };
+        std::ofstream file { m_filename };
+        file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        bool first = true;
+        for (auto& buffer : m_buffers) {
+            std::lock_guard buffer_lock { buffer->mutex };
+            for (const auto& event : buffer->events) {
+                const double ts  = std::chrono::duration<double, std::micro>(event.begin - m_origin).count();
+                const double dur = std::chrono::duration<double, std::micro>(event.duration).count();
+                file << std::format("{}{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}",
+                    first ? "" : ",\n", event.name, buffer->tid, ts, dur);
+                if (event.detail[0] != '\0')  file << std::format(", \"args\": {{\"packet\": \"{}\"}}", event.detail.data());
+                file << "}";
+                first = false;
+            }
+            buffer->events.clear();
+        }
+        // buffers of exited threads will not record again
+        std::erase_if(m_buffers, [](const auto& buffer) {
+            std::lock_guard buffer_lock { buffer->mutex };
+            return buffer->retired;
+        });
+        file << "\n]}\n";
+    }
+
+    // server wide timeline
+    inline Timeline& timeline () {
+        static Timeline t;
+        return t;
+    }
+
+    // instrumentation point (measures the enclosing scope)
+    class TimelineScope {
+        const char*              m_name;
+        std::string_view         m_detail;
+        bool                     m_enabled;
+        Timeline::Clock::time_point m_begin;
+    public:
+        TimelineScope (const char* name, std::string_view detail = { }) :
+            m_name(name),
+            m_detail(detail),
+            m_enabled(timeline().enabled())
+        {
+            if (m_enabled)  m_begin = Timeline::Clock::now();
+        }
+        ~TimelineScope () {
+            if (m_enabled)  timeline().record(m_name, m_detail, m_begin, Timeline::Clock::now());
+        }
+    };
+
+}
@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB GDB agent expression evaluator
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// C++ includes
+#include <array>
+#include <limits>
+#include <vector>
+#include <span>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+namespace shadow {
+
+    // agent expression bytecodes
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/Bytecode-Descriptions.html
+    enum class AgentOp : std::uint8_t {
+        add           = 0x02,
+        sub           = 0x03,
+        mul           = 0x04,
+        div_signed    = 0x05,
+        div_unsigned  = 0x06,
+        rem_signed    = 0x07,
+        rem_unsigned  = 0x08,
+        lsh           = 0x09,
+        rsh_signed    = 0x0a,
+        rsh_unsigned  = 0x0b,
+        trace         = 0x0c,
+        trace_quick   = 0x0d,
+        log_not       = 0x0e,
+        bit_and       = 0x0f,
+        bit_or        = 0x10,
+        bit_xor       = 0x11,
+        bit_not       = 0x12,
+        equal         = 0x13,
+        less_signed   = 0x14,
+        less_unsigned = 0x15,
+        ext           = 0x16,
+        ref8          = 0x17,
+        ref16         = 0x18,
+        ref32         = 0x19,
+        ref64         = 0x1a,
+        if_goto       = 0x20,
+        goto_         = 0x21,
+        const8        = 0x22,
+        const16       = 0x23,
+        const32       = 0x24,
+        const64       = 0x25,
+        reg           = 0x26,
+        end           = 0x27,
+        dup           = 0x28,
+        pop           = 0x29,
+        zero_ext      = 0x2a,
+        swap          = 0x2b,
+        getv          = 0x2c,
+        setv          = 0x2d,
+        tracev        = 0x2e,
+        tracenz       = 0x2f,
+        trace16       = 0x30,
+        pick          = 0x32,
+        rot           = 0x33,
+        printf_       = 0x34
+    };
+
+    // Agent expression (bytecode received from GDB in Z/QTDP packets).
+    // The evaluation context must provide register/memory access
+    // and an output for 'printf' (target side 'dprintf' commands):
+    //   std::uint64_t agentReg (unsigned int regnum);
+    //   std::uint64_t agentMem (std::uint64_t addr, std::size_t size);
+    //   void          agentPrint (std::string_view str);
+    // Trace bytecodes do not collect anything, since the entire
+    // shadow state is available at every trace position.
+    class AgentExpr {
+        std::vector<std::byte> m_code;
+
+        // evaluation limits
+        static constexpr std::size_t STACK = 64;
+        static constexpr std::size_t STEPS = 1 << 16;
+
+        // big endian operand
+        std::uint64_t operand (std::size_t pc, std::size_t size) const;
+
+        // decode C escapes in a 'printf' format string
+        static std::string unescape (std::string_view str);
+        // format 'printf' arguments (strings are read from the shadow memory)
+        template <typename CTX>
+        static std::string format (CTX& ctx, std::string_view raw, std::span<const std::int64_t> args);
+
+    public:
+        AgentExpr () = default;
+        AgentExpr (std::span<const std::byte> code) : m_code(code.begin(), code.end()) { };
+
+        std::span<const std::byte> code () const { return m_code; };
+
+        // evaluate expression (throws on invalid bytecode)
+        template <typename CTX>
+        std::int64_t eval (CTX& ctx) const;
+    };
+
+    inline std::uint64_t AgentExpr::operand (std::size_t pc, std::size_t size) const {
+        if (pc + size > m_code.size())  throw std::runtime_error { "Agent expression operand out of bounds." };
+        std::uint64_t val = 0;
+        for (std::size_t i=0; i<size; i++) {
+            val = (val << 8) | static_cast<std::uint64_t>(m_code[pc+i]);
+        }
+        return val;
+    }
+
+    // GDB sends the format string as written in the 'dprintf' command,
+    // escapes are decoded like in gdbserver ('format_pieces')
+    inline std::string AgentExpr::unescape (std::string_view str) {
+        std::string fmt;
+        for (std::size_t i=0; i<str.size(); i++) {
+            if (str[i] != '\\') {
+                fmt += str[i];
+                continue;
+            }
+            if (++i == str.size())  throw std::runtime_error { "Agent expression printf format ends with an escape." };
+            switch (str[i]) {
+                case '\\': fmt += '\\'; break;
+                case 'a' : fmt += '\a'; break;
+                case 'b' : fmt += '\b'; break;
+                case 'e' : fmt += '\x1b'; break;
+                case 'f' : fmt += '\f'; break;
+                case 'n' : fmt += '\n'; break;
+                case 'r' : fmt += '\r'; break;
+                case 't' : fmt += '\t'; break;
+                case 'v' : fmt += '\v'; break;
+                case '"' : fmt += '"'; break;
+                default:
+                    throw std::runtime_error { "Agent expression printf format unrecognized escape." };
+            }
+        }
+        return fmt;
+    }
+
+    // each conversion is formatted by 'snprintf' with the length modifier
+    // replaced by 'll', since all arguments are 64 bit stack entries
+    template <typename CTX>
+    std::string AgentExpr::format (CTX& ctx, std::string_view raw, std::span<const std::int64_t> args) {
+        const std::string fmt { unescape(raw) };
+        std::string str;
+        std::size_t arg = 0;
+        for (std::size_t i=0; i<fmt.size(); i++) {
+            if (fmt[i] != '%') {
+                str += fmt[i];
+                continue;
+            }
+            // conversion specification (flags, width, precision)
+            std::string spec { "%" };
+            for (i++; i<fmt.size() && std::string_view("-+ #0123456789.").contains(fmt[i]); i++)  spec += fmt[i];
+            // length modifiers
+            for (; i<fmt.size() && std::string_view("hlLqjzt").contains(fmt[i]); i++);
+            if (i == fmt.size())  break;
+            const char conv = fmt[i];
+            if (conv == '%') {
+                str += '%';
+                continue;
+            }
+            if (arg == args.size())  throw std::runtime_error { "Agent expression printf argument missing." };
+            const std::int64_t val = args[arg++];
+            std::string tmp;
+            switch (conv) {
+                case 'd': case 'i':
+                    spec += "ll";  spec += conv;
+                    tmp.resize(std::snprintf(nullptr, 0, spec.c_str(), static_cast<long long>(val)));
+                    std::snprintf(tmp.data(), tmp.size()+1, spec.c_str(), static_cast<long long>(val));
+                    break;
+                case 'u': case 'x': case 'X': case 'o':
+                    spec += "ll";  spec += conv;
+                    tmp.resize(std::snprintf(nullptr, 0, spec.c_str(), static_cast<unsigned long long>(val)));
+                    std::snprintf(tmp.data(), tmp.size()+1, spec.c_str(), static_cast<unsigned long long>(val));
+                    break;
+                case 'c':
+                    spec += conv;
+                    tmp.resize(std::snprintf(nullptr, 0, spec.c_str(), static_cast<int>(val)));
+                    std::snprintf(tmp.data(), tmp.size()+1, spec.c_str(), static_cast<int>(val));
+                    break;
+                case 'p':
+                    spec += "#llx";
+                    tmp.resize(std::snprintf(nullptr, 0, spec.c_str(), static_cast<unsigned long long>(val)));
+                    std::snprintf(tmp.data(), tmp.size()+1, spec.c_str(), static_cast<unsigned long long>(val));
+                    break;
+                case 's': {
+                    // NUL terminated string in the shadow memory (length limited)
+                    std::string txt;
+                    for (std::uint64_t adr = val; txt.size() < 256; adr++) {
+                        const char ch = static_cast<char>(ctx.agentMem(adr, 1));
+                        if (ch == '\0')  break;
+                        txt += ch;
+                    }
+                    spec += conv;
+                    tmp.resize(std::snprintf(nullptr, 0, spec.c_str(), txt.c_str()));
+                    std::snprintf(tmp.data(), tmp.size()+1, spec.c_str(), txt.c_str());
+                    break;
+                }
+                default:
+                    throw std::runtime_error { "Agent expression printf unsupported conversion." };
+            }
+            str += tmp;
+        }
+        return str;
+    }
+
+    template <typename CTX>
+    std::int64_t AgentExpr::eval (CTX& ctx) const {
+        std::array<std::int64_t, STACK> stack;
+        std::size_t sp = 0;  // number of stack entries
+        std::size_t pc = 0;
+
+        auto push = [&](std::int64_t val) {
+            if (sp == STACK)  throw std::runtime_error { "Agent expression stack overflow." };
+            stack[sp++] = val;
+        };
+        auto pop = [&]() -> std::int64_t {
+            if (sp == 0)  throw std::runtime_error { "Agent expression stack underflow." };
+            return stack[--sp];
+        };
+        // sign/zero extend from the given number of bits
+        auto sext = [](std::int64_t val, unsigned bits) -> std::int64_t {
+            if (bits >= 64)  return val;
+            const std::uint64_t m = std::uint64_t{1} << (bits - 1);
+            const std::uint64_t v = static_cast<std::uint64_t>(val) & ((m << 1) - 1);
+            return static_cast<std::int64_t>((v ^ m) - m);
+        };
+        auto zext = [](std::int64_t val, unsigned bits) -> std::int64_t {
+            if (bits >= 64)  return val;
+            return static_cast<std::int64_t>(static_cast<std::uint64_t>(val) & ((std::uint64_t{1} << bits) - 1));
+        };
+
+        for (std::size_t step=0; step<STEPS; step++) {
+            if (pc >= m_code.size())  throw std::runtime_error { "Agent expression without end." };
+            const auto op = static_cast<AgentOp>(m_code[pc++]);
+            std::int64_t a, b;
+            switch (op) {
+                case AgentOp::add          : b = pop(); a = pop(); push(a + b); break;
+                case AgentOp::sub          : b = pop(); a = pop(); push(a - b); break;
+                case AgentOp::mul          : b = pop(); a = pop(); push(a * b); break;
+                case AgentOp::div_signed   :
+                case AgentOp::div_unsigned :
+                case AgentOp::rem_signed   :
+                case AgentOp::rem_unsigned :
+                    b = pop(); a = pop();
+                    if (b == 0)  throw std::runtime_error { "Agent expression division by zero." };
+                    // the quotient overflows (and traps on x86)
+                    if ((op == AgentOp::div_signed || op == AgentOp::rem_signed) && a == std::numeric_limits<std::int64_t>::min() && b == -1) {
+                        throw std::runtime_error { "Agent expression division overflow." };
+                    }
+                    switch (op) {
+                        case AgentOp::div_signed  : push(a / b); break;
+                        case AgentOp::div_unsigned: push(static_cast<std::int64_t>(static_cast<std::uint64_t>(a) / static_cast<std::uint64_t>(b))); break;
+                        case AgentOp::rem_signed  : push(a % b); break;
+                        default                   : push(static_cast<std::int64_t>(static_cast<std::uint64_t>(a) % static_cast<std::uint64_t>(b))); break;
+                    }
+                    break;
+                case AgentOp::lsh          : b = pop(); a = pop(); push(static_cast<std::int64_t>(static_cast<std::uint64_t>(a) << (b & 63))); break;
+                case AgentOp::rsh_signed   : b = pop(); a = pop(); push(a >> (b & 63)); break;
+                case AgentOp::rsh_unsigned : b = pop(); a = pop(); push(static_cast<std::int64_t>(static_cast<std::uint64_t>(a) >> (b & 63))); break;
+                case AgentOp::log_not      : a = pop(); push(!a); break;
+                case AgentOp::bit_and      : b = pop(); a = pop(); push(a & b); break;
+                case AgentOp::bit_or       : b = pop(); a = pop(); push(a | b); break;
+                case AgentOp::bit_xor      : b = pop(); a = pop(); push(a ^ b); break;
+                case AgentOp::bit_not      : a = pop(); push(~a); break;
+                case AgentOp::equal        : b = pop(); a = pop(); push(a == b); break;
+                case AgentOp::less_signed  : b = pop(); a = pop(); push(a < b); break;
+                case AgentOp::less_unsigned: b = pop(); a = pop(); push(static_cast<std::uint64_t>(a) < static_cast<std::uint64_t>(b)); break;
+                case AgentOp::ext          :
+                case AgentOp::zero_ext     :
+                    b = operand(pc, 1); pc += 1;
+                    if (b == 0)  throw std::runtime_error { "Agent expression extension from 0 bits." };
+                    push(op == AgentOp::ext ? sext(pop(), b) : zext(pop(), b));
+                    break;
+                case AgentOp::ref8         : push(ctx.agentMem(pop(), 1)); break;
+                case AgentOp::ref16        : push(ctx.agentMem(pop(), 2)); break;
+                case AgentOp::ref32        : push(ctx.agentMem(pop(), 4)); break;
+                case AgentOp::ref64        : push(ctx.agentMem(pop(), 8)); break;
+                case AgentOp::if_goto      :
+                    if (pop())  pc = operand(pc, 2);
+                    else        pc += 2;
+                    break;
+                case AgentOp::goto_        : pc = operand(pc, 2); break;
+                case AgentOp::const8       : push(operand(pc, 1)); pc += 1; break;
+                case AgentOp::const16      : push(operand(pc, 2)); pc += 2; break;
+                case AgentOp::const32      : push(operand(pc, 4)); pc += 4; break;
+                case AgentOp::const64      : push(operand(pc, 8)); pc += 8; break;
+                case AgentOp::reg          : push(ctx.agentReg(operand(pc, 2))); pc += 2; break;
+                // 'printf' leaves nothing on the stack
+                case AgentOp::end          : return sp ? pop() : 0;
+                case AgentOp::dup          : a = pop(); push(a); push(a); break;
+                case AgentOp::pop          : pop(); break;
+                case AgentOp::swap         : b = pop(); a = pop(); push(b); push(a); break;
+                case AgentOp::pick         :
+                    b = operand(pc, 1); pc += 1;
+                    if (static_cast<std::size_t>(b) >= sp)  throw std::runtime_error { "Agent expression stack underflow." };
+                    push(stack[sp-1-b]);
+                    break;
+                case AgentOp::rot          : {
+                    // (a b c => c a b)
+                    std::int64_t c = pop(); b = pop(); a = pop();
+                    push(c); push(a); push(b);
+                    break;
+                }
+                case AgentOp::printf_      : {
+                    // (args... channel function =>), format string is prefixed with a 2 byte length
+                    const std::size_t num = operand(pc, 1);
+                    const std::size_t len = operand(pc+1, 2);
+                    if (pc + 3 + len > m_code.size() || len == 0 || m_code[pc+2+len] != std::byte{0}) {
+                        throw std::runtime_error { "Agent expression printf format out of bounds." };
+                    }
+                    const std::string_view fmt { reinterpret_cast<const char*>(&m_code[pc+3]), len-1 };
+                    pc += 3 + len;
+                    // function and channel are ignored, the output goes to the context
+                    pop(); pop();
+                    std::array<std::int64_t, STACK> args;
+                    for (std::size_t i=0; i<num; i++)  args[i] = pop();
+                    ctx.agentPrint(format(ctx, fmt, std::span(args).first(num)));
+                    break;
+                }
+                // trace bytecodes (the shadow already holds the entire state)
+                case AgentOp::trace        : pop(); pop(); break;
+                case AgentOp::trace_quick  : pc += 1; break;
+                case AgentOp::trace16      : pc += 2; break;
+                case AgentOp::tracev       : pc += 2; break;
+                case AgentOp::tracenz      : pop(); pop(); break;
+                // trace state variables are not supported
+                // (an error stops, instead of evaluating a condition with a wrong value)
+                default:
+                    throw std::runtime_error { "Agent expression unsupported bytecode." };
+            }
+        }
+        throw std::runtime_error { "Agent expression step limit exceeded." };
+    }
+
+}
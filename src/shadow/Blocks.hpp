@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB lazily materialized trace blocks with a prefetch worker
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+
+// C++ includes
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <utility>
+
+// HDLDB includes
+#include <Stats.hpp>
+#include <Timeline.hpp>
+
+namespace shadow {
+
+    // Retired instructions of a trace loaded from a sidecar are decoded in
+    // blocks of trace positions when first used. A worker decodes blocks
+    // around the replay cursor, ahead in the direction the cursor last moved,
+    // so stepping rarely has to decode a block itself.
+    // Each block has an atomic state, whoever moves it from empty to busy
+    // decodes it, the replay waits for a block being decoded by the worker
+    // (there are no locks between the worker and the replay).
+    template <typename SYS>
+    class Blocks {
+    public:
+        // decode block (into preallocated trace entries)
+        using Decode = std::function<void (SYS&, const std::size_t)>;
+
+        // blocks prefetched ahead/behind the cursor
+        static constexpr std::size_t AHEAD  = 8;
+        static constexpr std::size_t BEHIND = 2;
+
+    private:
+        enum State : std::uint8_t { EMPTY, BUSY, READY };
+
+        std::size_t                                m_size  = 0;  // trace positions in a block
+        std::size_t                                m_count = 0;  // number of blocks (0 if not lazy)
+        std::unique_ptr<std::atomic<std::uint8_t>[]> m_state;
+        Decode                                     m_decode;
+
+        // cursor published to the worker (block index and direction)
+        std::atomic<std::size_t>   m_cursor    { 0 };
+        std::atomic<bool>          m_backward  { false };
+        std::atomic<std::uint64_t> m_generation{ 0 };
+        std::atomic<bool>          m_stop      { false };
+        std::jthread               m_worker;
+
+        // decode block if empty (returns true if this thread decoded it)
+        bool claim (SYS& sys, const std::size_t blk);
+        void work  (SYS& sys);
+
+    public:
+        Blocks () = default;
+        // the worker refers to the shadow it was started for, so a running
+        // worker is joined, it is restarted for the new shadow at the next replay
+        Blocks (Blocks&& other) {
+            other.stop();
+            m_size   = other.m_size;
+            m_count  = std::exchange(other.m_count, 0);
+            m_state  = std::move(other.m_state);
+            m_decode = std::move(other.m_decode);
+        }
+        ~Blocks () { stop(); };
+
+        bool lazy () const { return m_count > 0; };
+
+        // positions [0, positions) are decoded on demand in blocks of 'size'
+        void attach (const std::size_t positions, const std::size_t size, Decode decode);
+
+        // wait until the block with the trace position is decoded
+        void ensure (SYS& sys, const std::size_t pos) {
+            if (m_count == 0)  return;
+            const std::size_t blk = pos / m_size;
+            if (m_state[blk].load(std::memory_order_acquire) != READY)  fetch(sys, blk);
+        };
+        void ensure (SYS& sys, const std::size_t first, const std::size_t last) {
+            if (m_count == 0 || first >= last)  return;
+            for (std::size_t blk = first / m_size; blk <= (last - 1) / m_size; blk++) {
+                if (m_state[blk].load(std::memory_order_acquire) != READY)  fetch(sys, blk);
+            }
+        };
+        void fetch (SYS& sys, const std::size_t blk);
+
+        // publish the cursor position (wakes the worker when it enters another block)
+        void cursor (SYS& sys, const std::size_t pos, const bool backward);
+
+        // decode all blocks and stop being lazy (before the trace is modified)
+        void finish (SYS& sys);
+        void stop ();
+    };
+
+    template <typename SYS>
+    void Blocks<SYS>::attach (const std::size_t positions, const std::size_t size, Decode decode) {
+        stop();
+        m_size   = size;
+        m_count  = (positions + size - 1) / size;
+        m_state  = std::make_unique<std::atomic<std::uint8_t>[]>(m_count);
+        m_decode = std::move(decode);
+        m_stop.store(false);
+    }
+
+    template <typename SYS>
+    bool Blocks<SYS>::claim (SYS& sys, const std::size_t blk) {
+        std::uint8_t state = EMPTY;
+        if (!m_state[blk].compare_exchange_strong(state, BUSY, std::memory_order_acquire))  return false;
+        m_decode(sys, blk);
+        m_state[blk].store(READY, std::memory_order_release);
+        m_state[blk].notify_all();
+        return true;
+    }
+
+    template <typename SYS>
+    void Blocks<SYS>::fetch (SYS& sys, const std::size_t blk) {
+        if (claim(sys, blk)) {
+            rsp::stats().m_block_misses.add();
+            return;
+        }
+        // decoded by the worker
+        for (std::uint8_t state; (state = m_state[blk].load(std::memory_order_acquire)) != READY;) {
+            m_state[blk].wait(state, std::memory_order_acquire);
+        }
+    }
+
+    template <typename SYS>
+    void Blocks<SYS>::cursor (SYS& sys, const std::size_t pos, const bool backward) {
+        if (m_count == 0)  return;
+        const std::size_t blk = std::min(pos / m_size, m_count - 1);
+        if (blk == m_cursor.load(std::memory_order_relaxed) && backward == m_backward.load(std::memory_order_relaxed) && m_worker.joinable())  return;
+        m_cursor  .store(blk,      std::memory_order_relaxed);
+        m_backward.store(backward, std::memory_order_relaxed);
+        m_generation.fetch_add(1, std::memory_order_release);
+        if (!m_worker.joinable()) {
+            m_worker = std::jthread([this, &sys] { work(sys); });
+        }
+        m_generation.notify_one();
+    }
+
+    template <typename SYS>
+    void Blocks<SYS>::work (SYS& sys) {
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            const std::uint64_t gen = m_generation.load(std::memory_order_acquire);
+            const std::size_t   cur = m_cursor.load(std::memory_order_relaxed);
+            const bool          bwd = m_backward.load(std::memory_order_relaxed);
+            // nearest blocks first, in the direction of travel first
+            for (std::size_t d=0; d<=AHEAD; d++) {
+                if (m_stop.load(std::memory_order_relaxed) || m_generation.load(std::memory_order_relaxed) != gen)  break;
+                for (const bool ahead : {true, false}) {
+                    if (!ahead && (d == 0 || d > BEHIND))  continue;
+                    const bool down = (ahead == bwd);
+                    if (down ? (d > cur) : (cur + d >= m_count))  continue;
+                    const std::size_t blk = down ? cur - d : cur + d;
+                    if (m_state[blk].load(std::memory_order_relaxed) != EMPTY)  continue;
+                    rsp::TimelineScope scope { "prefetch" };
+                    if (claim(sys, blk))  rsp::stats().m_block_prefetched.add();
+                }
+            }
+            m_generation.wait(gen, std::memory_order_acquire);
+        }
+    }
+
+    template <typename SYS>
+    void Blocks<SYS>::finish (SYS& sys) {
+        if (m_count == 0)  return;
+        stop();
+        for (std::size_t blk=0; blk<m_count; blk++)  fetch(sys, blk);
+        m_count = 0;
+        m_state.reset();
+        m_decode = nullptr;
+    }
+
+    template <typename SYS>
+    void Blocks<SYS>::stop () {
+        if (!m_worker.joinable())  return;
+        m_stop.store(true, std::memory_order_relaxed);
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_generation.notify_one();
+        m_worker.join();
+    }
+
+}
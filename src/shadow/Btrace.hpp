@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB branch trace (GDB btrace in BTS format)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+
+// C++ includes
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <format>
+
+namespace shadow {
+
+    // Blocks of sequentially executed instructions are built from the
+    // instruction addresses of a hart trace (incrementally, as the replay advances),
+    // reads only list the blocks executed before the current trace position.
+    // Only entries before the current position are read, a trace loaded
+    // from a sidecar is decoded on demand and the caller ensures these are.
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/Branch-Trace-Format.html
+    template <typename XLEN>
+    class Btrace {
+    public:
+        // buffer size is given in bytes of hardware BTS records
+        static constexpr std::size_t RECORD = 24;
+
+        // sequentially executed block of instructions
+        struct Block {
+            std::size_t index;  // hart trace position of the first instruction
+            XLEN        begin;  // address of the first instruction
+            XLEN        end;    // address of the last  instruction
+        };
+
+        bool               m_enabled = false;
+        std::size_t        m_size = 64 * 1024;  // buffer size in bytes
+        std::size_t        m_read = 0;          // trace position at the last read
+        std::vector<Block> m_blocks;
+        std::size_t        m_indexed = 0;       // number of indexed trace entries
+
+        // extend blocks to the trace position 'count'
+        template <typename TRACE>
+        void update (const TRACE& trace, const std::size_t count);
+
+        // btrace XML for 'all', 'new' and 'delta' reads of the trace before position 'count'
+        // (no value if a delta can not be provided, the client then reads 'all')
+        template <typename TRACE>
+        std::optional<std::string> read (const TRACE& trace, const std::size_t count, std::string_view type);
+
+        // btrace configuration XML
+        std::string conf () const;
+    };
+
+    template <typename XLEN>
+    template <typename TRACE>
+    void Btrace<XLEN>::update (const TRACE& trace, const std::size_t count) {
+        for (; m_indexed < count; m_indexed++) {
+            const auto& ifu = trace[m_indexed].ifu;
+            if (m_indexed > 0) {
+                // continue the block if the previous instruction did not branch
+                const auto& prev = trace[m_indexed-1].ifu;
+                const XLEN len = prev.rdt.empty() ? 4 : prev.rdt.size();
+                if (ifu.adr == prev.adr + len) {
+                    m_blocks.back().end = ifu.adr;
+                    continue;
+                }
+            }
+            m_blocks.push_back({m_indexed, ifu.adr, ifu.adr});
+        }
+    }
+
+    template <typename XLEN>
+    template <typename TRACE>
+    std::optional<std::string> Btrace<XLEN>::read (const TRACE& trace, const std::size_t count, std::string_view type) {
+        update(trace, count);
+        // number of blocks started before the current position
+        const std::size_t num = std::upper_bound(m_blocks.begin(), m_blocks.end(), count,
+            [](const std::size_t c, const Block& b) { return c <= b.index; }) - m_blocks.begin();
+        // oldest listed block
+        std::size_t first = num - std::min(num, std::max<std::size_t>(m_size / RECORD, 1));
+        if (type == "delta") {
+            // the replay moved backwards, the old trace is no longer a prefix
+            if (count < m_read)  return std::nullopt;
+            // the first delta block continues the last block of the previous read
+            const std::size_t last = std::upper_bound(m_blocks.begin(), m_blocks.end(), m_read,
+                [](const std::size_t c, const Block& b) { return c <= b.index; }) - m_blocks.begin();
+            first = std::max(first, (last > 0) ? last - 1 : 0);
+        } else if (type == "new") {
+            // nothing changed since the last read
+            if (count == m_read)  first = num;
+        }
+        m_read = count;
+
+        std::string xml { "<?xml version=\"1.0\"?>\n"
+                          "<!DOCTYPE btrace SYSTEM \"btrace.dtd\">\n"
+                          "<btrace version=\"1.0\">\n" };
+        // the most recent block comes first, it ends at the last executed instruction
+        for (std::size_t i = num; i > first; i--) {
+            const auto& block = m_blocks[i-1];
+            const XLEN end = (i == num) ? trace[count-1].ifu.adr : block.end;
+            xml += std::format("  <block begin=\"0x{:x}\" end=\"0x{:x}\"/>\n", block.begin, end);
+        }
+        xml += "</btrace>\n";
+        return xml;
+    }
+
+    template <typename XLEN>
+    std::string Btrace<XLEN>::conf () const {
+        std::string xml { "<?xml version=\"1.0\"?>\n"
+                          "<!DOCTYPE btrace-conf SYSTEM \"btrace-conf.dtd\">\n"
+                          "<btrace-conf version=\"1.0\">\n" };
+        if (m_enabled)  xml += std::format("  <bts size=\"0x{:x}\"/>\n", m_size);
+        xml += "</btrace-conf>\n";
+        return xml;
+    }
+
+}
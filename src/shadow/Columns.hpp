@@ -0,0 +1,238 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB columnar trace (struct of arrays) with SIMD scans
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstdint>
+#include <cstddef>
+
+// C++ includes
+#include <vector>
+#include <span>
+#include <utility>
+#include <optional>
+#include <type_traits>
+#include <algorithm>
+#include <bit>
+
+// SIMD intrinsics
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// HDLDB includes
+#include "Registers.hpp"
+#include "Instruction.hpp"
+
+namespace shadow {
+
+    // The replayed trace keeps complete retired instructions (with revert data),
+    // searches only need a few fields, which are kept in separate columns
+    // indexed by the global trace position. A scan compares a vector register
+    // worth of positions against all breakpoint addresses and watchpoint
+    // intervals, candidates are confirmed with a scalar check.
+    template <typename XLEN, typename FLEN, typename VLEN, ExtensionsRiscV EXT>
+    class Columns {
+
+        // lanes in a vector register (0 for scalar scans)
+#if defined(__AVX2__)
+        static constexpr std::size_t LANES = 32 / sizeof(XLEN);
+#elif defined(__SSE2__)
+        static constexpr std::size_t LANES = (sizeof(XLEN) == 4) ? 4 : 0;
+#else
+        static constexpr std::size_t LANES = 0;
+#endif
+
+        // LSU size column flag
+        static constexpr std::uint8_t STORE = 0x80;
+
+        struct None { };
+
+    public:
+        // address window [lo, lo+num) as an unsigned difference (wraps around)
+        struct Window {
+            XLEN lo;
+            XLEN num;
+        };
+
+    private:
+
+        // bitmask of lanes with a PC in 'pcs' or a LSU address in a window
+        static std::uint32_t lanes (const XLEN* pc, const XLEN* adr, std::span<const XLEN> pcs, std::span<const Window> windows);
+
+    public:
+        std::vector<XLEN>         m_pc;        // instruction address
+        std::vector<XLEN>         m_pcn;       // next PC
+        std::vector<XLEN>         m_lsu_adr;   // LSU address
+        std::vector<std::uint8_t> m_lsu_size;  // LSU access size (0 if none), stores are flagged
+        std::vector<std::uint8_t> m_gpr_idx;   // GPR destination (0 if none)
+        [[no_unique_address]] std::conditional_t<EXT.F, std::vector<std::uint8_t>, None> m_fpr_idx;
+        [[no_unique_address]] std::conditional_t<EXT.V, std::vector<std::uint8_t>, None> m_vec_idx;
+        std::vector<std::size_t>  m_ill;       // positions of illegal instructions
+        std::uint8_t              m_lsu_max = 0;
+
+        std::size_t size () const { return m_pc.size(); };
+        // LSU access size and kind at a trace position
+        std::size_t lsuSize  (const std::size_t pos) const { return m_lsu_size[pos] & ~STORE; };
+        bool        lsuStore (const std::size_t pos) const { return m_lsu_size[pos] &  STORE; };
+        void push  (const Retired<XLEN, FLEN, VLEN>& ret);
+        void clear ();
+
+        // LSU address windows of watchpoint intervals (base, size),
+        // valid until a wider access is pushed (see 'm_lsu_max')
+        std::vector<Window> windows (std::span<const std::pair<XLEN, XLEN>> ranges) const;
+
+        // first (forward) or last (backward) position in [from, to) which
+        // executes an instruction at an address in 'pcs', accesses an
+        // interval (base, size) in 'ranges' or is an illegal instruction
+        std::optional<std::size_t> find (
+            const std::size_t from, const std::size_t to, const bool forward,
+            std::span<const XLEN> pcs, std::span<const std::pair<XLEN, XLEN>> ranges, std::span<const Window> windows) const;
+    };
+
+    template <typename XLEN, typename FLEN, typename VLEN, ExtensionsRiscV EXT>
+    void Columns<XLEN, FLEN, VLEN, EXT>::push (const Retired<XLEN, FLEN, VLEN>& ret) {
+        const std::size_t size = std::max(ret.lsu.rdt.size(), ret.lsu.wdt.size());
+        if (ret.ifu.ill)  m_ill.push_back(m_pc.size());
+        m_pc      .push_back(ret.ifu.adr);
+        m_pcn     .push_back(ret.ifu.pcn);
+        m_lsu_adr .push_back(ret.lsu.adr);
+        m_lsu_size.push_back(size | (ret.lsu.wdt.empty() ? 0 : STORE));
+        m_gpr_idx .push_back(ret.gpr.wdt.empty() ? 0 : ret.gpr.idx);
+        if constexpr (EXT.F)  m_fpr_idx.push_back(ret.fpr.idx);
+        if constexpr (EXT.V)  m_vec_idx.push_back(ret.vec.idx);
+        m_lsu_max = std::max<std::size_t>(m_lsu_max, size);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, ExtensionsRiscV EXT>
+    void Columns<XLEN, FLEN, VLEN, EXT>::clear () {
+        m_pc      .clear();
+        m_pcn     .clear();
+        m_lsu_adr .clear();
+        m_lsu_size.clear();
+        m_gpr_idx .clear();
+        if constexpr (EXT.F)  m_fpr_idx.clear();
+        if constexpr (EXT.V)  m_vec_idx.clear();
+        m_ill     .clear();
+        m_lsu_max = 0;
+    }
+
+    // unsigned 'x - lo < num' is a signed compare with flipped sign bits
+    template <typename XLEN, typename FLEN, typename VLEN, ExtensionsRiscV EXT>
+    std::uint32_t Columns<XLEN, FLEN, VLEN, EXT>::lanes (
+        [[maybe_unused]] const XLEN*                  pc,
+        [[maybe_unused]] const XLEN*                  adr,
+        [[maybe_unused]] std::span<const XLEN>        pcs,
+        [[maybe_unused]] std::span<const Window>      windows
+    ) {
+#if defined(__AVX2__)
+        const __m256i vpc  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pc ));
+        const __m256i vadr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(adr));
+        __m256i acc = _mm256_setzero_si256();
+        if constexpr (sizeof(XLEN) == 4) {
+            const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+            for (const XLEN key : pcs)  acc = _mm256_or_si256(acc, _mm256_cmpeq_epi32(vpc, _mm256_set1_epi32(key)));
+            for (const auto& w : windows) {
+                const __m256i d = _mm256_xor_si256(_mm256_sub_epi32(vadr, _mm256_set1_epi32(w.lo)), sign);
+                acc = _mm256_or_si256(acc, _mm256_cmpgt_epi32(_mm256_set1_epi32(w.num ^ 0x8000'0000u), d));
+            }
+            return _mm256_movemask_ps(_mm256_castsi256_ps(acc));
+        } else {
+            const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+            for (const XLEN key : pcs)  acc = _mm256_or_si256(acc, _mm256_cmpeq_epi64(vpc, _mm256_set1_epi64x(key)));
+            for (const auto& w : windows) {
+                const __m256i d = _mm256_xor_si256(_mm256_sub_epi64(vadr, _mm256_set1_epi64x(w.lo)), sign);
+                acc = _mm256_or_si256(acc, _mm256_cmpgt_epi64(_mm256_set1_epi64x(w.num ^ 0x8000'0000'0000'0000u), d));
+            }
+            return _mm256_movemask_pd(_mm256_castsi256_pd(acc));
+        }
+#elif defined(__SSE2__)
+        if constexpr (sizeof(XLEN) == 4) {
+            const __m128i vpc  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pc ));
+            const __m128i vadr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(adr));
+            const __m128i sign = _mm_set1_epi32(INT32_MIN);
+            __m128i acc = _mm_setzero_si128();
+            for (const XLEN key : pcs)  acc = _mm_or_si128(acc, _mm_cmpeq_epi32(vpc, _mm_set1_epi32(key)));
+            for (const auto& w : windows) {
+                const __m128i d = _mm_xor_si128(_mm_sub_epi32(vadr, _mm_set1_epi32(w.lo)), sign);
+                acc = _mm_or_si128(acc, _mm_cmpgt_epi32(_mm_set1_epi32(w.num ^ 0x8000'0000u), d));
+            }
+            return _mm_movemask_ps(_mm_castsi128_ps(acc));
+        }
+#endif
+        return 0;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, ExtensionsRiscV EXT>
+    auto Columns<XLEN, FLEN, VLEN, EXT>::windows (std::span<const std::pair<XLEN, XLEN>> ranges) const -> std::vector<Window> {
+        // an access [adr, adr+size) overlaps [base, base+len) if 'adr' is in the window
+        std::vector<Window> windows;
+        if (m_lsu_max > 0) {
+            for (const auto [base, len] : ranges)  windows.push_back({static_cast<XLEN>(base - (m_lsu_max - 1)), static_cast<XLEN>(len + (m_lsu_max - 1))});
+        }
+        return windows;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, ExtensionsRiscV EXT>
+    std::optional<std::size_t> Columns<XLEN, FLEN, VLEN, EXT>::find (
+        const std::size_t                          from,
+        const std::size_t                          to,
+        const bool                                 forward,
+        std::span<const XLEN>                      pcs,
+        std::span<const std::pair<XLEN, XLEN>>     ranges,
+        std::span<const Window>                    windows
+    ) const {
+        // exact check of a candidate
+        auto match = [&](const std::size_t pos) {
+            if (std::ranges::find(pcs, m_pc[pos]) != pcs.end())  return true;
+            const XLEN adr  = m_lsu_adr[pos];
+            const XLEN size = m_lsu_size[pos] & ~STORE;
+            if (size == 0)  return false;
+            return std::ranges::any_of(ranges, [&](const auto& r) { return (adr < r.first + r.second) && (adr + size > r.first); });
+        };
+        auto first = [&](const std::uint32_t mask) { return std::countr_zero(mask); };
+        auto last  = [&](const std::uint32_t mask) { return 31 - std::countl_zero(mask); };
+
+        // illegal instructions always stop the replay
+        std::optional<std::size_t> ill;
+        if (forward) {
+            const auto it = std::ranges::lower_bound(m_ill, from);
+            if (it != m_ill.end() && *it < to)  ill = *it;
+        } else {
+            const auto it = std::ranges::lower_bound(m_ill, to);
+            if (it != m_ill.begin() && *std::prev(it) >= from)  ill = *std::prev(it);
+        }
+        const std::size_t lo = (!forward && ill) ? *ill + 1 : from;
+        const std::size_t hi = ( forward && ill) ? *ill     : to;
+
+        if (forward) {
+            std::size_t i = lo;
+            if constexpr (LANES > 0) {
+                for (; i + LANES <= hi; i += LANES) {
+                    for (std::uint32_t mask = lanes(&m_pc[i], &m_lsu_adr[i], pcs, windows); mask; mask &= mask - 1) {
+                        if (match(i + first(mask)))  return i + first(mask);
+                    }
+                }
+            }
+            for (; i < hi; i++)  if (match(i))  return i;
+        } else {
+            std::size_t i = hi;
+            if constexpr (LANES > 0) {
+                for (; i >= lo + LANES; i -= LANES) {
+                    for (std::uint32_t mask = lanes(&m_pc[i - LANES], &m_lsu_adr[i - LANES], pcs, windows); mask; mask &= ~(1u << last(mask))) {
+                        if (match(i - LANES + last(mask)))  return i - LANES + last(mask);
+                    }
+                }
+            }
+            for (; i > lo; i--)  if (match(i - 1))  return i - 1;
+        }
+        return ill;
+    }
+
+}
@@ -39,6 +39,47 @@ namespace shadow {
 //        // constructor/destructor
 //        Core () = default;
 //        ~Core () = default;
+
+        // instruction counter
+        size_t count () const { return cnt; };
+
+        // replay/revert retired instruction to/from DUT shadow state
+        template <typename RET>
+        void replay (RET& ret);
+        template <typename RET>
+        void revert (RET& ret);
     };
 
+    // apply the retired instruction to the shadow and increment the counter
+    template <typename REGS, typename MMAP, typename POINT>
+    template <typename RET>
+    void Core<REGS, MMAP, POINT>::replay (RET& ret) {
+        // PC
+        REGS::writePc(ret.ifu.pcn);
+        // GPR remember the old value and apply the new one
+        if (ret.gpr.wdt.size() > 0) {
+            auto old = REGS::writeGpr(ret.gpr.idx, ret.gpr.wdt[0]);
+            if (ret.gpr.rdt.size() == 0)  ret.gpr.rdt.push_back(old);
+        }
+        // TODO: CSR (retired CSR does not have an enable yet)
+        // core local memory/IO (the system address map is handled by the system)
+        if (MMAP::contains(ret.lsu.adr))  MMAP::replay(cnt, ret.lsu);
+        cnt++;
+    }
+
+    // decrement the counter and revert the retired instruction from the shadow
+    template <typename REGS, typename MMAP, typename POINT>
+    template <typename RET>
+    void Core<REGS, MMAP, POINT>::revert (RET& ret) {
+        cnt--;
+        // PC
+        REGS::writePc(ret.ifu.adr);
+        // GPR restore the old value
+        if (ret.gpr.rdt.size() > 0) {
+            REGS::writeGpr(ret.gpr.idx, ret.gpr.rdt[0]);
+        }
+        // core local memory/IO
+        if (MMAP::contains(ret.lsu.adr))  MMAP::revert(cnt, ret.lsu);
+    }
+
 };
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB flat (read only) trace position index
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+
+// C++ includes
+#include <vector>
+#include <span>
+#include <memory>
+#include <algorithm>
+
+namespace shadow {
+
+    // Trace positions grouped by key (instruction address, store address)
+    // in compressed sparse row layout: sorted unique keys, offsets into the
+    // position array (one more than keys) and positions in ascending order.
+    // The arrays are either owned by the index or views into a mapped
+    // sidecar file, the owner keeps the storage alive.
+    template <typename KEY>
+    class FlatIndex {
+        std::span<const KEY>         m_keys;
+        std::span<const std::size_t> m_offsets;
+        std::span<const std::size_t> m_positions;
+        std::size_t                  m_count = 0;  // number of indexed trace positions
+        std::shared_ptr<const void>  m_owner;
+
+    public:
+        FlatIndex () = default;
+        FlatIndex (std::span<const KEY> keys, std::span<const std::size_t> offsets, std::span<const std::size_t> positions,
+                   const std::size_t count, std::shared_ptr<const void> owner) :
+            m_keys(keys),
+            m_offsets(offsets),
+            m_positions(positions),
+            m_count(count),
+            m_owner(std::move(owner))
+        { }
+
+        // index trace positions [0, count) with the key 'key(pos)', where 'filter(pos)' holds
+        template <typename FKEY, typename FILTER>
+        static FlatIndex build (const std::size_t count, FKEY&& key, FILTER&& filter);
+
+        std::size_t count () const { return m_count; };
+
+        std::span<const KEY>         keys      () const { return m_keys; };
+        std::span<const std::size_t> offsets   () const { return m_offsets; };
+        std::span<const std::size_t> positions () const { return m_positions; };
+
+        // positions with the given key
+        std::span<const std::size_t> find (const KEY key) const;
+
+        // layout check of arrays from an untrusted source (sidecar file)
+        bool valid () const;
+    };
+
+    template <typename KEY>
+    template <typename FKEY, typename FILTER>
+    FlatIndex<KEY> FlatIndex<KEY>::build (const std::size_t count, FKEY&& key, FILTER&& filter) {
+        struct Storage {
+            std::vector<KEY>         keys;
+            std::vector<std::size_t> offsets;
+            std::vector<std::size_t> positions;
+        };
+        auto storage { std::make_shared<Storage>() };
+        // (key, position) pairs, a stable sort keeps positions ascending
+        std::vector<std::pair<KEY, std::size_t>> pairs;
+        for (std::size_t pos=0; pos<count; pos++) {
+            if (filter(pos))  pairs.emplace_back(key(pos), pos);
+        }
+        std::ranges::stable_sort(pairs, {}, &std::pair<KEY, std::size_t>::first);
+        storage->positions.reserve(pairs.size());
+        for (std::size_t i=0; i<pairs.size(); i++) {
+            if (i == 0 || pairs[i].first != pairs[i-1].first) {
+                storage->keys   .push_back(pairs[i].first);
+                storage->offsets.push_back(i);
+            }
+            storage->positions.push_back(pairs[i].second);
+        }
+        storage->offsets.push_back(pairs.size());
+        return FlatIndex { storage->keys, storage->offsets, storage->positions, count, storage };
+    }
+
+    template <typename KEY>
+    std::span<const std::size_t> FlatIndex<KEY>::find (const KEY key) const {
+        const auto it = std::ranges::lower_bound(m_keys, key);
+        if (it == m_keys.end() || *it != key)  return { };
+        const std::size_t i = it - m_keys.begin();
+        return m_positions.subspan(m_offsets[i], m_offsets[i+1] - m_offsets[i]);
+    }
+
+    template <typename KEY>
+    bool FlatIndex<KEY>::valid () const {
+        // unique sorted keys, one offset per key and the end offset
+        if (m_offsets.size() != m_keys.size() + 1)  return false;
+        if (m_offsets.front() != 0 || m_offsets.back() != m_positions.size())  return false;
+        if (!std::ranges::is_sorted(m_offsets))  return false;
+        if (std::ranges::adjacent_find(m_keys, std::ranges::greater_equal{}) != m_keys.end())  return false;
+        // positions of each key are ascending and within the trace
+        for (std::size_t i=0; i<m_keys.size(); i++) {
+            const auto row { m_positions.subspan(m_offsets[i], m_offsets[i+1] - m_offsets[i]) };
+            if (std::ranges::adjacent_find(row, std::ranges::greater_equal{}) != row.end())  return false;
+            if (!row.empty() && row.back() >= m_count)  return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB DUT shadow I/O register store
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// C++ includes
+#include <vector>
+#include <span>
+#include <bit>
+#include <algorithm>
+
+namespace shadow {
+
+    // Flat open-addressing store for memory mapped I/O registers.
+    // Registers are indexed by XLEN aligned address, each register holds
+    // a chain of values observed by the DUT (taken from retired LSU accesses),
+    // and a cursor pointing to the value valid at the current shadow position.
+    // Replay/revert move the cursor along the chain, so reverse execution
+    // sees the exact value each I/O read returned at that moment.
+    template <typename XLEN>
+    class IoStore {
+
+        // unused slot/log index
+        static constexpr std::uint32_t NONE = ~std::uint32_t{0};
+        // minimum hash table size (the hash shift must be below 64)
+        static constexpr std::size_t   SLOTS_MIN = 2;
+
+        // I/O access log entry (value after the access)
+        struct Access {
+            std::size_t   cnt;   // retired instruction counter
+            XLEN          data;  // register value after access
+            std::uint32_t prev;  // previous access to the same register
+            std::uint32_t next;  // next     access to the same register
+        };
+
+        // hash table slot
+        struct Slot {
+            XLEN          addr;   // XLEN aligned register address
+            std::uint32_t first;  // first recorded access
+            std::uint32_t cur;    // access valid at the current shadow position
+        };
+
+        // hash table (power of 2 size, linear probing)
+        std::vector<Slot>   m_slot;
+        std::size_t         m_used = 0;
+
+        // access log (append only, chained per register)
+        std::vector<Access> m_log;
+
+        // buffer for reads spanning multiple registers
+        std::vector<std::byte> m_tmp;
+
+        // hash table index
+        std::size_t hash (const XLEN addr) const;
+        // find slot (returns an unused slot if register does not exist)
+        Slot& lookup (const XLEN addr);
+        // find slot (creates the register if it does not exist)
+        Slot& acquire (const XLEN addr);
+        // grow hash table when half full
+        void rehash ();
+        // access following the current shadow position
+        std::uint32_t following (const Slot& slot) const;
+        // insert access into the register chain after the current shadow position
+        void insert (Slot& slot, const std::size_t cnt, const XLEN data);
+
+    public:
+        // constructor
+        IoStore (const std::size_t size = 256);
+
+        // DUT access at retired instruction counter
+        void replay (const std::size_t cnt, const XLEN addr, std::span<const std::byte> data);
+        void revert (const std::size_t cnt, const XLEN addr);
+
+        // debugger access at the current shadow position
+        std::span<std::byte> read  (const XLEN addr, const std::size_t size);
+        void                 write (const XLEN addr, std::span<const std::byte> data);
+
+        // number of registers/accesses
+        std::size_t size   () const { return m_used; };
+        std::size_t length () const { return m_log.size(); };
+    };
+
+    template <typename XLEN>
+    IoStore<XLEN>::IoStore (const std::size_t size) :
+        m_slot(std::bit_ceil(std::max(size, SLOTS_MIN)), Slot{0, NONE, NONE})
+    {
+        m_log.reserve(size);
+    }
+
+    // Fibonacci hashing of the register index
+    template <typename XLEN>
+    std::size_t IoStore<XLEN>::hash (const XLEN addr) const {
+        const std::uint64_t idx = addr / sizeof(XLEN);
+        return (idx * 0x9e37'79b9'7f4a'7c15ull) >> (64 - std::countr_zero(m_slot.size()));
+    }
+
+    template <typename XLEN>
+    typename IoStore<XLEN>::Slot& IoStore<XLEN>::lookup (const XLEN addr) {
+        const std::size_t mask = m_slot.size() - 1;
+        for (std::size_t i = hash(addr);; i = (i+1) & mask) {
+            Slot& slot = m_slot[i];
+            if (slot.first == NONE || slot.addr == addr)  return slot;
+        }
+    }
+
+    template <typename XLEN>
+    typename IoStore<XLEN>::Slot& IoStore<XLEN>::acquire (const XLEN addr) {
+        Slot* slot = &lookup(addr);
+        if (slot->first == NONE) {
+            // new register
+            if (2 * (m_used + 1) > m_slot.size()) {
+                rehash();
+                slot = &lookup(addr);
+            }
+            slot->addr = addr;
+            m_used++;
+        }
+        return *slot;
+    }
+
+    template <typename XLEN>
+    void IoStore<XLEN>::rehash () {
+        std::vector<Slot> tmp (m_slot.size() * 2, Slot{0, NONE, NONE});
+        std::swap(m_slot, tmp);
+        for (const auto& slot : tmp) {
+            if (slot.first != NONE)  lookup(slot.addr) = slot;
+        }
+    }
+
+    template <typename XLEN>
+    std::uint32_t IoStore<XLEN>::following (const Slot& slot) const {
+        return (slot.cur == NONE) ? slot.first : m_log[slot.cur].next;
+    }
+
+    template <typename XLEN>
+    void IoStore<XLEN>::insert (Slot& slot, const std::size_t cnt, const XLEN data) {
+        const auto idx = static_cast<std::uint32_t>(m_log.size());
+        const std::uint32_t next = following(slot);
+        m_log.push_back({cnt, data, slot.cur, next});
+        if (slot.cur != NONE)  m_log[slot.cur].next = idx;
+        else                   slot.first          = idx;
+        if (next     != NONE)  m_log[next    ].prev = idx;
+        slot.cur = idx;
+    }
+
+    // replay DUT access (records the access the first time it is seen)
+    template <typename XLEN>
+    void IoStore<XLEN>::replay (
+        const std::size_t          cnt,
+        const XLEN                 addr,
+        std::span<const std::byte> data
+    ) {
+        const XLEN base = addr - addr % sizeof(XLEN);
+        Slot& slot = acquire(base);
+        // follow the already recorded chain
+        const std::uint32_t next = following(slot);
+        if (next != NONE && m_log[next].cnt == cnt) {
+            slot.cur = next;
+            return;
+        }
+        // merge accessed bytes into the previous register value
+        XLEN val = (slot.cur == NONE) ? XLEN{0} : m_log[slot.cur].data;
+        const std::size_t off = addr - base;
+        std::memcpy(reinterpret_cast<std::byte *>(&val) + off, data.data(), std::min(data.size(), sizeof(XLEN) - off));
+        insert(slot, cnt, val);
+    }
+
+    // revert DUT access
+    template <typename XLEN>
+    void IoStore<XLEN>::revert (
+        const std::size_t cnt,
+        const XLEN        addr
+    ) {
+        Slot& slot = lookup(addr - addr % sizeof(XLEN));
+        if (slot.cur != NONE && m_log[slot.cur].cnt == cnt) {
+            slot.cur = m_log[slot.cur].prev;
+        }
+    }
+
+    // read register values at the current shadow position
+    template <typename XLEN>
+    std::span<std::byte> IoStore<XLEN>::read (
+        const XLEN        addr,
+        const std::size_t size
+    ) {
+        m_tmp.assign(size, std::byte{0});
+        for (std::size_t i = 0; i < size;) {
+            const XLEN base = (addr + i) - (addr + i) % sizeof(XLEN);
+            const std::size_t off = (addr + i) - base;
+            const std::size_t len = std::min(size - i, sizeof(XLEN) - off);
+            const Slot& slot = lookup(base);
+            // TODO: handle access to nonexistent entries with a warning?
+            if (slot.cur != NONE) {
+                std::memcpy(m_tmp.data() + i, reinterpret_cast<const std::byte *>(&m_log[slot.cur].data) + off, len);
+            }
+            i += len;
+        }
+        return m_tmp;
+    }
+
+    // debugger write (overrides the value at the current shadow position)
+    template <typename XLEN>
+    void IoStore<XLEN>::write (
+        const XLEN                 addr,
+        std::span<const std::byte> data
+    ) {
+        for (std::size_t i = 0; i < data.size();) {
+            const XLEN base = (addr + i) - (addr + i) % sizeof(XLEN);
+            const std::size_t off = (addr + i) - base;
+            const std::size_t len = std::min(data.size() - i, sizeof(XLEN) - off);
+            Slot& slot = acquire(base);
+            if (slot.cur == NONE) {
+                // without a value at the current shadow position (new register, or before
+                // its first DUT access) the value gets an entry at counter 0 ahead of the chain
+                XLEN val = 0;
+                std::memcpy(reinterpret_cast<std::byte *>(&val) + off, data.data() + i, len);
+                insert(slot, 0, val);
+            } else {
+                std::memcpy(reinterpret_cast<std::byte *>(&m_log[slot.cur].data) + off, data.data() + i, len);
+            }
+            i += len;
+        }
+    }
+
+}
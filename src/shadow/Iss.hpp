@@ -0,0 +1,394 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB RISC-V instruction set simulator (RV32I/RV64I + M)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// C++ includes
+#include <array>
+#include <span>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+// HDLDB includes
+#include "Instruction.hpp"
+
+namespace shadow {
+
+    // instruction operations
+    enum class IssOp : std::uint8_t {
+        lui, auipc, jal, jalr,
+        beq, bne, blt, bge, bltu, bgeu,
+        lb, lh, lw, ld, lbu, lhu, lwu,
+        sb, sh, sw, sd,
+        addi, slti, sltiu, xori, ori, andi, slli, srli, srai,
+        add, sub, sll, slt, sltu, xor_, srl, sra, or_, and_,
+        addiw, slliw, srliw, sraiw,
+        addw, subw, sllw, srlw, sraw,
+        mul, mulh, mulhsu, mulhu, div, divu, rem, remu,
+        mulw, divw, divuw, remw, remuw,
+        fence
+    };
+
+    // decoder table entry
+    struct IssDecode {
+        std::uint32_t mask;
+        std::uint32_t match;
+        IssOp         op;
+        bool          rv64;  // RV64 only
+    };
+
+    // decoder table (ordered by opcode)
+    constexpr std::array<IssDecode, 66> issTable { {
+        // U/J types
+        {0x0000007f, 0x00000037, IssOp::lui   , false},
+        {0x0000007f, 0x00000017, IssOp::auipc , false},
+        {0x0000007f, 0x0000006f, IssOp::jal   , false},
+        {0x0000707f, 0x00000067, IssOp::jalr  , false},
+        // branches
+        {0x0000707f, 0x00000063, IssOp::beq   , false},
+        {0x0000707f, 0x00001063, IssOp::bne   , false},
+        {0x0000707f, 0x00004063, IssOp::blt   , false},
+        {0x0000707f, 0x00005063, IssOp::bge   , false},
+        {0x0000707f, 0x00006063, IssOp::bltu  , false},
+        {0x0000707f, 0x00007063, IssOp::bgeu  , false},
+        // loads
+        {0x0000707f, 0x00000003, IssOp::lb    , false},
+        {0x0000707f, 0x00001003, IssOp::lh    , false},
+        {0x0000707f, 0x00002003, IssOp::lw    , false},
+        {0x0000707f, 0x00003003, IssOp::ld    , true },
+        {0x0000707f, 0x00004003, IssOp::lbu   , false},
+        {0x0000707f, 0x00005003, IssOp::lhu   , false},
+        {0x0000707f, 0x00006003, IssOp::lwu   , true },
+        // stores
+        {0x0000707f, 0x00000023, IssOp::sb    , false},
+        {0x0000707f, 0x00001023, IssOp::sh    , false},
+        {0x0000707f, 0x00002023, IssOp::sw    , false},
+        {0x0000707f, 0x00003023, IssOp::sd    , true },
+        // fence (no effect on the shadow)
+        {0x0000707f, 0x0000000f, IssOp::fence , false},
+        // immediate
+        {0x0000707f, 0x00000013, IssOp::addi  , false},
+        {0x0000707f, 0x00002013, IssOp::slti  , false},
+        {0x0000707f, 0x00003013, IssOp::sltiu , false},
+        {0x0000707f, 0x00004013, IssOp::xori  , false},
+        {0x0000707f, 0x00006013, IssOp::ori   , false},
+        {0x0000707f, 0x00007013, IssOp::andi  , false},
+        // (shamt[5] is only legal on RV64)
+        {0xfe00707f, 0x00001013, IssOp::slli  , false},
+        {0xfe00707f, 0x00005013, IssOp::srli  , false},
+        {0xfe00707f, 0x40005013, IssOp::srai  , false},
+        {0xfc00707f, 0x00001013, IssOp::slli  , true },
+        {0xfc00707f, 0x00005013, IssOp::srli  , true },
+        {0xfc00707f, 0x40005013, IssOp::srai  , true },
+        // immediate (word)
+        {0x0000707f, 0x0000001b, IssOp::addiw , true },
+        {0xfe00707f, 0x0000101b, IssOp::slliw , true },
+        {0xfe00707f, 0x0000501b, IssOp::srliw , true },
+        {0xfe00707f, 0x4000501b, IssOp::sraiw , true },
+        // register
+        {0xfe00707f, 0x00000033, IssOp::add   , false},
+        {0xfe00707f, 0x40000033, IssOp::sub   , false},
+        {0xfe00707f, 0x00001033, IssOp::sll   , false},
+        {0xfe00707f, 0x00002033, IssOp::slt   , false},
+        {0xfe00707f, 0x00003033, IssOp::sltu  , false},
+        {0xfe00707f, 0x00004033, IssOp::xor_  , false},
+        {0xfe00707f, 0x00005033, IssOp::srl   , false},
+        {0xfe00707f, 0x40005033, IssOp::sra   , false},
+        {0xfe00707f, 0x00006033, IssOp::or_   , false},
+        {0xfe00707f, 0x00007033, IssOp::and_  , false},
+        {0xfe00707f, 0x02000033, IssOp::mul   , false},
+        {0xfe00707f, 0x02001033, IssOp::mulh  , false},
+        {0xfe00707f, 0x02002033, IssOp::mulhsu, false},
+        {0xfe00707f, 0x02003033, IssOp::mulhu , false},
+        {0xfe00707f, 0x02004033, IssOp::div   , false},
+        {0xfe00707f, 0x02005033, IssOp::divu  , false},
+        {0xfe00707f, 0x02006033, IssOp::rem   , false},
+        {0xfe00707f, 0x02007033, IssOp::remu  , false},
+        // register (word)
+        {0xfe00707f, 0x0000003b, IssOp::addw  , true },
+        {0xfe00707f, 0x4000003b, IssOp::subw  , true },
+        {0xfe00707f, 0x0000103b, IssOp::sllw  , true },
+        {0xfe00707f, 0x0000503b, IssOp::srlw  , true },
+        {0xfe00707f, 0x4000503b, IssOp::sraw  , true },
+        {0xfe00707f, 0x0200003b, IssOp::mulw  , true },
+        {0xfe00707f, 0x0200403b, IssOp::divw  , true },
+        {0xfe00707f, 0x0200503b, IssOp::divuw , true },
+        {0xfe00707f, 0x0200603b, IssOp::remw  , true },
+        {0xfe00707f, 0x0200703b, IssOp::remuw , true },
+    } };
+
+    // table index range for each major opcode
+    constexpr std::array<std::pair<std::uint8_t, std::uint8_t>, 128> issIndex { [] {
+        std::array<std::pair<std::uint8_t, std::uint8_t>, 128> idx { };
+        for (std::size_t opc=0; opc<128; opc++) {
+            idx[opc] = {0, 0};
+            bool found = false;
+            for (std::size_t i=0; i<issTable.size(); i++) {
+                if ((issTable[i].match & 0x7f) != opc)  continue;
+                if (!found)  idx[opc].first = i;
+                idx[opc].second = i + 1;
+                found = true;
+            }
+        }
+        return idx;
+    }() };
+
+    // The ISS predicts the retired instruction at the current PC from the shadow state,
+    // so a trace only has to record what can not be deduced (I/O load values,
+    // interrupts, DUT divergences), everything else is reconstructed by re-executing.
+    template <typename XLEN, typename FLEN, typename VLEN>
+    class Iss {
+        using SXLEN = std::make_signed_t<XLEN>;
+
+        static constexpr bool RV64 = sizeof(XLEN) == 8;
+
+        // immediate decoding
+        static constexpr SXLEN immI (std::uint32_t i) { return static_cast<std::int32_t>(i) >> 20; };
+        static constexpr SXLEN immS (std::uint32_t i) { return (static_cast<std::int32_t>(i & 0xfe000000) >> 20) | ((i >> 7) & 0x1f); };
+        static constexpr SXLEN immB (std::uint32_t i) {
+            return (static_cast<std::int32_t>(i & 0x80000000) >> 19) | ((i & 0x80) << 4) | ((i >> 20) & 0x7e0) | ((i >> 7) & 0x1e);
+        };
+        static constexpr SXLEN immU (std::uint32_t i) { return static_cast<std::int32_t>(i & 0xfffff000); };
+        static constexpr SXLEN immJ (std::uint32_t i) {
+            return (static_cast<std::int32_t>(i & 0x80000000) >> 11) | (i & 0xff000) | ((i >> 9) & 0x800) | ((i >> 20) & 0x7fe);
+        };
+
+        // sign extension of a 32 bit result (RV64 word instructions)
+        static constexpr XLEN sextW (std::uint64_t val) { return static_cast<XLEN>(static_cast<SXLEN>(static_cast<std::int32_t>(val))); };
+
+        // high part of the 2*XLEN bit product
+        static XLEN mulhu (XLEN a, XLEN b);
+        static XLEN mulh  (XLEN a, XLEN b);
+        static XLEN mulhsu(XLEN a, XLEN b);
+
+    public:
+        // decode instruction (nullptr if the instruction is not modeled)
+        static const IssDecode* decode (std::uint32_t insn);
+
+        // predict the retired instruction (the shadow state is not changed)
+        //   FETCH(addr, size) returns instruction memory contents
+        //   LOAD (addr, size) returns data memory contents (or the value recorded in a trace)
+        // returns false for instructions which are not modeled (CSR, compressed, ...)
+        template <typename REGS, typename FETCH, typename LOAD>
+        static bool execute (const REGS& regs, FETCH&& fetch, LOAD&& load, Retired<XLEN, FLEN, VLEN>& ret);
+
+        // compare the predicted and DUT retired instruction (before the DUT instruction is replayed)
+        static bool same (const Retired<XLEN, FLEN, VLEN>& a, const Retired<XLEN, FLEN, VLEN>& b);
+    };
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    const IssDecode* Iss<XLEN, FLEN, VLEN>::decode (std::uint32_t insn) {
+        const auto [first, last] = issIndex[insn & 0x7f];
+        for (std::size_t i=first; i<last; i++) {
+            const auto& dec = issTable[i];
+            if (((insn & dec.mask) == dec.match) && (RV64 || !dec.rv64))  return &dec;
+        }
+        return nullptr;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    XLEN Iss<XLEN, FLEN, VLEN>::mulhu (XLEN a, XLEN b) {
+        if constexpr (RV64) {
+            return static_cast<XLEN>((static_cast<unsigned __int128>(a) * b) >> 64);
+        } else {
+            return static_cast<XLEN>((static_cast<std::uint64_t>(a) * b) >> 32);
+        }
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    XLEN Iss<XLEN, FLEN, VLEN>::mulh (XLEN a, XLEN b) {
+        if constexpr (RV64) {
+            return static_cast<XLEN>((static_cast<__int128>(static_cast<SXLEN>(a)) * static_cast<SXLEN>(b)) >> 64);
+        } else {
+            return static_cast<XLEN>((static_cast<std::int64_t>(static_cast<SXLEN>(a)) * static_cast<SXLEN>(b)) >> 32);
+        }
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    XLEN Iss<XLEN, FLEN, VLEN>::mulhsu (XLEN a, XLEN b) {
+        if constexpr (RV64) {
+            return static_cast<XLEN>((static_cast<__int128>(static_cast<SXLEN>(a)) * static_cast<unsigned __int128>(b)) >> 64);
+        } else {
+            return static_cast<XLEN>((static_cast<std::int64_t>(static_cast<SXLEN>(a)) * static_cast<std::int64_t>(b)) >> 32);
+        }
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    template <typename REGS, typename FETCH, typename LOAD>
+    bool Iss<XLEN, FLEN, VLEN>::execute (const REGS& regs, FETCH&& fetch, LOAD&& load, Retired<XLEN, FLEN, VLEN>& ret) {
+        ret = { };
+        const XLEN pc = regs.readPc();
+        ret.ifu.adr = pc;
+
+        // fetch (compressed instructions are not modeled)
+        const std::span<const std::byte> code { fetch(pc, 4) };
+        if (code.size() < 4)  return false;
+        std::uint32_t insn;
+        std::memcpy(&insn, code.data(), 4);
+        if ((insn & 0x3) != 0x3)  return false;
+        ret.ifu.rdt.assign(code.begin(), code.begin() + 4);
+
+        const IssDecode* dec = decode(insn);
+        if (dec == nullptr)  return false;
+
+        const unsigned rd  = (insn >>  7) & 0x1f;
+        const unsigned rs1 = (insn >> 15) & 0x1f;
+        const unsigned rs2 = (insn >> 20) & 0x1f;
+        const XLEN     a   = regs.readGpr(rs1);
+        const XLEN     b   = regs.readGpr(rs2);
+        const SXLEN    sa  = static_cast<SXLEN>(a);
+        const SXLEN    sb  = static_cast<SXLEN>(b);
+        const unsigned sh  = (insn >> 20) & (RV64 ? 0x3f : 0x1f);
+        const XLEN     imm = static_cast<XLEN>(immI(insn));
+
+        XLEN pcn = pc + 4;
+        bool wen = true;  // GPR write enable
+        XLEN val = 0;
+
+        // memory load/store
+        auto ld = [&](XLEN adr, std::size_t size, bool sign) -> XLEN {
+            const std::span<const std::byte> data { load(adr, size) };
+            ret.lsu.adr = adr;
+            ret.lsu.rdt.assign(data.begin(), data.begin() + std::min(size, data.size()));
+            std::uint64_t raw = 0;
+            std::memcpy(&raw, ret.lsu.rdt.data(), ret.lsu.rdt.size());
+            if (sign && size < 8) {
+                const std::uint64_t m = std::uint64_t{1} << (8*size - 1);
+                raw = (raw ^ m) - m;
+            }
+            return static_cast<XLEN>(raw);
+        };
+        auto st = [&](XLEN adr, std::size_t size) {
+            ret.lsu.adr = adr;
+            ret.lsu.wdt.resize(size);
+            std::memcpy(ret.lsu.wdt.data(), &b, size);
+            wen = false;
+        };
+        auto branch = [&](bool taken) {
+            if (taken)  pcn = pc + static_cast<XLEN>(immB(insn));
+            wen = false;
+        };
+
+        switch (dec->op) {
+            case IssOp::lui   : val = static_cast<XLEN>(immU(insn)); break;
+            case IssOp::auipc : val = pc + static_cast<XLEN>(immU(insn)); break;
+            case IssOp::jal   : val = pc + 4; pcn = pc + static_cast<XLEN>(immJ(insn)); break;
+            case IssOp::jalr  : val = pc + 4; pcn = (a + imm) & ~XLEN{1}; break;
+            case IssOp::beq   : branch(a == b); break;
+            case IssOp::bne   : branch(a != b); break;
+            case IssOp::blt   : branch(sa <  sb); break;
+            case IssOp::bge   : branch(sa >= sb); break;
+            case IssOp::bltu  : branch(a <  b); break;
+            case IssOp::bgeu  : branch(a >= b); break;
+            case IssOp::lb    : val = ld(a + imm, 1, true ); break;
+            case IssOp::lh    : val = ld(a + imm, 2, true ); break;
+            case IssOp::lw    : val = ld(a + imm, 4, true ); break;
+            case IssOp::ld    : val = ld(a + imm, 8, true ); break;
+            case IssOp::lbu   : val = ld(a + imm, 1, false); break;
+            case IssOp::lhu   : val = ld(a + imm, 2, false); break;
+            case IssOp::lwu   : val = ld(a + imm, 4, false); break;
+            case IssOp::sb    : st(a + static_cast<XLEN>(immS(insn)), 1); break;
+            case IssOp::sh    : st(a + static_cast<XLEN>(immS(insn)), 2); break;
+            case IssOp::sw    : st(a + static_cast<XLEN>(immS(insn)), 4); break;
+            case IssOp::sd    : st(a + static_cast<XLEN>(immS(insn)), 8); break;
+            case IssOp::fence : wen = false; break;
+            case IssOp::addi  : val = a + imm; break;
+            case IssOp::slti  : val = sa < static_cast<SXLEN>(imm); break;
+            case IssOp::sltiu : val = a < imm; break;
+            case IssOp::xori  : val = a ^ imm; break;
+            case IssOp::ori   : val = a | imm; break;
+            case IssOp::andi  : val = a & imm; break;
+            case IssOp::slli  : val = a << sh; break;
+            case IssOp::srli  : val = a >> sh; break;
+            case IssOp::srai  : val = static_cast<XLEN>(sa >> sh); break;
+            case IssOp::addiw : val = sextW(a + imm); break;
+            case IssOp::slliw : val = sextW(static_cast<std::uint32_t>(a) << (sh & 0x1f)); break;
+            case IssOp::srliw : val = sextW(static_cast<std::uint32_t>(a) >> (sh & 0x1f)); break;
+            case IssOp::sraiw : val = sextW(static_cast<std::int32_t>(a) >> (sh & 0x1f)); break;
+            case IssOp::add   : val = a + b; break;
+            case IssOp::sub   : val = a - b; break;
+            case IssOp::sll   : val = a << (b & (8*sizeof(XLEN)-1)); break;
+            case IssOp::slt   : val = sa < sb; break;
+            case IssOp::sltu  : val = a < b; break;
+            case IssOp::xor_  : val = a ^ b; break;
+            case IssOp::srl   : val = a >> (b & (8*sizeof(XLEN)-1)); break;
+            case IssOp::sra   : val = static_cast<XLEN>(sa >> (b & (8*sizeof(XLEN)-1))); break;
+            case IssOp::or_   : val = a | b; break;
+            case IssOp::and_  : val = a & b; break;
+            case IssOp::addw  : val = sextW(a + b); break;
+            case IssOp::subw  : val = sextW(a - b); break;
+            case IssOp::sllw  : val = sextW(static_cast<std::uint32_t>(a) << (b & 0x1f)); break;
+            case IssOp::srlw  : val = sextW(static_cast<std::uint32_t>(a) >> (b & 0x1f)); break;
+            case IssOp::sraw  : val = sextW(static_cast<std::int32_t>(a) >> (b & 0x1f)); break;
+            case IssOp::mul   : val = a * b; break;
+            case IssOp::mulh  : val = mulh  (a, b); break;
+            case IssOp::mulhsu: val = mulhsu(a, b); break;
+            case IssOp::mulhu : val = mulhu (a, b); break;
+            // division by zero and overflow results are defined by the ISA
+            case IssOp::div   : val = (b == 0) ? ~XLEN{0} : ((sb == -1) && (a == (XLEN{1} << (8*sizeof(XLEN)-1)))) ? a : static_cast<XLEN>(sa / sb); break;
+            case IssOp::divu  : val = (b == 0) ? ~XLEN{0} : a / b; break;
+            case IssOp::rem   : val = (b == 0) ? a : (sb == -1) ? 0 : static_cast<XLEN>(sa % sb); break;
+            case IssOp::remu  : val = (b == 0) ? a : a % b; break;
+            case IssOp::mulw  : val = sextW(static_cast<std::uint32_t>(a) * static_cast<std::uint32_t>(b)); break;
+            case IssOp::divw  : {
+                const std::int32_t x = a, y = b;
+                val = (y == 0) ? ~XLEN{0} : ((y == -1) && (x == INT32_MIN)) ? sextW(x) : sextW(x / y);
+                break;
+            }
+            case IssOp::divuw : {
+                const std::uint32_t x = a, y = b;
+                val = (y == 0) ? ~XLEN{0} : sextW(x / y);
+                break;
+            }
+            case IssOp::remw  : {
+                const std::int32_t x = a, y = b;
+                val = (y == 0) ? sextW(x) : (y == -1) ? 0 : sextW(x % y);
+                break;
+            }
+            case IssOp::remuw : {
+                const std::uint32_t x = a, y = b;
+                val = (y == 0) ? sextW(x) : sextW(x % y);
+                break;
+            }
+            default:
+                return false;
+        }
+
+        ret.ifu.pcn = pcn;
+        if (wen && (rd != 0)) {
+            ret.gpr.idx = rd;
+            ret.gpr.wdt = { val };
+        }
+        return true;
+    }
+
+    // writes to x0 are ignored, register/memory read data is not compared
+    // (the DUT might provide it, the shadow captures it on replay)
+    template <typename XLEN, typename FLEN, typename VLEN>
+    bool Iss<XLEN, FLEN, VLEN>::same (const Retired<XLEN, FLEN, VLEN>& a, const Retired<XLEN, FLEN, VLEN>& b) {
+        auto gpr = [](const Retired<XLEN, FLEN, VLEN>& r) -> std::pair<unsigned, XLEN> {
+            if (r.gpr.wdt.empty() || (r.gpr.idx == 0))  return {0, 0};
+            return {r.gpr.idx, r.gpr.wdt[0]};
+        };
+        const bool lsu = (a.lsu.wdt.empty() && a.lsu.rdt.empty()) == (b.lsu.wdt.empty() && b.lsu.rdt.empty());
+        return (a.ifu.adr == b.ifu.adr) &&
+               (a.ifu.pcn == b.ifu.pcn) &&
+               (a.ifu.ill == b.ifu.ill) &&
+               (gpr(a) == gpr(b)) &&
+               lsu &&
+               (a.lsu.wdt.empty() || ((a.lsu.adr == b.lsu.adr) && (a.lsu.wdt == b.lsu.wdt))) &&
+               (a.lsu.rdt.empty() || b.lsu.rdt.empty() || (a.lsu.adr == b.lsu.adr));
+    }
+
+}
@@ -15,10 +15,12 @@
 #include <array>
 #include <vector>
 #include <span>
-#include <map>
+#include <utility>
+#include <cstring>
 
 // HDLDB includes
 #include "AddressMap.hpp"
+#include "IoStore.hpp"
 
 namespace shadow {
 
@@ -28,9 +30,8 @@ namespace shadow {
         // core local memories (array of address map regions)
         std::array<std::byte, addressBlockSize(AMAP.mem)> m_buf;
 //        std::array<std::byte, 0x1'0000> m_mem;
-        std::span<std::byte> m_mem { m_buf };
         // core local memory mapped I/O registers (covers address space not covered by memories)
-        std::map<XLEN, XLEN> m_i_o;
+        IoStore<XLEN> m_i_o;
 
 //        // constructor/destructor
 //        MemoryMap () = default;
@@ -39,25 +40,78 @@ namespace shadow {
         // mapping from CPU address space to shadow memory offset
         XLEN offset (XLEN addr) const;
     public:
+        // address map (memory map XML)
+        static constexpr auto amap { AMAP };
+
+        // check whether address is inside a memory/IO address map block
+        bool isMem (XLEN addr) const;
+        bool isI_O (XLEN addr) const;
+        // check whether address is inside the address map
+        bool contains (XLEN addr) const;
+        // memory block [base, base+size) containing the address (empty if none)
+        std::pair<XLEN, XLEN> block (XLEN addr) const;
+
+        // memory contents (concatenated memory blocks, snapshot load)
+        std::span<std::byte> memory () { return m_buf; };
+
         // memory load/store from CPU
         template <typename TYPE>
         TYPE load  (const XLEN addr);
         template <typename TYPE>
         void store (const XLEN addr, TYPE data);
 
+        // memory/IO replay/revert of retired LSU access
+        // (I/O reads are logged, so reverse execution sees the value read by the DUT)
+        template <typename LSU>
+        void replay (const std::size_t cnt, LSU& lsu);
+        template <typename LSU>
+        void revert (const std::size_t cnt, const LSU& lsu);
+
         // memory read/write from debugger
-        std::span<std::byte> read  (const XLEN addr, const std::size_t size) const;
+        std::span<std::byte> read  (const XLEN addr, const std::size_t size);
         void                 write (const XLEN addr, const std::span<std::byte> data);
     };
 
     // mapping from CPU address space to shadow memory offset
     template <typename XLEN, AddressMap AMAP>
     XLEN MemoryMap<XLEN, AMAP>::offset (XLEN addr) const {
+        // memory blocks are concatenated in the shadow buffer
+        XLEN base = 0;
         for (int unsigned blk=0; blk<AMAP.mem.size(); blk++) {
             if ((addr >= AMAP.mem[blk].base) &&
                 (addr <  AMAP.mem[blk].base + AMAP.mem[blk].size)) {
-                return addr-AMAP.mem[blk].base;
+                return base + addr-AMAP.mem[blk].base;
             };
+            base += AMAP.mem[blk].size;
+        };
+        return { };
+    }
+
+    template <typename XLEN, AddressMap AMAP>
+    bool MemoryMap<XLEN, AMAP>::isMem (XLEN addr) const {
+        for (const auto& block : AMAP.mem) {
+            if ((addr >= block.base) && (addr < block.base + block.size))  return true;
+        };
+        return false;
+    }
+
+    template <typename XLEN, AddressMap AMAP>
+    bool MemoryMap<XLEN, AMAP>::isI_O (XLEN addr) const {
+        for (const auto& block : AMAP.i_o) {
+            if ((addr >= block.base) && (addr < block.base + block.size))  return true;
+        };
+        return false;
+    }
+
+    template <typename XLEN, AddressMap AMAP>
+    bool MemoryMap<XLEN, AMAP>::contains (XLEN addr) const {
+        return isMem(addr) || isI_O(addr);
+    }
+
+    template <typename XLEN, AddressMap AMAP>
+    std::pair<XLEN, XLEN> MemoryMap<XLEN, AMAP>::block (XLEN addr) const {
+        for (const auto& block : AMAP.mem) {
+            if ((addr >= block.base) && (addr < block.base + block.size))  return {block.base, block.base + block.size};
         };
         return { };
     }
@@ -66,13 +120,49 @@ namespace shadow {
     template <typename XLEN, AddressMap AMAP>
     template <typename TYPE>
     TYPE MemoryMap<XLEN, AMAP>::load (const XLEN addr) {
-        return static_cast<TYPE>(m_mem.data() + offset(addr));
+        TYPE data;
+        std::memcpy(&data, m_buf.data() + offset(addr), sizeof(TYPE));
+        return data;
     }
 
     template <typename XLEN, AddressMap AMAP>
     template <typename TYPE>
     void MemoryMap<XLEN, AMAP>::store (const XLEN addr, TYPE data) {
-        static_cast<TYPE>(m_mem.data() + offset(addr)) = data;
+        std::memcpy(m_buf.data() + offset(addr), &data, sizeof(TYPE));
+    }
+
+    // replay retired LSU access
+    template <typename XLEN, AddressMap AMAP>
+    template <typename LSU>
+    void MemoryMap<XLEN, AMAP>::replay (const std::size_t cnt, LSU& lsu) {
+        if (isMem(lsu.adr)) {
+            // memory store (loads do not change memory)
+            if (lsu.wdt.size() > 0) {
+                // remember the current memory contents to be able to revert later
+                auto old { memory().subspan(offset(lsu.adr), lsu.wdt.size()) };
+                lsu.old.assign(old.begin(), old.end());
+                std::copy_n(lsu.wdt.data(), lsu.wdt.size(), m_buf.data() + offset(lsu.adr));
+            }
+        } else {
+            // I/O access, log the value read/written by the DUT
+            if      (lsu.wdt.size() > 0)  m_i_o.replay(cnt, lsu.adr, lsu.wdt);
+            else if (lsu.rdt.size() > 0)  m_i_o.replay(cnt, lsu.adr, lsu.rdt);
+        }
+    }
+
+    // revert retired LSU access
+    template <typename XLEN, AddressMap AMAP>
+    template <typename LSU>
+    void MemoryMap<XLEN, AMAP>::revert (const std::size_t cnt, const LSU& lsu) {
+        if (isMem(lsu.adr)) {
+            // restore memory contents before the store
+            if (lsu.wdt.size() > 0) {
+                std::copy_n(lsu.old.data(), lsu.old.size(), m_buf.data() + offset(lsu.adr));
+            }
+        } else {
+            // I/O access, return to the previously logged value
+            if (lsu.wdt.size() > 0 || lsu.rdt.size() > 0)  m_i_o.revert(cnt, lsu.adr);
+        }
     }
 
     // read from shadow memory map
@@ -80,14 +170,11 @@ namespace shadow {
     std::span<std::byte> MemoryMap<XLEN, AMAP>::read (
         const XLEN        addr,
         const std::size_t size
-    ) const {
-        // reading from an address map block
-        return m_mem.subspan(offset(addr), size);
-        // reading from an unmapped IO region (reads have higher priority)
-        // TODO: handle access to nonexistent entries with a warning?
-        // TODO: handle access with a size mismatch
-//        return { static_cast<std::byte *>(m_i_o[addr]), sizeof(XLEN) };
-        return { };
+    ) {
+        // reading from an address map block (clipped at the block end)
+        if (isMem(addr))  return memory().subspan(offset(addr), std::min<std::size_t>(size, block(addr).second - addr));
+        // reading from an unmapped IO region (value at the current shadow position)
+        return m_i_o.read(addr, size);
     }
 
     // write to shadow memory map
@@ -96,11 +183,13 @@ namespace shadow {
         const XLEN                 addr,
               std::span<std::byte> data
     ) {
-        // writing to an address map block
-        std::copy_n(data.data(), data.size(), m_mem.data() + offset(addr));
-        // writing to an unmapped IO region (reads have higher priority)
-        // TODO
-//        m_i_o[addr] = data;
+        // writing to an address map block (clipped at the block end)
+        if (isMem(addr)) {
+            std::copy_n(data.data(), std::min<std::size_t>(data.size(), block(addr).second - addr), m_buf.data() + offset(addr));
+        } else {
+            // writing to an unmapped IO region
+            m_i_o.write(addr, data);
+        }
     }
 
 }
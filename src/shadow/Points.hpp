@@ -12,11 +12,17 @@
 #include <signal.h>
 
 // C++ includes
-#include <map>
+#include <array>
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
 
 // HDLDB includes
 #include "rsp.hpp"
 #include "Instruction.hpp"
+#include "AgentExpr.hpp"
 
 namespace shadow {
 
@@ -25,40 +31,145 @@ namespace shadow {
         rsp::PointKind kind;
     };
 
+    // The common case (no point on the accessed page) is filtered
+    // with a single bit test in a page granular bitmap,
+    // only hits go to the breakpoint table or watchpoint intervals.
     template <typename XLEN, typename FLEN, typename VLEN>
     class Points {
-        std::map<XLEN, Point> m_break;
-        std::map<XLEN, Point> m_watch;
+        // page size and number of (folded) pages in the prefilter bitmap
+        static constexpr std::size_t PAGE_BITS   = 12;  // 4kB pages
+        static constexpr std::size_t FILTER_BITS = 12;  // 4k bitmap entries
+
+        // page prefilter (bit is set if any point is on the page)
+        struct Filter {
+            std::bitset<1 << FILTER_BITS>             bit;
+            std::array<std::uint16_t, 1 << FILTER_BITS> cnt { };
+
+            static std::size_t index (const XLEN addr) {
+                return (addr >> PAGE_BITS) & ((1 << FILTER_BITS) - 1);
+            };
+            bool test (const XLEN addr) const { return bit.test(index(addr)); };
+            // reference count pages covered by address range [base, base+size)
+            void insert (const XLEN base, const XLEN size);
+            void remove (const XLEN base, const XLEN size);
+        };
+
+        // breakpoint with (optional) server side conditions and commands
+        struct Break {
+            Point                  point;
+            std::vector<AgentExpr> cond;
+            std::vector<AgentExpr> cmds;
+        };
+
+        // watchpoint address interval
+        struct Watch {
+            XLEN  base;
+            XLEN  size;
+            Point point;
+        };
+
+        // software/hardware breakpoints (indexed by point type),
+        // GDB can insert both types at the same address
+        Filter                                         m_break_filter;
+        std::array<std::unordered_map<XLEN, Break>, 2> m_break;
+        // watchpoints (sorted by base address)
+        Filter                         m_watch_filter;
+        std::vector<Watch>             m_watch;
+        XLEN                           m_watch_max = 0;  // maximum watchpoint size
+        // incremented on every change of the point set
+        std::uint64_t                  m_generation = 0;
+
+        std::size_t breakCount () const { return m_break[0].size() + m_break[1].size(); };
+        // evaluate conditions and commands of a matched breakpoint (returns true if execution should stop)
+        template <typename CTX>
+        static bool hit (const Break& brk, CTX& ctx);
 
     public:
         // signal
         int m_signal = SIGTRAP;
         // reason (point type/kind)
-        Point m_reason;
+        Point m_reason { rsp::PointType::none, 0 };
+        // reason data address (watchpoints)
+        XLEN  m_reason_addr = 0;
 
-        int insert (const rsp::PointType, const XLEN , const rsp::PointKind);
+        // insert/remove are idempotent (GDB reinserts all points around each resume)
+        int insert (const rsp::PointType, const XLEN , const rsp::PointKind, std::vector<AgentExpr> cond = {}, std::vector<AgentExpr> cmds = {});
         int remove (const rsp::PointType, const XLEN , const rsp::PointKind);
-        bool match (Retired<XLEN, FLEN, VLEN> ret);
+
+        // point set generation (derived data is rebuilt when it changes)
+        std::uint64_t generation () const { return m_generation; };
+
+        // breakpoint addresses and watchpoint intervals (base, size) for trace scans
+        std::vector<XLEN>                  breaks  () const;
+        std::vector<std::pair<XLEN, XLEN>> watches () const;
+
+        // match breakpoint (instruction to be executed)
+        // conditions are evaluated against the shadow state in the given context
+        template <typename CTX>
+        bool matchBreak (const Retired<XLEN, FLEN, VLEN>& ret, CTX& ctx);
+        // match watchpoint (LSU access of a retired instruction)
+        bool matchWatch (const Retired<XLEN, FLEN, VLEN>& ret);
+        // match breakpoint/watchpoint
+        template <typename CTX>
+        bool match (const Retired<XLEN, FLEN, VLEN>& ret, CTX& ctx);
     };
 
-        // RSP insert breakpoint/watchpoint into dictionary
+    template <typename XLEN, typename FLEN, typename VLEN>
+    void Points<XLEN, FLEN, VLEN>::Filter::insert (const XLEN base, const XLEN size) {
+        for (XLEN page = base >> PAGE_BITS; page <= (base + size - 1) >> PAGE_BITS; page++) {
+            const std::size_t idx = index(page << PAGE_BITS);
+            if (cnt[idx]++ == 0)  bit.set(idx);
+            // avoid looping over the whole bitmap for huge ranges
+            if (page - (base >> PAGE_BITS) >= (1 << FILTER_BITS) - 1)  break;
+        }
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    void Points<XLEN, FLEN, VLEN>::Filter::remove (const XLEN base, const XLEN size) {
+        for (XLEN page = base >> PAGE_BITS; page <= (base + size - 1) >> PAGE_BITS; page++) {
+            const std::size_t idx = index(page << PAGE_BITS);
+            if (--cnt[idx] == 0)  bit.reset(idx);
+            if (page - (base >> PAGE_BITS) >= (1 << FILTER_BITS) - 1)  break;
+        }
+    }
+
+    // RSP insert breakpoint/watchpoint into dictionary
     template <typename XLEN, typename FLEN, typename VLEN>
     int Points<XLEN, FLEN, VLEN>::insert (
-        const rsp::PointType type,
-        const XLEN           addr,
-        const rsp::PointKind kind
+        const rsp::PointType   type,
+        const XLEN             addr,
+        const rsp::PointKind   kind,
+        std::vector<AgentExpr> cond,
+        std::vector<AgentExpr> cmds
     ) {
         switch (type) {
             case rsp::PointType::swbreak:
             case rsp::PointType::hwbreak:
-                m_break.insert(addr) = {type, kind};
-                return m_break.size();
+                // reinserting a breakpoint replaces its conditions and commands
+                if (m_break[std::to_underlying(type)].insert_or_assign(addr, Break{Point{type, kind}, std::move(cond), std::move(cmds)}).second) {
+                    m_break_filter.insert(addr, 1);
+                    m_generation++;
+                }
+                return breakCount();
             case rsp::PointType::watch:
             case rsp::PointType::rwatch:
-            case rsp::PointType::awatch:
-                m_watch.insert(addr) = {type, kind};
+            case rsp::PointType::awatch: {
+                // watchpoint length is given by kind
+                const XLEN size = std::max<XLEN>(kind, 1);
+                auto it = std::lower_bound(m_watch.begin(), m_watch.end(), addr,
+                    [](const Watch& w, const XLEN a) { return w.base < a; });
+                // reinserting a watchpoint is a no-op
+                for (auto i = it; i != m_watch.end() && i->base == addr; i++) {
+                    if (i->point.type == type && i->point.kind == kind)  return m_watch.size();
+                }
+                m_watch.insert(it, Watch{addr, size, Point{type, kind}});
+                m_watch_filter.insert(addr, size);
+                m_watch_max = std::max(m_watch_max, size);
+                m_generation++;
                 return m_watch.size();
+            }
             default:
+                return -1;
         }
     }
 
@@ -72,24 +183,58 @@ namespace shadow {
         switch (type) {
             case rsp::PointType::swbreak:
             case rsp::PointType::hwbreak:
-                m_break.erase(addr);
-                return m_break.size();
+                if (m_break[std::to_underlying(type)].erase(addr) > 0) {
+                    m_break_filter.remove(addr, 1);
+                    m_generation++;
+                }
+                return breakCount();
             case rsp::PointType::watch:
             case rsp::PointType::rwatch:
-            case rsp::PointType::awatch:
-                m_watch.erase(addr);
+            case rsp::PointType::awatch: {
+                auto it = std::lower_bound(m_watch.begin(), m_watch.end(), addr,
+                    [](const Watch& w, const XLEN a) { return w.base < a; });
+                for (; it != m_watch.end() && it->base == addr; it++) {
+                    if (it->point.type == type && it->point.kind == kind) {
+                        m_watch_filter.remove(it->base, it->size);
+                        m_watch.erase(it);
+                        m_generation++;
+                        break;
+                    }
+                }
                 return m_watch.size();
+            }
             default:
+                return -1;
         }
     }
 
-    // match breakpoint/watchpoint
     template <typename XLEN, typename FLEN, typename VLEN>
-    bool Points<XLEN, FLEN, VLEN>::match (Retired<XLEN, FLEN, VLEN> ret) {
-        XLEN addr;
+    std::vector<XLEN> Points<XLEN, FLEN, VLEN>::breaks () const {
+        std::vector<XLEN> addrs;
+        addrs.reserve(breakCount());
+        for (const auto& map : m_break) {
+            for (const auto& [addr, brk] : map)  addrs.push_back(addr);
+        }
+        // an address with both breakpoint types is listed once
+        std::ranges::sort(addrs);
+        addrs.erase(std::ranges::unique(addrs).begin(), addrs.end());
+        return addrs;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    std::vector<std::pair<XLEN, XLEN>> Points<XLEN, FLEN, VLEN>::watches () const {
+        std::vector<std::pair<XLEN, XLEN>> ranges;
+        ranges.reserve(m_watch.size());
+        for (const auto& w : m_watch)  ranges.emplace_back(w.base, w.size);
+        return ranges;
+    }
+
+    // match breakpoint (on the instruction to be executed)
+    template <typename XLEN, typename FLEN, typename VLEN>
+    template <typename CTX>
+    bool Points<XLEN, FLEN, VLEN>::matchBreak (const Retired<XLEN, FLEN, VLEN>& ret, CTX& ctx) {
+        const XLEN addr = ret.ifu.adr;
 
-                                 addr = ret.ifu.adr;
-//        std::array<std::byte, 4> inst = ret.ifu.rdt;
         // match illegal instruction
         if (ret.ifu.ill) {
             m_signal = SIGILL;
@@ -113,36 +258,95 @@ namespace shadow {
 //            return true;
 //        }
 
-        // match hardware breakpoint
-        else if (m_break.contains(addr)) {
-            if (m_break[addr].type == rsp::PointType::hwbreak) {
-                // signal
-                m_signal = SIGTRAP;
-                // reason
-                m_reason = m_break[addr];
+        // page prefilter
+        if (!m_break_filter.test(addr))  return false;
+
+        // match software/hardware breakpoint (commands of both run, either can stop)
+        bool stop = false;
+        for (const auto& map : m_break) {
+            const auto it = map.find(addr);
+            if ((it == map.end()) || !hit(it->second, ctx))  continue;
+            // signal
+            m_signal = SIGTRAP;
+            // reason
+            if (!stop)  m_reason = it->second.point;
     //            $display("DEBUG: Triggered HW breakpoint at address %h.", addr);
-                return true;
+            stop = true;
+        }
+        return stop;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN>
+    template <typename CTX>
+    bool Points<XLEN, FLEN, VLEN>::hit (const Break& brk, CTX& ctx) {
+        // server side conditions (stop if any condition is true)
+        if (!brk.cond.empty()) {
+            bool met = false;
+            for (const auto& cond : brk.cond) {
+                try {
+                    met = cond.eval(ctx) != 0;
+                } catch (const std::runtime_error& e) {
+                    // stop on evaluation errors, so the user can see the problem
+                    met = true;
+                }
+                if (met)  break;
+            }
+            if (!met)  return false;
+        }
+        // target side commands ('dprintf') are executed instead of stopping
+        if (!brk.cmds.empty()) {
+            try {
+                for (const auto& cmd : brk.cmds)  cmd.eval(ctx);
+                return false;
+            } catch (const std::runtime_error& e) {
+                // stop on evaluation errors, so the user can see the problem
             }
         }
+        return true;
+    }
+
+    // match watchpoint (on the LSU access of the retired instruction)
+    template <typename XLEN, typename FLEN, typename VLEN>
+    bool Points<XLEN, FLEN, VLEN>::matchWatch (const Retired<XLEN, FLEN, VLEN>& ret) {
+        const XLEN addr = ret.lsu.adr;
+        const bool wena = ret.lsu.wdt.size() > 0;
+        const bool rena = ret.lsu.rdt.size() > 0;  // AMO accesses both read and write (store revert data is kept apart)
+        const XLEN size = std::max(ret.lsu.rdt.size(), ret.lsu.wdt.size());
+
+        // no access
+        if (size == 0)  return false;
 
-             addr = ret.lsu.adr;
-        bool rena = ret.lsu.rdt.size() > 0;
-        bool wena = ret.lsu.wdt.size() > 0;
+        // page prefilter (an access can cross a page boundary)
+        if (!m_watch_filter.test(addr) && !m_watch_filter.test(addr + size - 1))  return false;
 
-        // match hardware breakpoint
-        if (m_watch.contains(addr)) {
-            if (((m_watch[addr].ptype == rsp::PointType::watch ) && wena) ||
-                ((m_watch[addr].ptype == rsp::PointType::rwatch) && rena) ||
-                ((m_watch[addr].ptype == rsp::PointType::awatch) )) {
-                // TODO: check is transfer size matches
+        // search intervals overlapping the access [addr, addr+size)
+        auto it = std::lower_bound(m_watch.begin(), m_watch.end(), addr + size,
+            [](const Watch& w, const XLEN a) { return w.base < a; });
+        while (it != m_watch.begin()) {
+            --it;
+            // no interval further back can overlap
+            if (it->base + m_watch_max <= addr)  break;
+            if (it->base + it->size    <= addr)  continue;
+            if (((it->point.type == rsp::PointType::watch ) && wena) ||
+                ((it->point.type == rsp::PointType::rwatch) && rena) ||
+                ((it->point.type == rsp::PointType::awatch) )) {
                 // signal
                 m_signal = SIGTRAP;
-                // reason
-                m_reason = m_watch[addr];
+                // reason (first watched address within the access)
+                m_reason = it->point;
+                m_reason_addr = std::max(addr, it->base);
     //            $display("DEBUG: Triggered HW watchpoint at address %h.", addr);
                 return true;
             }
         }
+        return false;
+    }
+
+    // match breakpoint/watchpoint
+    template <typename XLEN, typename FLEN, typename VLEN>
+    template <typename CTX>
+    bool Points<XLEN, FLEN, VLEN>::match (const Retired<XLEN, FLEN, VLEN>& ret, CTX& ctx) {
+        return matchBreak(ret, ctx) || matchWatch(ret);
     }
 
 }
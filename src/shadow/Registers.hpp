@@ -10,12 +10,20 @@
 
 // C includes
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 // C++ includes
 #include <array>
 #include <vector>
 #include <span>
 #include <bitset>
+#include <utility>
+#include <algorithm>
+#include <string_view>
+
+// HDLDB includes
+#include "Xml.hpp"
 
 namespace shadow {
 
@@ -41,6 +49,23 @@ namespace shadow {
 //  template <IsaRiscV ISA> constexpr std::size_t lenCsr { ISA.CSR.count()     };  // CSR
     template <IsaRiscV ISA> constexpr std::size_t lenCsr { std::count(ISA.CSR.begin(), ISA.CSR.end(), true) };  // CSR
 
+    // mapping from CSR address to index in the list of target CSR (-1 if not present)
+    template <IsaRiscV ISA> constexpr std::array<int, 4096> idxCsr { [] {
+        std::array<int, 4096> idx { };
+        int cnt = 0;
+        for (std::size_t i=0; i<4096; i++) {
+            idx[i] = ISA.CSR[i] ? cnt++ : -1;
+        }
+        return idx;
+    }() };
+
+    // GDB register numbers (RISC-V)
+    constexpr unsigned int regnumGpr = 0;     // x0
+    constexpr unsigned int regnumPc  = 32;    // pc
+    constexpr unsigned int regnumFpr = 33;    // f0
+    constexpr unsigned int regnumCsr = 65;    // CSR 0x000
+    constexpr unsigned int regnumVec = 4162;  // v0
+
     // calculating the size of std::byte span for debugger g/G packets
     template <typename LEN, IsaRiscV ISA> constexpr std::size_t sizeGpr { lenGpr<ISA> * sizeof(LEN) };  // GPR
     template <typename LEN, IsaRiscV ISA> constexpr std::size_t sizePc  { lenPc <ISA> * sizeof(LEN) };  // PC
@@ -54,27 +79,204 @@ namespace shadow {
         sizeGpr<XLEN, ISA> + 
         sizePc <XLEN, ISA> + 
         sizeFpr<FLEN, ISA> + 
-        sizeVec<VLEN, ISA> + 
-        sizeCsr<VLEN, ISA>
+        sizeCsr<XLEN, ISA> +
+        sizeVec<VLEN, ISA>
+    };
+
+    // RISC-V ABI GPR names
+    constexpr std::array<std::string_view, 32> nameGpr {
+        "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+        "fp"  , "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+        "a6"  , "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+        "s8"  , "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+    };
+
+    // RISC-V ABI FPR names
+    constexpr std::array<std::string_view, 32> nameFpr {
+        "ft0", "ft1", "ft2" , "ft3" , "ft4", "ft5", "ft6" , "ft7" ,
+        "fs0", "fs1", "fa0" , "fa1" , "fa2", "fa3", "fa4" , "fa5" ,
+        "fa6", "fa7", "fs2" , "fs3" , "fs4", "fs5", "fs6" , "fs7" ,
+        "fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11"
+    };
+
+    // RISC-V CSR names (empty for CSR without a well known name)
+    constexpr std::string_view nameCsr (const unsigned int csr) {
+        switch (csr) {
+            // unprivileged
+            case 0x001: return "fflags";
+            case 0x002: return "frm";
+            case 0x003: return "fcsr";
+            case 0x008: return "vstart";
+            case 0x009: return "vxsat";
+            case 0x00a: return "vxrm";
+            case 0x00f: return "vcsr";
+            case 0x015: return "seed";
+            case 0xc00: return "cycle";
+            case 0xc01: return "time";
+            case 0xc02: return "instret";
+            case 0xc20: return "vl";
+            case 0xc21: return "vtype";
+            case 0xc22: return "vlenb";
+            case 0xc80: return "cycleh";
+            case 0xc81: return "timeh";
+            case 0xc82: return "instreth";
+            // supervisor
+            case 0x100: return "sstatus";
+            case 0x104: return "sie";
+            case 0x105: return "stvec";
+            case 0x106: return "scounteren";
+            case 0x10a: return "senvcfg";
+            case 0x140: return "sscratch";
+            case 0x141: return "sepc";
+            case 0x142: return "scause";
+            case 0x143: return "stval";
+            case 0x144: return "sip";
+            case 0x180: return "satp";
+            // machine
+            case 0xf11: return "mvendorid";
+            case 0xf12: return "marchid";
+            case 0xf13: return "mimpid";
+            case 0xf14: return "mhartid";
+            case 0xf15: return "mconfigptr";
+            case 0x300: return "mstatus";
+            case 0x301: return "misa";
+            case 0x302: return "medeleg";
+            case 0x303: return "mideleg";
+            case 0x304: return "mie";
+            case 0x305: return "mtvec";
+            case 0x306: return "mcounteren";
+            case 0x30a: return "menvcfg";
+            case 0x310: return "mstatush";
+            case 0x31a: return "menvcfgh";
+            case 0x320: return "mcountinhibit";
+            case 0x340: return "mscratch";
+            case 0x341: return "mepc";
+            case 0x342: return "mcause";
+            case 0x343: return "mtval";
+            case 0x344: return "mip";
+            case 0x34a: return "mtinst";
+            case 0x34b: return "mtval2";
+            case 0xb00: return "mcycle";
+            case 0xb02: return "minstret";
+            case 0xb80: return "mcycleh";
+            case 0xb82: return "minstreth";
+            // debug/trace
+            case 0x7a0: return "tselect";
+            case 0x7a1: return "tdata1";
+            case 0x7a2: return "tdata2";
+            case 0x7a3: return "tdata3";
+            case 0x7a4: return "tinfo";
+            case 0x7b0: return "dcsr";
+            case 0x7b1: return "dpc";
+            case 0x7b2: return "dscratch0";
+            case 0x7b3: return "dscratch1";
+            default   : return "";
+        }
+    }
+
+    // GDB target description, registers are listed in the g/G packet order
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/RISC_002dV-Features.html
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    struct TargetXmlRiscV {
+        template <typename OUT>
+        static constexpr void reg (OUT& xml, std::string_view name, std::size_t bitsize, std::string_view type, unsigned int regnum) {
+            xml.append("    <reg name=\"");
+            xml.append(name);
+            xml.append("\" bitsize=\"");
+            xml.append(bitsize);
+            xml.append("\" type=\"");
+            xml.append(type);
+            xml.append("\" regnum=\"");
+            xml.append(regnum);
+            xml.append("\"/>\n");
+        };
+
+        template <typename OUT>
+        static constexpr void write (OUT& xml) {
+            xml.append("<?xml version=\"1.0\"?>\n"
+                       "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+                       "<target version=\"1.0\">\n");
+            xml.append(sizeof(XLEN) == 8 ? "  <architecture>riscv:rv64</architecture>\n"
+                                         : "  <architecture>riscv:rv32</architecture>\n");
+            // GPR/PC
+            xml.append("  <feature name=\"org.gnu.gdb.riscv.cpu\">\n");
+            for (unsigned int i=0; i<lenGpr<ISA>; i++) {
+                const std::string_view type = (i == 1) ? "code_ptr" : ((i == 2) || (i == 3) || (i == 4) || (i == 8)) ? "data_ptr" : "int";
+                reg(xml, nameGpr[i], 8*sizeof(XLEN), type, regnumGpr + i);
+            }
+            reg(xml, "pc", 8*sizeof(XLEN), "code_ptr", regnumPc);
+            xml.append("  </feature>\n");
+            // FPR
+            if constexpr (lenFpr<ISA> > 0) {
+                xml.append("  <feature name=\"org.gnu.gdb.riscv.fpu\">\n");
+                for (unsigned int i=0; i<lenFpr<ISA>; i++) {
+                    reg(xml, nameFpr[i], 8*sizeof(FLEN), sizeof(FLEN) == 8 ? "ieee_double" : "ieee_single", regnumFpr + i);
+                }
+                xml.append("  </feature>\n");
+            }
+            // CSR
+            if constexpr (lenCsr<ISA> > 0) {
+                xml.append("  <feature name=\"org.gnu.gdb.riscv.csr\">\n");
+                for (unsigned int i=0; i<4096; i++) {
+                    if (!ISA.CSR[i])  continue;
+                    if (const auto name = nameCsr(i); !name.empty()) {
+                        reg(xml, name, 8*sizeof(XLEN), "int", regnumCsr + i);
+                    } else {
+                        // unnamed CSR 'csr0x123'
+                        XmlText<16> tmp { };
+                        tmp.append("csr");
+                        tmp.append(i, true);
+                        reg(xml, tmp.view(), 8*sizeof(XLEN), "int", regnumCsr + i);
+                    }
+                }
+                xml.append("  </feature>\n");
+            }
+            // VEC
+            if constexpr (lenVec<ISA> > 0) {
+                xml.append("  <feature name=\"org.gnu.gdb.riscv.vector\">\n"
+                           "    <vector id=\"bytes\" type=\"uint8\" count=\"");
+                xml.append(sizeof(VLEN));
+                xml.append("\"/>\n");
+                for (unsigned int i=0; i<lenVec<ISA>; i++) {
+                    XmlText<16> tmp { };
+                    tmp.append("v");
+                    tmp.append(i);
+                    reg(xml, tmp.view(), 8*sizeof(VLEN), "bytes", regnumVec + i);
+                }
+                xml.append("  </feature>\n");
+            }
+            xml.append("</target>\n");
+        };
     };
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     class RegistersRiscV {
-        // byte arrays used for debugger g/G packets
-        std::array<std::byte, sizeAll<XLEN, FLEN, VLEN, ISA>> m_all;
+        // byte offsets of register files in the g/G packet array
+        static constexpr std::size_t offGpr { 0                                   };
+        static constexpr std::size_t offPc  { offGpr + sizeGpr<XLEN, ISA> };
+        static constexpr std::size_t offFpr { offPc  + sizePc <XLEN, ISA> };
+        static constexpr std::size_t offCsr { offFpr + sizeFpr<FLEN, ISA> };
+        static constexpr std::size_t offVec { offCsr + sizeCsr<XLEN, ISA> };
+
+        // byte array used for debugger g/G packets
+        // (registers are accessed by offset, so copies of the object stay consistent)
+        std::array<std::byte, sizeAll<XLEN, FLEN, VLEN, ISA>> m_all { };
 
-        // register files
-        std::span<XLEN> m_gpr { reinterpret_cast<XLEN *>(m_all.data() + 0                                                                               ), lenGpr<ISA> };
-//                XLEN& m_pc  { reinterpret_cast<XLEN *>(m_all.data() + sizeGpr<XLEN, ISA>                                                              )              };
-                  XLEN  m_pc  { 0 };
-        std::span<FLEN> m_fpr { reinterpret_cast<FLEN *>(m_all.data() + sizeGpr<XLEN, ISA> + sizePc<XLEN, ISA>                                          ), lenFpr<ISA> };
-        std::span<VLEN> m_vec { reinterpret_cast<VLEN *>(m_all.data() + sizeGpr<XLEN, ISA> + sizePc<XLEN, ISA> + sizeFpr<FLEN, ISA>                     ), lenVec<ISA> };
-        std::span<XLEN> m_csr { reinterpret_cast<XLEN *>(m_all.data() + sizeGpr<XLEN, ISA> + sizePc<XLEN, ISA> + sizeFpr<FLEN, ISA> + sizeVec<VLEN, ISA>), lenCsr<ISA> };
+        // register access by byte offset (register files are not aligned to FLEN/VLEN)
+        template <typename TYPE>
+        TYPE get (const std::size_t off) const;
+        template <typename TYPE>
+        TYPE set (const std::size_t off, const TYPE val);
+
+        // register location by GDB register number (empty if not present)
+        std::span<std::byte> locate (const unsigned int regnum);
 
     public:
         // DUT access
         XLEN writeGpr (const unsigned int, const XLEN);
         XLEN readGpr  (const unsigned int) const;
+        XLEN writePc  (const XLEN);
+        XLEN readPc   () const;
         FLEN writeFpr (const unsigned int, const FLEN);
         FLEN readFpr  (const unsigned int) const;
         VLEN writeVec (const unsigned int, const VLEN);
@@ -82,57 +284,123 @@ namespace shadow {
         XLEN writeCsr (const unsigned int, const XLEN);
         XLEN readCsr  (const unsigned int) const;
 
+        // register value by GDB register number (agent expressions)
+        std::uint64_t readValue (const unsigned int regnum) const;
+
+        // ISA (extensions select optional trace columns)
+        static constexpr IsaRiscV isa { ISA };
+
+        // GDB target description (qXfer:features:read)
+        static constexpr std::string_view targetXml () { return xmlText<TargetXmlRiscV<XLEN, FLEN, VLEN, ISA>>.view(); };
+
         // RSP access
         void writeAll (std::span<std::byte>);
         std::span<std::byte> readAll ();
-        void writeOne (const unsigned int index, std::span<std::byte> data);
-        std::span<std::byte> readOne (const unsigned int index);
+        bool writeOne (const unsigned int regnum, std::span<std::byte> data);
+        std::span<std::byte> readOne (const unsigned int regnum);
     };
 
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    template <typename TYPE>
+    TYPE RegistersRiscV<XLEN, FLEN, VLEN, ISA>::get (const std::size_t off) const {
+        TYPE val;
+        std::memcpy(&val, m_all.data() + off, sizeof(TYPE));
+        return val;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    template <typename TYPE>
+    TYPE RegistersRiscV<XLEN, FLEN, VLEN, ISA>::set (const std::size_t off, const TYPE val) {
+        const TYPE old = get<TYPE>(off);
+        std::memcpy(m_all.data() + off, &val, sizeof(TYPE));
+        return old;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    std::span<std::byte> RegistersRiscV<XLEN, FLEN, VLEN, ISA>::locate (const unsigned int regnum) {
+        const std::span<std::byte> all { m_all };
+        if (regnum <  regnumGpr + lenGpr<ISA>)  return all.subspan(offGpr + (regnum - regnumGpr) * sizeof(XLEN), sizeof(XLEN));
+        if (regnum == regnumPc               )  return all.subspan(offPc                                         , sizeof(XLEN));
+        if (regnum >= regnumFpr && regnum < regnumFpr + lenFpr<ISA>) {
+            return all.subspan(offFpr + (regnum - regnumFpr) * sizeof(FLEN), sizeof(FLEN));
+        }
+        if (regnum >= regnumCsr && regnum < regnumCsr + 4096) {
+            const int idx = idxCsr<ISA>[regnum - regnumCsr];
+            if (idx >= 0)  return all.subspan(offCsr + idx * sizeof(XLEN), sizeof(XLEN));
+        }
+        if (regnum >= regnumVec && regnum < regnumVec + lenVec<ISA>) {
+            return all.subspan(offVec + (regnum - regnumVec) * sizeof(VLEN), sizeof(VLEN));
+        }
+        return { };
+    }
+
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     XLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeGpr (const unsigned int index, const XLEN val) {
-        return std::exchange(m_gpr[index], val);
+        return set<XLEN>(offGpr + index * sizeof(XLEN), val);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     XLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readGpr (const unsigned int index) const {
-        return m_gpr[index];
+        return get<XLEN>(offGpr + index * sizeof(XLEN));
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    XLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writePc (const XLEN val) {
+        return set<XLEN>(offPc, val);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    XLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readPc () const {
+        return get<XLEN>(offPc);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     FLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeFpr (const unsigned int index, const FLEN val) {
-        return std::exchange(m_fpr[index], val);
+        return set<FLEN>(offFpr + index * sizeof(FLEN), val);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     FLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readFpr (const unsigned int index) const {
-        return m_fpr[index];
+        return get<FLEN>(offFpr + index * sizeof(FLEN));
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     VLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeVec (const unsigned int index, const VLEN val) {
-        return std::exchange(m_vec[index], val);
+        return set<VLEN>(offVec + index * sizeof(VLEN), val);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     VLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readVec (const unsigned int index) const {
-        return m_vec[index];
+        return get<VLEN>(offVec + index * sizeof(VLEN));
     }
 
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     XLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeCsr (const unsigned int index, const XLEN val) {
-        return std::exchange(m_csr[index], val);
+        return set<XLEN>(offCsr + index * sizeof(XLEN), val);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     XLEN RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readCsr (const unsigned int index) const {
-        return m_csr[index];
+        return get<XLEN>(offCsr + index * sizeof(XLEN));
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
+    std::uint64_t RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readValue (const unsigned int regnum) const {
+        if (regnum <  regnumGpr + lenGpr<ISA>)  return readGpr(regnum - regnumGpr);
+        if (regnum == regnumPc               )  return readPc();
+        if (regnum >= regnumFpr && regnum < regnumFpr + lenFpr<ISA>)  return readFpr(regnum - regnumFpr);
+        if (regnum >= regnumCsr && regnum < regnumCsr + 4096) {
+            const int idx = idxCsr<ISA>[regnum - regnumCsr];
+            if (idx >= 0)  return readCsr(idx);
+        }
+        // TODO: vector registers are wider than the agent expression stack
+        return 0;
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
     void RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeAll (std::span<std::byte> data) {
-        std::copy(data.begin(), data.end(), m_all.data());
+        std::copy_n(data.begin(), std::min(data.size(), m_all.size()), m_all.data());
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
@@ -140,19 +408,18 @@ namespace shadow {
         return { m_all.data(), m_all.size() };
     }
 
+    // returns false if the register does not exist or the size does not match
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
-    void RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeOne (const unsigned int index, std::span<std::byte> data) {
+    bool RegistersRiscV<XLEN, FLEN, VLEN, ISA>::writeOne (const unsigned int regnum, std::span<std::byte> data) {
+        auto reg { locate(regnum) };
+        if (reg.empty() || (reg.size() != data.size()))  return false;
+        std::copy(data.begin(), data.end(), reg.begin());
+        return true;
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, IsaRiscV ISA>
-    std::span<std::byte> RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readOne (const unsigned int index) {
-        int idx = index;
-        if (idx < lenGpr<ISA>)  return { reinterpret_cast<std::byte *>(m_gpr[idx]), sizeof(XLEN) };  idx -= lenGpr<ISA>;
-        if (idx < 1          )  return { reinterpret_cast<std::byte *>(m_pc      ), sizeof(XLEN) };  idx -= 1          ;
-        if (idx < lenFpr<ISA>)  return { reinterpret_cast<std::byte *>(m_fpr[idx]), sizeof(FLEN) };  idx -= lenFpr<ISA>;
-        if (idx < lenVec<ISA>)  return { reinterpret_cast<std::byte *>(m_vec[idx]), sizeof(VLEN) };  idx -= lenVec<ISA>;
-        if (idx < lenCsr<ISA>)  return { reinterpret_cast<std::byte *>(m_csr[idx]), sizeof(XLEN) };  idx -= lenCsr<ISA>;
-        return { std::span<std::byte>{ } };
+    std::span<std::byte> RegistersRiscV<XLEN, FLEN, VLEN, ISA>::readOne (const unsigned int regnum) {
+        return locate(regnum);
     }
 
 }
@@ -14,31 +14,59 @@
 
 // C++ includes
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
 #include <span>
 #include <map>
+#include <unordered_map>
+#include <queue>
+#include <thread>
 #include <bitset>
 #include <bit>
 #include <utility>
 #include <fstream>
 #include <iterator>
+#include <limits>
 
 // HDLDB includes
 #include <rsp.hpp>
+#include <Stats.hpp>
+#include <Timeline.hpp>
 //#include "Instruction.hpp"
 #include "Core.hpp"
 #include "Points.hpp"
+#include "Tracepoints.hpp"
+#include "Btrace.hpp"
+#include "Xml.hpp"
+#include "FlatIndex.hpp"
+#include "Columns.hpp"
+#include "Blocks.hpp"
 
 namespace shadow {
 
+    // All harts are replayed in a single global order (per hart traces merged by time),
+    // this order defines the system trace position, and stopping is all-stop.
+    // Harts only interact through the system address map, so between accesses
+    // to it (synchronization points) harts can be replayed in parallel.
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     class System {
 
+        // minimum number of instructions between synchronization points
+        // for replaying harts on separate threads
+        static constexpr std::size_t PARALLEL_MIN = 1 << 14;
+
     public:
+        // global trace order entry
+        struct Step {
+            std::size_t hart;   // hart index
+            std::size_t index;  // position in the hart trace
+        };
+
         MMAP m_mmap;
 
-        CORE m_core;
+        // harts
+        std::vector<CORE> m_cores;
 
         POINT m_point;
 
@@ -48,95 +76,550 @@ namespace shadow {
         // trace file position
         std::size_t position;
 
-        // trace queue
-        std::vector<Retired<XLEN, FLEN, VLEN>> m_trace;
+        // trace queue for each hart
+        std::vector<std::vector<Retired<XLEN, FLEN, VLEN>>> m_trace;
+        // global trace order (merged by time)
+        std::vector<Step> m_order;
+        // searched fields of the trace in global order
+        Columns<XLEN, FLEN, VLEN, CORE::isa.EXT> m_columns;
+        // trace entries decoded on demand (trace loaded from a sidecar)
+        Blocks<System> m_blocks;
+        // global trace position
+        std::size_t m_cnt = 0;
+        // hart at the current position/stop (also the agent expression context)
+        std::size_t m_hart = 0;
+        // target side 'printf' output (breakpoint commands), not yet sent to GDB
+        std::string m_console;
+        // instructions replayed/reverted by single steps, added to the statistics once per run
+        std::uint64_t m_replayed = 0;
+        std::uint64_t m_reverted = 0;
+        // point sets of trace scans, rebuilt when the points (generation) or the widest access change
+        std::uint64_t                                              m_scan_generation = ~std::uint64_t{0};
+        std::uint8_t                                               m_scan_lsu_max    = 0;
+        std::vector<XLEN>                                          m_scan_breaks;
+        std::vector<std::pair<XLEN, XLEN>>                         m_scan_watches;
+        std::vector<typename decltype(m_columns)::Window>          m_scan_windows;
+
+        // PC index (trace positions of each instruction address)
+        std::unordered_map<XLEN, std::vector<std::size_t>> m_pc_index;
+        std::size_t                                        m_pc_indexed = 0;  // number of indexed trace entries
+        // store index (trace positions of stores by store address)
+        std::unordered_map<XLEN, std::vector<std::size_t>> m_wr_index;
+        std::size_t                                        m_wr_indexed = 0;
+        // flat indexes of the trace start (loaded from a sidecar file), the maps above extend them
+        FlatIndex<XLEN>                                    m_pc_flat;
+        FlatIndex<XLEN>                                    m_wr_flat;
+        std::vector<std::size_t>                           m_index_join;      // flat and map positions joined
 
-//    public:
-//        // constructor/destructor
-//        System () = default;
+        // tracepoints
+        Tracepoints<XLEN> m_tracepoints;
+
+        // branch trace for each hart
+        std::vector<Btrace<XLEN>> m_btrace;
+
+        // constructor/destructor
+        System (const std::size_t harts = 1);
 //        ~System () = default;
 
+        // number of harts, hart selected by RSP thread ID (0/-1 select the current hart)
+        std::size_t harts () const { return m_cores.size(); };
+        std::size_t hart  (const rsp::ThreadId threadId) const;
+        // hart which caused the last stop
+        CORE&       stopped () { return m_cores[m_hart]; };
+
+        // append retired instruction (retired in time order), or merge per hart traces by time
+        void push  (const std::size_t hart, Retired<XLEN, FLEN, VLEN> ret);
+        void merge ();
+
         // register read/write
         std::span<std::byte> reg_readAll (const rsp::ThreadId threadId);
         void                 reg_writeAll(const rsp::ThreadId threadId, std::span<std::byte> data);
         std::span<std::byte> reg_readOne (const rsp::ThreadId threadId, const unsigned int index);
-        void                 reg_writeOne(const rsp::ThreadId threadId, const unsigned int index, const std::span<std::byte> data);
+        bool                 reg_writeOne(const rsp::ThreadId threadId, const unsigned int index, const std::span<std::byte> data);
 
         // memory read/write
         std::span<std::byte> mem_read (const rsp::ThreadId threadId, const XLEN addr, const std::size_t size);
         void                 mem_write(const rsp::ThreadId threadId, const XLEN addr, std::span<std::byte> data);
+        // memory block containing the address (reads from it do not modify the shadow)
+        std::pair<XLEN, XLEN> mem_block (const rsp::ThreadId threadId, const XLEN addr) const;
+
+        // GDB target description and memory map (core local blocks first)
+        static constexpr std::string_view targetXml    () { return CORE::targetXml(); };
+        static constexpr std::string_view memoryMapXml () { return xmlText<MemoryMapXml<CORE::amap, MMAP::amap>>.view(); };
 
-        // point insert/remove/match
-        int pointInsert (const rsp::ThreadId threadId, const rsp::PointType, const XLEN , const rsp::PointKind);
+        // point insert/remove/match (breakpoints/watchpoints apply to all harts)
+        int pointInsert (const rsp::ThreadId threadId, const rsp::PointType, const XLEN , const rsp::PointKind, std::vector<AgentExpr> cond = {}, std::vector<AgentExpr> cmds = {});
         int pointRemove (const rsp::ThreadId threadId, const rsp::PointType, const XLEN , const rsp::PointKind);
         bool pointMatch (const rsp::ThreadId threadId, Retired<XLEN, FLEN, VLEN> ret);
 
+        // agent expression context (register/memory access to the shadow)
+        std::uint64_t agentReg (const unsigned int regnum);
+        std::uint64_t agentMem (const std::uint64_t addr, const std::size_t size);
+        void          agentPrint (std::string_view str) { m_console += str; };
+
+        // forward/backward step through the trace (returns true if execution should stop)
+        bool forward ();
+        bool backward ();
+        // add counters accumulated by single steps to the statistics (after a run)
+        void statsFlush ();
+        // skip trace positions which can not match a point (followed by forward/backward),
+        // forward skips stop before position 'to'
+        void skipForward  (const std::size_t to = std::numeric_limits<std::size_t>::max());
+        void skipBackward ();
+        // rebuild point sets of trace scans if they changed
+        void scanPoints ();
+
+        // trace position/length and instruction address at a position
+        std::size_t count () const { return m_cnt; };
+        std::size_t size  () const { return m_order.size(); };
+        Retired<XLEN, FLEN, VLEN>& retired (const std::size_t pos) { m_blocks.ensure(*this, pos); return m_trace[m_order[pos].hart][m_order[pos].index]; };
+        XLEN        address (const std::size_t pos) const { return m_columns.m_pc[pos]; };
+        // trace positions of the given instruction address, or of stores to the given address
+        std::span<const std::size_t> pcIndex (const XLEN addr);
+        std::span<const std::size_t> wrIndex (const XLEN addr);
+        // flat indexes of the current trace (PC, store address)
+        FlatIndex<XLEN> pcFlat () const;
+        FlatIndex<XLEN> wrFlat () const;
+        void            attachIndex (FlatIndex<XLEN> pc, FlatIndex<XLEN> wr);
+        // move to trace position without matching points
+        void seek (const std::size_t pos);
+
         // snapshot load
         void snapshotLoad (const std::string& filename);
+
+    private:
+        // replay/revert a single step (core local and system address map)
+        void replayStep (const std::size_t pos);
+        void revertStep (const std::size_t pos);
+        // step accessing the system address map (synchronization point)
+        bool shared (const std::size_t pos) const;
+        // replay/revert harts between synchronization points (on separate threads)
+        void replayHarts (const std::size_t end);
+        void revertHarts (const std::size_t end);
+        // index lookup (flat index followed by the map of newer positions)
+        std::span<const std::size_t> lookup (const FlatIndex<XLEN>& flat, const std::unordered_map<XLEN, std::vector<std::size_t>>& map, const XLEN addr);
     };
 
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::System (const std::size_t harts) :
+        m_cores(std::max<std::size_t>(harts, 1)),
+        m_trace(std::max<std::size_t>(harts, 1)),
+        m_btrace(std::max<std::size_t>(harts, 1))
+    { }
+
+    // RSP thread IDs are hart index + 1
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::size_t System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::hart (const rsp::ThreadId threadId) const {
+        if ((threadId.tid <= 0) || (static_cast<std::size_t>(threadId.tid) > m_cores.size()))  return m_hart;
+        return threadId.tid - 1;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::push (const std::size_t hart, Retired<XLEN, FLEN, VLEN> ret) {
+        // trace vectors can not grow while blocks are decoded into them
+        m_blocks.finish(*this);
+        if (m_trace[hart].size() == m_trace[hart].capacity())  rsp::stats().m_allocations.add();
+        m_order.push_back({hart, m_trace[hart].size()});
+        m_columns.push(ret);
+        m_trace[hart].push_back(std::move(ret));
+    }
+
+    // k-way merge of per hart traces by retirement time (ties are ordered by hart index)
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::merge () {
+        m_blocks.finish(*this);
+        using Head = std::pair<std::int64_t, std::size_t>;  // time, hart
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        std::vector<std::size_t> next (m_trace.size(), 0);
+        std::size_t total = 0;
+        for (std::size_t h=0; h<m_trace.size(); h++) {
+            total += m_trace[h].size();
+            if (!m_trace[h].empty())  heads.push({m_trace[h][0].time, h});
+        }
+        m_order.clear();
+        m_order.reserve(total);
+        while (!heads.empty()) {
+            const auto [t, h] = heads.top();
+            heads.pop();
+            m_order.push_back({h, next[h]++});
+            if (next[h] < m_trace[h].size())  heads.push({m_trace[h][next[h]].time, h});
+        }
+        m_columns.clear();
+        for (std::size_t pos=0; pos<m_order.size(); pos++)  m_columns.push(retired(pos));
+        // indexes refer to global positions
+        m_pc_index.clear();
+        m_pc_indexed = 0;
+        m_wr_index.clear();
+        m_wr_indexed = 0;
+        m_pc_flat = { };
+        m_wr_flat = { };
+    }
+
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     std::span<std::byte> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::reg_readAll (const rsp::ThreadId threadId) {
-        return m_core.readAll();
+        return m_cores[hart(threadId)].readAll();
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::reg_writeAll (const rsp::ThreadId threadId, const std::span<std::byte> data) {
-        m_core.writeAll(data);
+        m_cores[hart(threadId)].writeAll(data);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     std::span<std::byte> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::reg_readOne (const rsp::ThreadId threadId, const unsigned int index) {
-        return m_core.readOne(index);
+        return m_cores[hart(threadId)].readOne(index);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
-    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::reg_writeOne (const rsp::ThreadId threadId, const unsigned int index, std::span<std::byte> data) {
-        m_core.writeOne(index, data);
+    bool System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::reg_writeOne (const rsp::ThreadId threadId, const unsigned int index, std::span<std::byte> data) {
+        return m_cores[hart(threadId)].writeOne(index, data);
     }
 
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     std::span<std::byte> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::mem_read (const rsp::ThreadId threadId, const XLEN addr, const std::size_t size) {
-        return m_core.read(addr, size);
+        // core local address map has priority over the system address map
+        auto& core = m_cores[hart(threadId)];
+        if (core.contains(addr))  return core.read(addr, size);
+        else                      return m_mmap.read(addr, size);
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::mem_write (const rsp::ThreadId threadId, const XLEN addr, std::span<std::byte> data) {
-        m_core.write(addr, data);
+        auto& core = m_cores[hart(threadId)];
+        if (core.contains(addr))  core.write(addr, data);
+        else                      m_mmap.write(addr, data);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::pair<XLEN, XLEN> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::mem_block (const rsp::ThreadId threadId, const XLEN addr) const {
+        const auto& core = m_cores[hart(threadId)];
+        if (core.contains(addr))  return core.block(addr);
+        else                      return m_mmap.block(addr);
     }
 
 
     // point insert/remove/match
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
-    int System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pointInsert (const rsp::ThreadId threadId, const rsp::PointType, const XLEN , const rsp::PointKind) {
-        return 0;
+    int System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pointInsert (const rsp::ThreadId threadId, const rsp::PointType type, const XLEN addr, const rsp::PointKind kind, std::vector<AgentExpr> cond, std::vector<AgentExpr> cmds) {
+        int status = 0;
+        for (auto& core : m_cores) {
+            status = core.insert(type, addr, kind, cond, cmds);
+        }
+        return status;
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
-    int System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pointRemove (const rsp::ThreadId threadId, const rsp::PointType, const XLEN , const rsp::PointKind) {
-        return 0;
+    int System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pointRemove (const rsp::ThreadId threadId, const rsp::PointType type, const XLEN addr, const rsp::PointKind kind) {
+        int status = 0;
+        for (auto& core : m_cores) {
+            status = core.remove(type, addr, kind);
+        }
+        return status;
     }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     bool System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pointMatch (const rsp::ThreadId threadId, Retired<XLEN, FLEN, VLEN> ret) {
+        m_hart = hart(threadId);
+        return m_cores[m_hart].match(ret, *this);
+    }
+
+    // agent expression register access (GDB register number)
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::uint64_t System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::agentReg (const unsigned int regnum) {
+        return m_cores[m_hart].readValue(regnum);
+    }
+
+    // agent expression memory access (little endian)
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::uint64_t System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::agentMem (const std::uint64_t addr, const std::size_t size) {
+        auto data { mem_read({1, 0}, static_cast<XLEN>(addr), size) };
+        std::uint64_t val = 0;
+        for (std::size_t i=0; i<std::min(size, data.size()); i++) {
+            val |= static_cast<std::uint64_t>(data[i]) << (8*i);
+        }
+        return val;
+    }
+
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::replayStep (const std::size_t pos) {
+        m_blocks.ensure(*this, pos);
+        const auto [h, i] = m_order[pos];
+        auto& ret = m_trace[h][i];
+        m_cores[h].replay(ret);
+        // the global position is the I/O log counter for the system address map
+        if (!m_cores[h].contains(ret.lsu.adr))  m_mmap.replay(pos, ret.lsu);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::revertStep (const std::size_t pos) {
+        m_blocks.ensure(*this, pos);
+        const auto [h, i] = m_order[pos];
+        auto& ret = m_trace[h][i];
+        m_cores[h].revert(ret);
+        if (!m_cores[h].contains(ret.lsu.adr))  m_mmap.revert(pos, ret.lsu);
+    }
+
+    // stores to system memory and system I/O accesses change shared state
+    // (loads from system memory do not, so they are not synchronization points)
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    bool System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::shared (const std::size_t pos) const {
+        const std::size_t h   = m_order[pos].hart;
+        const XLEN        adr = m_columns.m_lsu_adr[pos];
+        if (m_columns.lsuSize(pos) == 0)  return false;
+        if (m_cores[h].contains(adr))     return false;
+        return m_columns.lsuStore(pos) || !m_mmap.isMem(adr);
+    }
+
+
+    // replay the next retired instruction
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    bool System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::forward () {
+        for (auto& core : m_cores) {
+            core.m_signal = SIGTRAP;
+            core.m_reason = {rsp::PointType::none, 0};
+        }
+        // reached the end of the trace
+        if (m_cnt >= m_order.size()) {
+            stopped().m_reason = {rsp::PointType::replaylog, 0};
+            return true;
+        }
+        const std::size_t h = m_order[m_cnt].hart;
+        replayStep(m_cnt++);
+        m_blocks.cursor(*this, m_cnt, false);
+        m_replayed++;
+        m_hart = h;
+        // watchpoints match the access of the replayed instruction
+        if (m_cores[h].matchWatch(retired(m_cnt-1)))  return true;
+        // breakpoints match the instruction to be executed next (by its hart)
+        if (m_cnt < m_order.size()) {
+            m_hart = m_order[m_cnt].hart;
+            if (m_cores[m_hart].matchBreak(retired(m_cnt), *this))  return true;
+            m_hart = h;
+        }
         return false;
     }
 
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::statsFlush () {
+        rsp::stats().m_replayed.add(std::exchange(m_replayed, 0));
+        rsp::stats().m_reverted.add(std::exchange(m_reverted, 0));
+    }
+
+    // revert the previous retired instruction
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    bool System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::backward () {
+        for (auto& core : m_cores) {
+            core.m_signal = SIGTRAP;
+            core.m_reason = {rsp::PointType::none, 0};
+        }
+        // reached the beginning of the trace
+        if (m_cnt == 0) {
+            stopped().m_reason = {rsp::PointType::replaylog, 0};
+            return true;
+        }
+        revertStep(--m_cnt);
+        m_blocks.cursor(*this, m_cnt, true);
+        m_reverted++;
+        m_hart = m_order[m_cnt].hart;
+        // both breakpoints and watchpoints match the reverted instruction
+        return m_cores[m_hart].match(retired(m_cnt), *this);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::span<const std::size_t> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::lookup (
+        const FlatIndex<XLEN>&                                    flat,
+        const std::unordered_map<XLEN, std::vector<std::size_t>>& map,
+        const XLEN                                                addr
+    ) {
+        const auto head { flat.find(addr) };
+        const auto it   { map.find(addr) };
+        if (it == map.end())  return head;
+        if (head.empty())     return it->second;
+        m_index_join.assign(head.begin(), head.end());
+        m_index_join.insert(m_index_join.end(), it->second.begin(), it->second.end());
+        return m_index_join;
+    }
+
+    // Points are the same for all harts. Forward from position 'p' matches
+    // watchpoints on 'p' and breakpoints on 'p+1', so the replay can skip
+    // to the position before the first candidate without matching.
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::skipForward (const std::size_t to) {
+        scanPoints();
+        const std::size_t last = std::min(to, m_order.size());
+        if (last <= m_cnt + 1)  return;
+        const auto pos = m_columns.find(m_cnt, last, true, m_scan_breaks, m_scan_watches, m_scan_windows);
+        const std::size_t end = pos.value_or(last);
+        if (end > m_cnt + 1)  seek(end - 1);
+    }
+
+    // backward from position 'p' matches both on 'p-1'
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::skipBackward () {
+        scanPoints();
+        const auto pos = m_columns.find(0, m_cnt, false, m_scan_breaks, m_scan_watches, m_scan_windows);
+        const std::size_t end = pos ? *pos + 1 : 0;
+        if (end < m_cnt)  seek(end);
+    }
+
+    // points are only changed by GDB between runs, a run reuses the sets
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::scanPoints () {
+        const auto& points  = m_cores[0];
+        const bool  changed = points.generation() != m_scan_generation;
+        if (changed) {
+            m_scan_generation = points.generation();
+            m_scan_breaks     = points.breaks();
+            m_scan_watches    = points.watches();
+        }
+        // windows also depend on the widest access, which grows with a live trace
+        if (changed || (m_columns.m_lsu_max != m_scan_lsu_max)) {
+            m_scan_lsu_max = m_columns.m_lsu_max;
+            m_scan_windows = m_columns.windows(m_scan_watches);
+        }
+    }
+
+    // the index is extended incrementally, if the trace grew since the last lookup
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::span<const std::size_t> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pcIndex (const XLEN addr) {
+        rsp::TimelineScope scope { "pc index" };
+        for (m_pc_indexed = std::max(m_pc_indexed, m_pc_flat.count()); m_pc_indexed < m_order.size(); m_pc_indexed++) {
+            m_pc_index[address(m_pc_indexed)].push_back(m_pc_indexed);
+        }
+        const auto positions { lookup(m_pc_flat, m_pc_index, addr) };
+        if (positions.empty())  rsp::stats().m_pc_misses.add();
+        else                    rsp::stats().m_pc_hits.add();
+        return positions;
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    std::span<const std::size_t> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::wrIndex (const XLEN addr) {
+        for (m_wr_indexed = std::max(m_wr_indexed, m_wr_flat.count()); m_wr_indexed < m_order.size(); m_wr_indexed++) {
+            if (m_columns.lsuStore(m_wr_indexed))  m_wr_index[m_columns.m_lsu_adr[m_wr_indexed]].push_back(m_wr_indexed);
+        }
+        return lookup(m_wr_flat, m_wr_index, addr);
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    FlatIndex<XLEN> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::pcFlat () const {
+        return FlatIndex<XLEN>::build(m_order.size(),
+            [this](const std::size_t pos) { return address(pos); },
+            [](const std::size_t) { return true; }
+        );
+    }
+
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    FlatIndex<XLEN> System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::wrFlat () const {
+        return FlatIndex<XLEN>::build(m_order.size(),
+            [this](const std::size_t pos) { return m_columns.m_lsu_adr[pos]; },
+            [this](const std::size_t pos) { return m_columns.lsuStore(pos); }
+        );
+    }
+
+    // positions covered by the flat indexes are no longer kept in the maps
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::attachIndex (FlatIndex<XLEN> pc, FlatIndex<XLEN> wr) {
+        m_pc_flat = std::move(pc);
+        m_wr_flat = std::move(wr);
+        m_pc_index.clear();
+        m_pc_indexed = 0;
+        m_wr_index.clear();
+        m_wr_indexed = 0;
+    }
+
+    // replay harts up to global position 'end' (there are no synchronization points in between)
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::replayHarts (const std::size_t end) {
+        if ((m_cores.size() == 1) || (end - m_cnt < PARALLEL_MIN)) {
+            while (m_cnt < end)  replayStep(m_cnt++);
+            return;
+        }
+        m_blocks.ensure(*this, m_cnt, end);
+        // each hart replays its own trace up to its position at 'end'
+        std::vector<std::size_t> stop (m_cores.size());
+        for (std::size_t h=0; h<m_cores.size(); h++)  stop[h] = m_cores[h].count();
+        for (std::size_t pos=m_cnt; pos<end; pos++)     stop[m_order[pos].hart]++;
+        {
+            std::vector<std::jthread> threads;
+            for (std::size_t h=0; h<m_cores.size(); h++) {
+                if (stop[h] == m_cores[h].count())  continue;
+                threads.emplace_back([this, h, &stop] {
+                    rsp::TimelineScope scope { "replay hart" };
+                    auto& core = m_cores[h];
+                    while (core.count() < stop[h])  core.replay(m_trace[h][core.count()]);
+                });
+            }
+        }
+        m_cnt = end;
+    }
+
+    // revert harts down to global position 'end' (there are no synchronization points in between)
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::revertHarts (const std::size_t end) {
+        if ((m_cores.size() == 1) || (m_cnt - end < PARALLEL_MIN)) {
+            while (m_cnt > end)  revertStep(--m_cnt);
+            return;
+        }
+        m_blocks.ensure(*this, end, m_cnt);
+        std::vector<std::size_t> stop (m_cores.size());
+        for (std::size_t h=0; h<m_cores.size(); h++)  stop[h] = m_cores[h].count();
+        for (std::size_t pos=end; pos<m_cnt; pos++)     stop[m_order[pos].hart]--;
+        {
+            std::vector<std::jthread> threads;
+            for (std::size_t h=0; h<m_cores.size(); h++) {
+                if (stop[h] == m_cores[h].count())  continue;
+                threads.emplace_back([this, h, &stop] {
+                    rsp::TimelineScope scope { "revert hart" };
+                    auto& core = m_cores[h];
+                    while (core.count() > stop[h])  core.revert(m_trace[h][core.count()-1]);
+                });
+            }
+        }
+        m_cnt = end;
+    }
+
+    // synchronization points are replayed in global order, harts in parallel between them
+    template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
+    void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::seek (const std::size_t pos) {
+        rsp::TimelineScope scope { "seek" };
+        const std::size_t end = std::min(pos, m_order.size());
+        m_blocks.cursor(*this, end, end < m_cnt);
+        rsp::stats().m_seeks.add();
+        if (end > m_cnt)  rsp::stats().m_replayed.add(end - m_cnt);
+        else              rsp::stats().m_reverted.add(m_cnt - end);
+        while (m_cnt < end) {
+            std::size_t sync = m_cnt;
+            while (sync < end && !shared(sync))  sync++;
+            replayHarts(sync);
+            if (m_cnt < end)  replayStep(m_cnt++);
+        }
+        while (m_cnt > end) {
+            std::size_t sync = m_cnt;
+            while (sync > end && !shared(sync-1))  sync--;
+            revertHarts(sync);
+            if (m_cnt > end)  revertStep(--m_cnt);
+        }
+        if (m_cnt < m_order.size())  m_hart = m_order[m_cnt].hart;
+    }
 
     template <typename XLEN, typename FLEN, typename VLEN, typename CORE, typename MMAP, typename POINT>
     void System<XLEN, FLEN, VLEN, CORE, MMAP, POINT>::snapshotLoad (const std::string& filename) {
         // open input snapshot file in binary mode
         std::ifstream snapshot { filename, std::ios::binary };
-        std::istreambuf_iterator<char> iter { snapshot };
         // copy time
-        std::copy_n(iter, sizeof(time), reinterpret_cast<char *>(&time));
+        snapshot.read(reinterpret_cast<char *>(&time), sizeof(time));
         // copy trace file position
-        std::copy_n(iter, sizeof(position), reinterpret_cast<char *>(&position));
-        // copy registers
-        std::copy_n(iter, m_core.m_all.size(), m_core.m_all.data());
-        // copy core memory
-        std::copy_n(iter, m_core.m_buf.size(), m_core.m_buf.data());
+        snapshot.read(reinterpret_cast<char *>(&position), sizeof(position));
+        for (auto& core : m_cores) {
+            // copy registers
+            auto regs { core.readAll() };
+            snapshot.read(reinterpret_cast<char *>(regs.data()), regs.size());
+            // copy core memory
+            auto mem { core.memory() };
+            snapshot.read(reinterpret_cast<char *>(mem.data()), mem.size());
+        }
         // copy system memory
         // TODO
     }
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB tracepoints (evaluated over the recorded trace)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+
+// C++ includes
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+// HDLDB includes
+#include "AgentExpr.hpp"
+#include <Timeline.hpp>
+
+namespace shadow {
+
+    // tracepoint definition (QTDP)
+    template <typename XLEN>
+    struct Tracepoint {
+        unsigned int             number;
+        XLEN                     addr;
+        bool                     enabled;
+        std::size_t              step;     // while-stepping count
+        std::size_t              pass;     // pass count (0 means unlimited)
+        std::vector<AgentExpr>   cond;     // condition
+        std::vector<std::string> actions;  // actions are not needed to collect frames
+        std::size_t              hits = 0;
+    };
+
+    // trace frame (position in the retired instruction trace)
+    template <typename XLEN>
+    struct TraceFrame {
+        std::size_t  position;
+        unsigned int number;   // tracepoint number
+        XLEN         addr;     // instruction address
+    };
+
+    // Since the entire execution is already recorded, a trace run is
+    // a single bulk pass over the PC index, frames only remember
+    // the trace position and are served from the shadow state.
+    template <typename XLEN>
+    class Tracepoints {
+    public:
+        // tracepoints indexed by number/location
+        std::map<std::pair<unsigned int, XLEN>, Tracepoint<XLEN>> m_points;
+        // collected frames (ordered by trace position)
+        std::vector<TraceFrame<XLEN>> m_frames;
+
+        // trace run status
+        bool         m_started = false;
+        bool         m_running = false;
+        unsigned int m_stop_pass = 0;  // tracepoint number which reached its pass count
+
+        // selected frame (-1 when viewing the live shadow)
+        int          m_frame = -1;
+        std::size_t  m_cursor = 0;  // shadow position before the first frame was selected
+
+        // delete tracepoints and frames
+        void clear ();
+
+        // collect frames in a single pass over the trace
+        // SYS provides: pcIndex(addr), address(position), seek(position), count(), size(),
+        // and the agent expression context
+        template <typename SYS>
+        void run (SYS& sys);
+
+        // find frame (after the selected frame) matching a predicate
+        template <typename PRED>
+        int find (PRED pred) const;
+    };
+
+    template <typename XLEN>
+    void Tracepoints<XLEN>::clear () {
+        m_points.clear();
+        m_frames.clear();
+        m_started = false;
+        m_running = false;
+        m_stop_pass = 0;
+        m_frame = -1;
+    }
+
+    template <typename XLEN>
+    template <typename SYS>
+    void Tracepoints<XLEN>::run (SYS& sys) {
+        rsp::TimelineScope scope { "tracepoints" };
+        m_frames.clear();
+        m_stop_pass = 0;
+        m_started = true;
+        m_running = true;
+
+        // tracepoint hits ordered by trace position
+        std::vector<std::pair<std::size_t, Tracepoint<XLEN> *>> hits;
+        for (auto& [key, tp] : m_points) {
+            tp.hits = 0;
+            if (!tp.enabled)  continue;
+            for (const auto position : sys.pcIndex(tp.addr)) {
+                hits.emplace_back(position, &tp);
+            }
+        }
+        std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        // the shadow moves forward only, so all conditions are evaluated in one pass
+        const std::size_t cursor = sys.count();
+        for (auto& [position, tp] : hits) {
+            if (!tp->cond.empty()) {
+                sys.seek(position);
+                bool hit = false;
+                for (const auto& cond : tp->cond) {
+                    try {
+                        hit = cond.eval(sys) != 0;
+                    } catch (const std::runtime_error& e) {
+                        hit = true;
+                    }
+                    if (hit)  break;
+                }
+                if (!hit)  continue;
+            }
+            // collect the frame and while-stepping frames
+            for (std::size_t i=0; i<=tp->step && position+i < sys.size(); i++) {
+                m_frames.push_back({position+i, tp->number, sys.address(position+i)});
+            }
+            tp->hits++;
+            // pass count stops the trace run
+            if (tp->pass != 0 && tp->hits >= tp->pass) {
+                m_stop_pass = tp->number;
+                m_running = false;
+                break;
+            }
+        }
+        // while-stepping frames can overlap later hits
+        std::stable_sort(m_frames.begin(), m_frames.end(), [](const auto& a, const auto& b) { return a.position < b.position; });
+        sys.seek(cursor);
+    }
+
+    template <typename XLEN>
+    template <typename PRED>
+    int Tracepoints<XLEN>::find (PRED pred) const {
+        for (std::size_t i = m_frame + 1; i < m_frames.size(); i++) {
+            if (pred(m_frames[i]))  return i;
+        }
+        return -1;
+    }
+
+}
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB compile time XML (target description, memory map)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+
+// C++ includes
+#include <array>
+#include <string_view>
+
+// HDLDB includes
+#include "AddressMap.hpp"
+
+namespace shadow {
+
+    // XML text in a fixed size buffer
+    // (with SIZE=0 only the length is counted)
+    template <std::size_t SIZE>
+    struct XmlText {
+        std::array<char, SIZE> m_buf { };
+        std::size_t            m_len = 0;
+
+        constexpr void append (std::string_view str) {
+            for (const char c : str) {
+                if (m_len < SIZE)  m_buf[m_len] = c;
+                m_len++;
+            }
+        };
+
+        // number in decimal or '0x' prefixed hexadecimal format
+        constexpr void append (std::uint64_t val, const bool hex = false) {
+            std::array<char, 20> tmp { };
+            std::size_t len = 0;
+            do {
+                const unsigned digit = hex ? val % 16 : val % 10;
+                tmp[len++] = "0123456789abcdef"[digit];
+                val = hex ? val / 16 : val / 10;
+            } while (val);
+            if (hex)  append("0x");
+            while (len)  append(std::string_view { &tmp[--len], 1 });
+        };
+
+        constexpr std::string_view view () const { return { m_buf.data(), m_len }; };
+    };
+
+    // XML text generated at compile time, GEN::write(xml) is called twice,
+    // first to count the length and then to fill the buffer
+    template <typename GEN>
+    constexpr auto xmlText { [] {
+        constexpr std::size_t size { [] {
+            XmlText<0> xml { };
+            GEN::write(xml);
+            return xml.m_len;
+        }() };
+        XmlText<size> xml { };
+        GEN::write(xml);
+        return xml;
+    }() };
+
+    // GDB memory map of the given address maps
+    // https://sourceware.org/gdb/current/onlinedocs/gdb.html/Memory-Map-Format.html
+    template <auto... AMAP>
+    struct MemoryMapXml {
+        template <typename OUT>
+        static constexpr void blocks (OUT& xml, const auto& blocks, std::string_view comment) {
+            for (const auto& block : blocks) {
+                if (block.size == 0)  continue;
+                xml.append("  <memory type=\"ram\" start=\"");
+                xml.append(block.base, true);
+                xml.append("\" length=\"");
+                xml.append(block.size, true);
+                xml.append("\"/>");
+                xml.append(comment);
+                xml.append("\n");
+            }
+        };
+
+        template <typename OUT>
+        static constexpr void write (OUT& xml) {
+            xml.append("<?xml version=\"1.0\"?>\n"
+                       "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" \"http://sourceware.org/gdb/gdb-memory-map.dtd\">\n"
+                       "<memory-map>\n");
+            // GDB has no I/O memory type, peripherals are listed as RAM
+            (blocks(xml, AMAP.mem, ""), ...);
+            (blocks(xml, AMAP.i_o, "  <!-- I/O -->"), ...);
+            xml.append("</memory-map>\n");
+        };
+    };
+
+}
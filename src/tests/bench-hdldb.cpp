@@ -0,0 +1,236 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB microbenchmarks (hot paths, JSON output)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// C++ includes
+#include <print>
+#include <string>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <iostream>
+#include <charconv>
+
+// test includes (recorded RV32 test program)
+#include "test.hpp"
+
+using namespace test;
+
+// JSON output format version (increment when the meaning of an entry changes)
+constexpr int BENCH_VERSION = 2;
+
+constexpr std::string_view SOCKET = "bench-socket";
+
+// recorded test program (long inner loop, rare system I/O)
+constexpr int BENCH_ITERATIONS = 256;
+constexpr int BENCH_PERIOD     = 2047;
+
+// keep results alive (the compiler must not remove the benchmarked code)
+volatile std::uint64_t sink;
+
+struct Result {
+    std::string name;
+    std::size_t ops;
+    double      ns;
+};
+
+std::vector<Result> results;
+
+// run 'func' which performs 'ops' operations and record the time per operation
+template <typename FUNC>
+void bench (std::string_view name, const std::size_t ops, FUNC&& func) {
+    const auto start { std::chrono::steady_clock::now() };
+    func();
+    const auto stop  { std::chrono::steady_clock::now() };
+    const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    results.push_back({std::string(name), ops, ns});
+}
+
+////////////////////////////////////////
+// RSP client (acknowledges every packet)
+////////////////////////////////////////
+
+void client (const std::size_t rx_packets, std::string_view packet) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un server { };
+    server.sun_family = AF_UNIX;
+    std::memcpy(server.sun_path, SOCKET.data(), SOCKET.size());
+    while (::connect(fd, reinterpret_cast<struct sockaddr *>(&server), sizeof(server)) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // packets received by the server, wait for acknowledge
+    char ack;
+    for (std::size_t i=0; i<rx_packets; i++) {
+        ::send(fd, packet.data(), packet.size(), 0);
+        ::recv(fd, &ack, 1, 0);
+    }
+    // acknowledge packets sent by the server until it closes the connection
+    std::array<char, 4096> buf;
+    ssize_t size;
+    while ((size = ::recv(fd, buf.data(), buf.size(), 0)) > 0) {
+        for (ssize_t i=0; i<size; i++) {
+            if (buf[i] == '#')  ::send(fd, "+", 1, 0);
+        }
+    }
+    ::close(fd);
+}
+
+////////////////////////////////////////
+// benchmarks
+////////////////////////////////////////
+
+void bench_protocol (const std::size_t num) {
+    // packet with a 64 byte memory write payload
+    std::string payload { "M80000000,40:" };
+    for (int i=0; i<64; i++)  payload += std::format("{:02x}", i);
+    const std::uint8_t checksum = std::accumulate(payload.begin(), payload.end(), 0);
+    const std::string packet { std::format("${}#{:02x}", payload, checksum) };
+
+    std::jthread peer { client, num, packet };
+    ProtocolHdlDb protocol { SOCKET, SystemHdlDb{} };
+
+    bench("packet_rx", num, [&] {
+        for (std::size_t i=0; i<num; i++)  sink = protocol.rx().size();
+    });
+    bench("packet_tx", num, [&] {
+        for (std::size_t i=0; i<num; i++)  protocol.tx(payload);
+    });
+    bench("checksum", num, [&] {
+        for (std::size_t i=0; i<num; i++) {
+            sink = static_cast<std::uint8_t>(std::accumulate(payload.begin() + (i & 1), payload.end(), 0));
+        }
+    });
+
+    const std::string hex { payload.substr(13) };
+    std::vector<std::byte> bin { protocol.hex2bin(hex) };
+    bench("hex_decode", num, [&] {
+        for (std::size_t i=0; i<num; i++)  sink = protocol.hex2bin(hex).size();
+    });
+    bench("hex_encode", num, [&] {
+        for (std::size_t i=0; i<num; i++)  sink = protocol.bin2hex(bin).size();
+    });
+
+    // typical GDB session packets (each reply is acknowledged by the client)
+    const std::array<std::string_view, 6> session { "g", "m80000000,40", "p20", payload, "Z0,80000010,4", "z0,80000010,4" };
+    bench("protocol_parse", num, [&] {
+        for (std::size_t i=0; i<num; i++)  protocol.parse(session[i % session.size()]);
+    });
+}
+
+void bench_memory (const std::size_t num) {
+    auto mmap { std::make_unique<MmapCoreHdlDb>() };
+    const XlenHdlDb base = memCore0HdlDb.base;
+    const XlenHdlDb mask = memCore0HdlDb.size - 4;
+    bench("memory_store", num, [&] {
+        for (std::size_t i=0; i<num; i++)  mmap->store<std::uint32_t>(base + ((4*i) & mask), i);
+    });
+    bench("memory_load", num, [&] {
+        std::uint64_t sum = 0;
+        for (std::size_t i=0; i<num; i++)  sum += mmap->load<std::uint32_t>(base + ((4*i) & mask));
+        sink = sum;
+    });
+    bench("memory_read", num, [&] {
+        std::uint64_t sum = 0;
+        for (std::size_t i=0; i<num; i++)  sum += mmap->read(base + ((4*i) & mask), 16).size();
+        sink = sum;
+    });
+}
+
+void bench_trace (const std::size_t num) {
+    const rsp::ThreadId thread { 1, 1 };
+    auto sys { std::make_unique<SystemHdlDb>() };
+
+    bench("iss_record", num, [&] {
+        record(*sys, num, BENCH_ITERATIONS, BENCH_PERIOD);
+    });
+    bench("revert", num, [&] {
+        sys->seek(0);
+    });
+    bench("replay", num, [&] {
+        sys->seek(num);
+    });
+
+    // decode of the recorded instructions
+    const auto program { test::program(BENCH_ITERATIONS, BENCH_PERIOD) };
+    bench("iss_decode", num, [&] {
+        std::uint64_t sum = 0;
+        for (std::size_t i=0; i<num; i++)  sum += IssHdlDb::decode(program[i % program.size()]) != nullptr;
+        sink = sum;
+    });
+
+    // trace file record encode/decode
+    std::stringstream stream;
+    bench("trace_encode", num, [&] {
+        for (std::size_t i=0; i<num; i++)  trace::writeRetired(stream, sys->retired(i));
+    });
+    bench("trace_decode", num, [&] {
+        for (std::size_t i=0; i<num; i++)  sink = trace::readRetired<XlenHdlDb, FlenHdlDb, VlenHdlDb>(stream).ifu.adr;
+    });
+
+    // stepping with breakpoint/watchpoint matching (breakpoints are never hit)
+    sys->seek(0);
+    sys->pointInsert(thread, rsp::PointType::swbreak, memCore0HdlDb.base + 0x100, 4);
+    sys->pointInsert(thread, rsp::PointType::watch  , memCore0HdlDb.base + 0x10000 - 4, 4);
+    bench("points_match", num, [&] {
+        std::uint64_t sum = 0;
+        for (std::size_t i=0; i<num; i++)  sum += sys->pointMatch(thread, sys->retired(i));
+        sink = sum;
+    });
+    bench("step_forward", num, [&] {
+        for (std::size_t i=0; i<num; i++)  sys->forward();
+    });
+    bench("step_backward", num, [&] {
+        for (std::size_t i=0; i<num; i++)  sys->backward();
+    });
+    // unindexed search of the columnar trace for a point candidate
+    const auto breaks  { sys->m_cores[0].breaks() };
+    const auto watches { sys->m_cores[0].watches() };
+    const auto windows { sys->m_columns.windows(watches) };
+    bench("points_scan", num, [&] {
+        sink = sys->m_columns.find(0, num, true, breaks, watches, windows).value_or(0);
+    });
+}
+
+int main (int argc, char* argv[]) {
+    // optional number of operations for each benchmark
+    std::size_t num = 1 << 18;
+    if (argc > 1)  std::from_chars(argv[1], argv[1] + std::strlen(argv[1]), num);
+
+    // silence packet logging
+    std::ostringstream null;
+    auto* cout = std::cout.rdbuf(null.rdbuf());
+    bench_protocol(num / 16);
+    std::cout.rdbuf(cout);
+
+    bench_memory(num);
+    bench_trace(num);
+
+    // stable JSON output (entries are never reordered or renamed)
+    std::println("{{");
+    std::println("  \"version\": {},", BENCH_VERSION);
+    std::println("  \"benchmarks\": [");
+    for (std::size_t i=0; i<results.size(); i++) {
+        const auto& res = results[i];
+        std::println("    {{\"name\": \"{}\", \"ops\": {}, \"ns_per_op\": {:.3f}, \"ops_per_s\": {:.0f}}}{}",
+            res.name, res.ops, res.ns / res.ops, 1e9 * res.ops / res.ns, (i+1 < results.size()) ? "," : "");
+    }
+    std::println("  ]");
+    std::println("}}");
+    return 0;
+}
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: GDB agent expression evaluation and edge cases
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+using shadow::AgentOp;
+using shadow::AgentExpr;
+
+// evaluation context (registers hold their number times 0x10,
+// memory holds the low address byte, except for a string at 0x100)
+struct Context {
+    std::string console;
+
+    std::uint64_t agentReg (unsigned int regnum) { return regnum * 0x10; }
+    std::uint64_t agentMem (std::uint64_t addr, std::size_t size) {
+        std::uint64_t val = 0;
+        for (std::size_t i=0; i<size; i++) {
+            const std::uint64_t adr = addr + i;
+            const std::string_view str { "hello" };
+            const std::uint64_t byte = (adr >= 0x100 && adr < 0x108) ? ((adr - 0x100 < str.size()) ? str[adr - 0x100] : 0) : adr & 0xff;
+            val |= byte << (8*i);
+        }
+        return val;
+    }
+    void agentPrint (std::string_view str) { console += str; }
+};
+
+// bytecode from opcodes and operand bytes
+struct Code : std::vector<std::byte> {
+    Code (std::initializer_list<int> list) {
+        for (const int b : list)  push_back(static_cast<std::byte>(b));
+    }
+};
+
+constexpr int op (AgentOp op) { return static_cast<int>(op); }
+
+// 64 bit constant
+Code const64 (std::int64_t val) {
+    Code code { op(AgentOp::const64) };
+    for (int i=7; i>=0; i--)  code.push_back(static_cast<std::byte>(static_cast<std::uint64_t>(val) >> (8*i)));
+    return code;
+}
+
+Code operator+ (Code a, const Code& b) {
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+std::int64_t eval (const Code& code) {
+    Context ctx;
+    return AgentExpr(code).eval(ctx);
+}
+
+bool throws (const Code& code) {
+    try {
+        eval(code);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+const Code END { op(AgentOp::end) };
+
+int main () {
+    constexpr std::int64_t MIN = std::numeric_limits<std::int64_t>::min();
+
+    // arithmetic
+    expect(eval(Code{op(AgentOp::const8), 7, op(AgentOp::const8), 5, op(AgentOp::sub)} + END) == 2, "sub");
+    expect(eval(Code{op(AgentOp::const16), 0x01, 0x00, op(AgentOp::const8), 3, op(AgentOp::mul)} + END) == 0x300, "big endian operand");
+    expect(eval(const64(-7) + Code{op(AgentOp::const8), 2, op(AgentOp::div_signed)} + END) == -3, "signed division");
+    expect(eval(const64(-7) + Code{op(AgentOp::const8), 2, op(AgentOp::rem_signed)} + END) == -1, "signed remainder");
+    expect(eval(const64(-1) + Code{op(AgentOp::const8), 2, op(AgentOp::div_unsigned)} + END) == std::numeric_limits<std::int64_t>::max(), "unsigned division");
+    expect(eval(const64(-1) + Code{op(AgentOp::const8), 4, op(AgentOp::rsh_signed)} + END) == -1, "arithmetic shift");
+    expect(eval(const64(-1) + Code{op(AgentOp::const8), 60, op(AgentOp::rsh_unsigned)} + END) == 0xf, "logical shift");
+    expect(eval(const64(-1) + Code{op(AgentOp::const8), 1, op(AgentOp::less_unsigned)} + END) == 0, "unsigned compare");
+    expect(eval(const64(-1) + Code{op(AgentOp::const8), 1, op(AgentOp::less_signed)} + END) == 1, "signed compare");
+
+    // sign/zero extension
+    expect(eval(Code{op(AgentOp::const8), 0x80, op(AgentOp::ext), 8} + END) == -128, "sign extension");
+    expect(eval(const64(-1) + Code{op(AgentOp::zero_ext), 16} + END) == 0xffff, "zero extension");
+    expect(eval(const64(MIN) + Code{op(AgentOp::ext), 64} + END) == MIN, "64 bit extension");
+
+    // stack manipulation
+    const Code abc { op(AgentOp::const8), 1, op(AgentOp::const8), 2, op(AgentOp::const8), 3 };
+    expect(eval(abc + Code{op(AgentOp::pick), 2} + END) == 1, "pick");
+    expect(eval(abc + Code{op(AgentOp::rot)} + END) == 2, "rot top");
+    expect(eval(abc + Code{op(AgentOp::rot), op(AgentOp::pop)} + END) == 1, "rot middle");
+    expect(eval(abc + Code{op(AgentOp::rot), op(AgentOp::pop), op(AgentOp::pop)} + END) == 3, "rot bottom");
+    expect(eval(abc + Code{op(AgentOp::swap), op(AgentOp::sub)} + END) == 1, "swap");
+    expect(eval(Code{} + END) == 0, "empty stack result");
+
+    // registers, memory and branches
+    expect(eval(Code{op(AgentOp::reg), 0x00, 0x20} + END) == 0x200, "register");
+    expect(eval(Code{op(AgentOp::const16), 0x12, 0x34, op(AgentOp::ref32)} + END) == 0x37363534, "memory");
+    expect(eval(Code{op(AgentOp::const8), 0, op(AgentOp::if_goto), 0x00, 0x08, op(AgentOp::const8), 1, op(AgentOp::end), op(AgentOp::const8), 2} + END) == 1, "branch not taken");
+    expect(eval(Code{op(AgentOp::const8), 1, op(AgentOp::if_goto), 0x00, 0x08, op(AgentOp::const8), 1, op(AgentOp::end), op(AgentOp::const8), 2} + END) == 2, "branch taken");
+
+    // printf (args... channel function =>)
+    {
+        const std::string_view fmt { "%s %d %#x %c%%\0", 15 };
+        Code code { op(AgentOp::const8), 'A', op(AgentOp::const8), 0xab, op(AgentOp::const8), 0xff, op(AgentOp::ext), 8, op(AgentOp::const16), 0x01, 0x00,
+                    op(AgentOp::const8), 0, op(AgentOp::const8), 0, op(AgentOp::printf_), 4, 0x00, static_cast<int>(fmt.size()) };
+        for (const char ch : fmt)  code.push_back(static_cast<std::byte>(ch));
+        Context ctx;
+        expect(AgentExpr(code + END).eval(ctx) == 0, "printf leaves nothing on the stack");
+        expect(ctx.console == "hello -1 0xab A%", "printf output");
+        // format without the terminating NUL
+        code[code.size() - 1] = std::byte{'x'};
+        expect(throws(code + END), "printf format not terminated");
+        // missing argument
+        Code missing { op(AgentOp::const8), 0, op(AgentOp::const8), 0, op(AgentOp::printf_), 0, 0x00, 3, '%', 'd', 0 };
+        expect(throws(missing + END), "printf argument missing");
+        // too many arguments for the stack
+        Code deep { op(AgentOp::const8), 0, op(AgentOp::const8), 0, op(AgentOp::printf_), 0xff, 0x00, 1, 0 };
+        expect(throws(deep + END), "printf arguments underflow");
+    }
+
+    // printf format escapes (as written in the 'dprintf' command)
+    {
+        auto print = [](std::string_view fmt) {
+            Code code { op(AgentOp::const8), 0x20, op(AgentOp::const8), 0, op(AgentOp::const8), 0, op(AgentOp::printf_), 1, 0x00, static_cast<int>(fmt.size() + 1) };
+            for (const char ch : fmt)  code.push_back(static_cast<std::byte>(ch));
+            code.push_back(std::byte{0});
+            Context ctx;
+            AgentExpr(code + END).eval(ctx);
+            return ctx.console;
+        };
+        expect(print(R"(x=%d\n)") == "x=32\n", "printf newline escape");
+        expect(print(R"(\t\"%x\"\\\a\b\e\f\r\v)") == "\t\"20\"\\\a\b\x1b\f\r\v", "printf escapes");
+        bool unknown = false;
+        try { print(R"(%d\q)"); } catch (const std::runtime_error&) { unknown = true; }
+        expect(unknown, "printf unknown escape");
+        bool trailing = false;
+        try { print(R"(%d\)"); } catch (const std::runtime_error&) { trailing = true; }
+        expect(trailing, "printf trailing escape");
+    }
+
+    // errors
+    expect(throws(const64(MIN) + const64(-1) + Code{op(AgentOp::div_signed)} + END), "signed division overflow");
+    expect(throws(const64(MIN) + const64(-1) + Code{op(AgentOp::rem_signed)} + END), "signed remainder overflow");
+    expect(eval(const64(MIN) + const64(-1) + Code{op(AgentOp::div_unsigned)} + END) == 0, "unsigned division of the signed minimum");
+    for (const AgentOp div : {AgentOp::div_signed, AgentOp::div_unsigned, AgentOp::rem_signed, AgentOp::rem_unsigned}) {
+        expect(throws(Code{op(AgentOp::const8), 1, op(AgentOp::const8), 0, op(div)} + END), "division by zero");
+    }
+    expect(throws(Code{op(AgentOp::const8), 1, op(AgentOp::ext), 0} + END), "sign extension from 0 bits");
+    expect(throws(Code{op(AgentOp::const8), 1, op(AgentOp::zero_ext), 0} + END), "zero extension from 0 bits");
+    expect(throws(Code{op(AgentOp::getv), 0x00, 0x00} + END), "getv unsupported");
+    expect(throws(Code{op(AgentOp::const8), 1, op(AgentOp::setv), 0x00, 0x00} + END), "setv unsupported");
+    expect(throws(Code{op(AgentOp::add)} + END), "stack underflow");
+    expect(throws(Code{op(AgentOp::const8), 1, op(AgentOp::pick), 1} + END), "pick underflow");
+    expect(throws(Code{op(AgentOp::const8), 1, op(AgentOp::goto_), 0x00, 0x00}), "stack overflow");
+    expect(throws(Code{op(AgentOp::goto_), 0x00, 0x00}), "step limit");
+    expect(throws(Code{op(AgentOp::const8), 1}), "expression without end");
+    expect(throws(Code{op(AgentOp::const32), 1, 2}), "operand out of bounds");
+    expect(throws(Code{op(AgentOp::goto_), 0x10, 0x00} + END), "branch out of bounds");
+
+    return result("test-agentexpr");
+}
@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: columnar trace scans agree with breakpoint/watchpoint matching
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <optional>
+#include <utility>
+#include <vector>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+
+using PointsHdlDb = shadow::Points<XlenHdlDb, FlenHdlDb, VlenHdlDb>;
+
+// points inserted into the shadow and the reference matcher
+struct Insert {
+    rsp::PointType type;
+    XlenHdlDb      addr;
+    rsp::PointKind kind;
+};
+
+// frequent candidates
+const std::vector<Insert> dense {
+    {rsp::PointType::hwbreak, memCore0HdlDb.base + STORE, 4},
+    {rsp::PointType::awatch , memCore0HdlDb.base + 0x614, 4},  // word store, 6th iteration
+    {rsp::PointType::awatch , 0x8003'000d               , 1},  // byte I/O store, 4th I/O pass
+    {rsp::PointType::awatch , memCore0HdlDb.base + 0x41a, 2},  // inside a word load
+};
+
+// rare candidates (long skips)
+const std::vector<Insert> sparse {
+    {rsp::PointType::hwbreak, memCore0HdlDb.base + 0x100, 4},  // never executed
+    {rsp::PointType::awatch , 0x8003'0005               , 1},  // byte I/O store, 2nd I/O pass
+};
+
+// first (forward) or last (backward) position in [from, to) matched by the reference
+std::optional<std::size_t> reference (SystemHdlDb& sys, PointsHdlDb& ref, const std::size_t from, const std::size_t to, const bool forward) {
+    for (std::size_t i=0; i<to-from; i++) {
+        const std::size_t pos = forward ? from + i : to - 1 - i;
+        const auto& ret { sys.retired(pos) };
+        if (ref.matchBreak(ret, sys) || ref.matchWatch(ret))  return pos;
+    }
+    return std::nullopt;
+}
+
+// shadow state of all harts (registers, core memory and system I/O)
+std::vector<std::byte> state (SystemHdlDb& sys) {
+    std::vector<std::byte> val;
+    for (std::size_t h=0; h<sys.harts(); h++) {
+        const rsp::ThreadId thread { 1, static_cast<int>(h)+1 };
+        for (const auto [addr, size] : {std::pair<XlenHdlDb, std::size_t>{0, 0}, {memCore0HdlDb.base + 0x600, 0x40}, {0x8003'0000, 0x40}}) {
+            const auto data { size ? sys.mem_read(thread, addr, size) : sys.reg_readAll(thread) };
+            val.insert(val.end(), data.begin(), data.end());
+        }
+    }
+    return val;
+}
+
+// trace positions (and shadow state) continue/reverse continue stop at
+// (with or without skipping), until the replay reaches the trace edge
+std::vector<std::pair<std::size_t, std::vector<std::byte>>> stops (SystemHdlDb& sys, const bool forward, const bool skip) {
+    // single step (returns true if the replay stops)
+    auto step = [&] {
+        if (forward) {
+            if (skip)  sys.skipForward();
+            return sys.forward();
+        }
+        if (skip)  sys.skipBackward();
+        return sys.backward();
+    };
+    std::vector<std::pair<std::size_t, std::vector<std::byte>>> pos;
+    // without skipping the start is reached by single steps (the reference for seeking)
+    const std::size_t start = forward ? 0 : sys.size();
+    if (skip)  sys.seek(start);
+    while (sys.count() < start)  sys.forward();
+    while (sys.count() > start)  sys.backward();
+    do {
+        while (!step());
+        pos.emplace_back(sys.count(), state(sys));
+    } while (forward ? (sys.count() < sys.size()) : (sys.count() > 0));
+    return pos;
+}
+
+// 'scan' compares trace scans from many positions against the reference
+void check (const std::size_t harts, const std::size_t num, const int iterations, const int period, const std::vector<Insert>& points, const bool scan) {
+    SystemHdlDb sys { harts };
+    record(sys, num, iterations, period);
+    PointsHdlDb ref;
+    for (const auto& p : points) {
+        sys.pointInsert({1, 1}, p.type, p.addr, p.kind);
+        ref.insert(p.type, p.addr, p.kind);
+    }
+
+    // scans from many start/end positions
+    const auto breaks  { sys.m_cores[0].breaks() };
+    const auto watches { sys.m_cores[0].watches() };
+    const auto windows { sys.m_columns.windows(watches) };
+    for (std::size_t from=0; scan && from<num; from+=7) {
+        expect(sys.m_columns.find(from, num, true, breaks, watches, windows) == reference(sys, ref, from, num, true), "forward scan");
+        expect(sys.m_columns.find(0, from, false, breaks, watches, windows) == reference(sys, ref, 0, from, false), "backward scan");
+    }
+
+    // replay stops at the same positions with the same state with and without skipping
+    const auto forward { stops(sys, true, false) };
+    expect(forward.size() > 1, "forward replay stops");
+    expect(forward  == stops(sys, true , true), "forward replay with skips");
+    expect(stops(sys, false, false) == stops(sys, false, true), "backward replay with skips");
+
+    // removed points are no longer scanned for (the point set is rebuilt)
+    for (const auto& p : points)  sys.pointRemove({1, 1}, p.type, p.addr, p.kind);
+    const auto end { stops(sys, true, true) };
+    expect(end.size() == 1 && end[0].first == num, "replay without points");
+}
+
+int main () {
+    // single hart
+    check(1, 2000, ITERATIONS, 1, dense, true);
+    // multiple harts, synchronized by system I/O accesses in each pass
+    check(3, 2000, ITERATIONS, 1, dense, true);
+    // multiple harts with long runs between synchronization points, skips cross
+    // many of them (the harts are replayed in parallel between them)
+    check(2, 300000, 2047, 4, sparse, false);
+    return result("test-columns");
+}
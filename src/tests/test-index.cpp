@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: trace index sidecar round trip and corrupt sidecar rejection
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C includes
+#include <cstddef>
+
+// C++ includes
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+
+constexpr std::size_t NUM = 1000;
+
+const std::string TRACE { (std::filesystem::temp_directory_path() / "hdldb-test-index.trc").string() };
+const std::string INDEX { (std::filesystem::temp_directory_path() / "hdldb-test-index.idx").string() };
+
+// reference instructions
+std::vector<RetHdlDb> reference;
+
+// write a trace of the test program, where every 8th load returns
+// a value not found in memory (I/O), so load records are logged
+void write () {
+    SystemHdlDb dut { 1 }, rec { 1 };
+    trace::Writer<XlenHdlDb, FlenHdlDb, VlenHdlDb, SystemHdlDb> writer { TRACE, rec };
+    const rsp::ThreadId thread { 1, 1 };
+    const auto code { program() };
+    std::vector<std::byte> img (code.size() * 4);
+    std::memcpy(img.data(), code.data(), img.size());
+    writer.memory(0, memCore0HdlDb.base, img);
+    dut.mem_write(thread, memCore0HdlDb.base, img);
+    const auto all { dut.reg_readAll(thread) };
+    std::vector<std::byte> regs (all.begin(), all.end());
+    const XlenHdlDb pc = memCore0HdlDb.base;
+    std::memcpy(regs.data() + 32 * sizeof(XlenHdlDb), &pc, sizeof(pc));
+    writer.registers(0, regs);
+    dut.reg_writeAll(thread, regs);
+
+    std::size_t loads = 0;
+    for (std::size_t i=0; i<NUM; i++) {
+        auto read = [&](const XlenHdlDb adr, const std::size_t size) { return dut.mem_read(thread, adr, size); };
+        std::vector<std::byte> io (sizeof(XlenHdlDb));
+        auto load = [&](const XlenHdlDb adr, const std::size_t size) {
+            if (loads++ % 8)  return std::span<const std::byte>(read(adr, size));
+            const XlenHdlDb val = 0x1000 + i;
+            std::memcpy(io.data(), &val, sizeof(val));
+            return std::span<const std::byte>(io).first(size);
+        };
+        RetHdlDb ret;
+        IssHdlDb::execute(dut.m_cores[0], read, load, ret);
+        ret.time = i;
+        reference.push_back(ret);
+        writer.retire(0, ret);
+        dut.push(0, std::move(ret));
+        dut.seek(dut.size());
+    }
+    expect(writer.logged() > 0, "logged load records");
+}
+
+// open the trace (returns true if the sidecar was used), check the loaded trace
+bool open (const bool verify = false) {
+    SystemHdlDb sys { 1 };
+    const bool used = trace::open<XlenHdlDb, FlenHdlDb, VlenHdlDb>(TRACE, INDEX, sys, verify);
+    expect(sys.size() == NUM, "trace size");
+    bool same = sys.size() == NUM;
+    for (std::size_t i=0; same && i<NUM; i++) {
+        const auto& ret { sys.retired(i) };
+        same = IssHdlDb::same(ret, reference[i]) && ret.lsu.rdt == reference[i].lsu.rdt;
+    }
+    expect(same, "trace contents");
+    // the indexes agree with the trace
+    std::vector<std::size_t> stores;
+    for (std::size_t i=0; i<sys.size(); i++) {
+        if (sys.address(i) == memCore0HdlDb.base + STORE)  stores.push_back(i);
+    }
+    expect(std::ranges::equal(sys.pcIndex(memCore0HdlDb.base + STORE), stores), "PC index");
+    return used;
+}
+
+// overwrite a 64 bit value in the sidecar
+void patch (const std::size_t offset, const std::uint64_t val) {
+    std::fstream file { INDEX, std::ios::in | std::ios::out | std::ios::binary };
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+int main () {
+    write();
+    std::filesystem::remove(INDEX);
+
+    // the sidecar is written on first open, and used after that
+    expect(!open(), "sidecar written");
+    expect( open(), "sidecar used");
+    expect( open(true), "sidecar verified");
+
+    trace::IndexHeader hdr;
+    {
+        std::ifstream file { INDEX, std::ios::binary };
+        file.read(reinterpret_cast<char *>(&hdr), sizeof(hdr));
+    }
+    auto section = [&](const trace::Section sec) { return hdr.sections[static_cast<std::size_t>(sec)]; };
+    // offset of the section offset/size in the header
+    auto entry = [&](const trace::Section sec) { return offsetof(trace::IndexHeader, sections) + 16 * static_cast<std::size_t>(sec); };
+
+    // each corrupt sidecar is rejected (the trace is loaded from the trace file)
+    // and rebuilt (the following open uses it)
+    auto rejected = [&](std::string_view what) {
+        expect(!open(), what);
+        expect( open(), "sidecar rebuilt");
+    };
+    patch(section(trace::Section::pc_offsets)[0] + 8, 1 << 20);
+    rejected("offsets beyond positions");
+    expect(section(trace::Section::wr_positions)[1] > 0, "store positions");
+    patch(section(trace::Section::wr_positions)[0], NUM + 1);
+    rejected("position beyond the trace");
+    patch(entry(trace::Section::col_pc) + 8, section(trace::Section::col_pc)[1] - 4);
+    rejected("column length");
+    patch(entry(trace::Section::col_fpr_idx) + 8, 3);
+    rejected("column of a missing extension");
+    patch(entry(trace::Section::wr_keys), ~std::uint64_t{0} - 7);
+    rejected("section beyond the file");
+    patch(offsetof(trace::IndexHeader, magic), 0);
+    rejected("magic");
+    patch(offsetof(trace::IndexHeader, count), NUM + 1);
+    rejected("count");
+
+    // a wrong trace hash is only detected when verifying
+    patch(offsetof(trace::IndexHeader, hash), 123);
+    expect( open(), "hash not checked");
+    expect(!open(true), "hash mismatch");
+    expect( open(true), "sidecar rebuilt with hash");
+
+    // a modified trace file invalidates the sidecar
+    std::filesystem::last_write_time(TRACE, std::filesystem::last_write_time(TRACE) + std::chrono::seconds(1));
+    rejected("trace modification time");
+
+    std::filesystem::remove(TRACE);
+    std::filesystem::remove(INDEX);
+    return result("test-index");
+}
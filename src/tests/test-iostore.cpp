@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: I/O register store replay/revert round trips
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <array>
+#include <vector>
+#include <memory>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+
+constexpr std::size_t NUM  = 4000;
+constexpr std::size_t REGS = 40;
+
+using IoStoreHdlDb = shadow::IoStore<XlenHdlDb>;
+
+// DUT access (one per retired instruction)
+struct Access {
+    XlenHdlDb              addr;
+    std::vector<std::byte> data;
+};
+
+// register values at a shadow position
+using Values = std::array<XlenHdlDb, REGS>;
+
+constexpr XlenHdlDb BASE = 0x1000'0000;
+
+Values values (IoStoreHdlDb& io) {
+    Values val;
+    for (std::size_t r=0; r<REGS; r++) {
+        std::memcpy(&val[r], io.read(BASE + r * sizeof(XlenHdlDb), sizeof(XlenHdlDb)).data(), sizeof(XlenHdlDb));
+    }
+    return val;
+}
+
+int main () {
+    // pseudo random accesses of 1/2/4 bytes (deterministic LCG)
+    std::uint32_t seed = 1;
+    auto random = [&] { seed = seed * 1664525 + 1013904223; return seed >> 8; };
+    std::vector<Access> accesses;
+    for (std::size_t cnt=0; cnt<NUM; cnt++) {
+        const std::size_t size = std::size_t{1} << (random() % 3);
+        const XlenHdlDb addr = BASE + (random() % REGS) * sizeof(XlenHdlDb) + (random() % (sizeof(XlenHdlDb) / size)) * size;
+        std::vector<std::byte> data (size);
+        for (auto& b : data)  b = static_cast<std::byte>(random());
+        accesses.push_back({addr, std::move(data)});
+    }
+
+    // the minimal table size forces rehashing while recording
+    for (const std::size_t size : {0, 1, 256}) {
+        IoStoreHdlDb io { size };
+        std::vector<Values> snapshots { values(io) };
+        for (std::size_t cnt=0; cnt<NUM; cnt++) {
+            io.replay(cnt, accesses[cnt].addr, accesses[cnt].data);
+            snapshots.push_back(values(io));
+            expect(std::memcmp(io.read(accesses[cnt].addr, accesses[cnt].data.size()).data(), accesses[cnt].data.data(), accesses[cnt].data.size()) == 0, "recorded access value");
+        }
+        expect(io.size() == REGS, "register count");
+        expect(io.length() == NUM, "access count");
+
+        // revert to the start, every intermediate position sees the recorded values
+        for (std::size_t cnt=NUM; cnt-->0;) {
+            io.revert(cnt, accesses[cnt].addr);
+            expect(values(io) == snapshots[cnt], "revert");
+        }
+        expect(values(io) == Values{}, "reverted to the start");
+
+        // replay follows the recorded chain (the replayed data is ignored)
+        const std::vector<std::byte> zero (sizeof(XlenHdlDb));
+        for (std::size_t cnt=0; cnt<NUM; cnt++) {
+            io.replay(cnt, accesses[cnt].addr, std::span(zero).first(accesses[cnt].data.size()));
+            expect(values(io) == snapshots[cnt+1], "replay");
+        }
+        expect(io.length() == NUM, "replay does not record accesses");
+
+        // debugger write overrides the value at the current position only
+        for (std::size_t cnt=NUM; cnt-->NUM/2;)  io.revert(cnt, accesses[cnt].addr);
+        const XlenHdlDb reg = accesses[NUM/2 - 1].addr - accesses[NUM/2 - 1].addr % sizeof(XlenHdlDb);
+        const XlenHdlDb val = 0x5a5a'5a5a;
+        io.write(reg, std::as_bytes(std::span(&val, 1)));
+        Values written { snapshots[NUM/2] };
+        written[(reg - BASE) / sizeof(XlenHdlDb)] = val;
+        expect(values(io) == written, "debugger write");
+        for (std::size_t cnt=NUM/2; cnt-->0;)  io.revert(cnt, accesses[cnt].addr);
+        expect(values(io) == Values{}, "debugger write reverted");
+
+        // debugger write before the first DUT access (at counter 0) of a register
+        const XlenHdlDb first = accesses[0].addr - accesses[0].addr % sizeof(XlenHdlDb);
+        io.write(first, std::as_bytes(std::span(&val, 1)));
+        Values before {};
+        before[(first - BASE) / sizeof(XlenHdlDb)] = val;
+        expect(values(io) == before, "debugger write before the first access");
+        io.replay(0, accesses[0].addr, accesses[0].data);
+        expect(values(io) == snapshots[1], "replay after a debugger write before the first access");
+        io.revert(0, accesses[0].addr);
+        expect(values(io) == before, "revert to a debugger write before the first access");
+        expect(io.length() == NUM + 1, "debugger write entry");
+    }
+
+    // memory reads/writes crossing the end of a memory block are clipped
+    auto mmap { std::make_unique<MmapCoreHdlDb>() };
+    const XlenHdlDb end = memCore0HdlDb.base + memCore0HdlDb.size;
+    std::array<std::byte, 8> data;
+    data.fill(std::byte{0xa5});
+    mmap->write(end - 2, data);
+    expect(mmap->read(end - 2, data.size()).size() == 2, "memory read clipped");
+    expect(mmap->read(end - 4, 4)[2] == std::byte{0xa5}, "memory write clipped");
+
+    return result("test-iostore");
+}
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: watchpoint access types on a replayed trace
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <vector>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+
+constexpr std::size_t NUM = 1000;
+
+// watched addresses (a word only loaded, a word only stored)
+constexpr XlenHdlDb LOADED = memCore0HdlDb.base + 0x404;
+constexpr XlenHdlDb STORED = memCore0HdlDb.base + 0x604;
+
+// positions (of the accessing instruction) continue/reverse continue stop at,
+// until the replay reaches the trace edge
+std::vector<std::size_t> stops (SystemHdlDb& sys, const bool forward, const rsp::PointType type, const XlenHdlDb addr) {
+    std::vector<std::size_t> pos;
+    sys.seek(forward ? 0 : sys.size());
+    while (forward ? (sys.count() < sys.size()) : (sys.count() > 0)) {
+        while (!(forward ? sys.forward() : sys.backward()));
+        const auto& reason { sys.m_cores[0].m_reason };
+        if (reason.type == rsp::PointType::replaylog)  break;
+        expect(reason.type == type && sys.m_cores[0].m_reason_addr == addr, "stop reason");
+        pos.push_back(forward ? sys.count() - 1 : sys.count());
+    }
+    return pos;
+}
+
+// positions of accesses to the given address
+std::vector<std::size_t> accesses (SystemHdlDb& sys, const XlenHdlDb addr) {
+    std::vector<std::size_t> pos;
+    for (std::size_t i=0; i<sys.size(); i++) {
+        const auto& ret { sys.retired(i) };
+        if ((!ret.lsu.rdt.empty() || !ret.lsu.wdt.empty()) && ret.lsu.adr == addr)  pos.push_back(i);
+    }
+    return pos;
+}
+
+// watchpoint stops in both directions
+void check (SystemHdlDb& sys, const rsp::PointType type, const XlenHdlDb addr, const std::vector<std::size_t>& ref, std::string_view what) {
+    sys.pointInsert({1, 1}, type, addr, 4);
+    expect(stops(sys, true , type, addr) == ref, what);
+    expect(stops(sys, false, type, addr) == std::vector<std::size_t>(ref.rbegin(), ref.rend()), what);
+    sys.pointRemove({1, 1}, type, addr, 4);
+}
+
+int main () {
+    // the trace is replayed (and reverted) once while recording
+    SystemHdlDb sys { 1 };
+    record(sys, NUM);
+    const auto loads  { accesses(sys, LOADED) };
+    const auto stores { accesses(sys, STORED) };
+    expect(!loads.empty() && !stores.empty(), "watched accesses");
+
+    // stores carry revert data after replay, which is not a read access
+    check(sys, rsp::PointType::rwatch, STORED, {}    , "read watchpoint on stores");
+    check(sys, rsp::PointType::rwatch, LOADED, loads , "read watchpoint on loads");
+    check(sys, rsp::PointType::watch , LOADED, {}    , "write watchpoint on loads");
+    check(sys, rsp::PointType::watch , STORED, stores, "write watchpoint on stores");
+    check(sys, rsp::PointType::awatch, STORED, stores, "access watchpoint on stores");
+    check(sys, rsp::PointType::awatch, LOADED, loads , "access watchpoint on loads");
+
+    // store revert data restores memory
+    sys.seek(sys.size());
+    sys.seek(0);
+    expect(sys.mem_read({1, 1}, STORED, 4)[0] == std::byte{0}, "store reverted");
+
+    return result("test-points");
+}
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: RSP packets parsed by the protocol over a recorded trace
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C includes
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// C++ includes
+#include <array>
+#include <string>
+#include <vector>
+#include <format>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+#include <initializer_list>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+using shadow::AgentOp;
+
+constexpr std::size_t NUM = 1000;
+
+constexpr std::string_view SOCKET = "test-protocol-socket";
+
+////////////////////////////////////////
+// RSP client (acknowledges and collects packets sent by the server)
+////////////////////////////////////////
+
+void client (std::vector<std::string>& packets) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un server { };
+    server.sun_family = AF_UNIX;
+    std::memcpy(server.sun_path, SOCKET.data(), SOCKET.size());
+    while (::connect(fd, reinterpret_cast<struct sockaddr *>(&server), sizeof(server)) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // '$payload#xx' packets until the server closes the connection
+    std::string stream;
+    std::array<char, 4096> buf;
+    ssize_t size;
+    while ((size = ::recv(fd, buf.data(), buf.size(), 0)) > 0) {
+        stream.append(buf.data(), size);
+        for (std::size_t end; (end = stream.find('#')) != std::string::npos && end + 3 <= stream.size();) {
+            packets.push_back(stream.substr(stream.find('$') + 1, end - stream.find('$') - 1));
+            stream.erase(0, end + 3);
+            ::send(fd, "+", 1, 0);
+        }
+    }
+    ::close(fd);
+}
+
+////////////////////////////////////////
+// packet encoding
+////////////////////////////////////////
+
+std::string hex (std::span<const std::byte> bin) {
+    std::string str;
+    for (const auto b : bin)  str += std::format("{:02x}", std::to_integer<unsigned int>(b));
+    return str;
+}
+
+std::string hex (std::string_view str) {
+    return hex(std::as_bytes(std::span(str)));
+}
+
+constexpr int op (AgentOp op) { return static_cast<int>(op); }
+
+// agent expression as a 'Xlen,expr' packet item
+std::string expr (std::span<const int> list) {
+    std::vector<std::byte> code;
+    for (const int b : list)  code.push_back(static_cast<std::byte>(b));
+    return std::format("X{:x},{}", code.size(), hex(code));
+}
+
+std::string expr (std::initializer_list<int> list) {
+    return expr(std::span(list));
+}
+
+// 'printf' of a register (GDB sends the 'dprintf' format with escapes as written)
+std::string dprintf (std::string_view fmt, const int regnum) {
+    std::vector<int> list { op(AgentOp::reg), 0x00, regnum, op(AgentOp::const8), 0, op(AgentOp::const8), 0, op(AgentOp::printf_), 1, 0x00, static_cast<int>(fmt.size() + 1) };
+    list.insert(list.end(), fmt.begin(), fmt.end());
+    list.push_back(0);
+    list.push_back(op(AgentOp::end));
+    return expr(list);
+}
+
+// packets with the expected reply
+const std::vector<std::pair<std::string, std::string>> replies {
+    // invalid hexadecimal data
+    {"M80000600,4:0102zz04", "E01"},
+    {"M80000600,4:010203", "E01"},
+    {"M80000600,4:01020304", "OK"},
+    {"m80000600,4", "01020304"},
+    {"P1=0x000000", "E01"},
+    {"G" + std::string(33 * 8, 'g'), "E01"},
+    {std::format("Z0,{:x},4;X3,00zz27", memCore0HdlDb.base + STORE), "E01"},
+    {std::format("Z0,{:x},4;X4,0001", memCore0HdlDb.base + STORE), "E01"},
+    // missing tracepoint arguments
+    {"QTEnable:1", "E01"},
+    {"QTDisable:", "E01"},
+    {"qTP:", "E01"},
+    {"QTFrame:", "E01"},
+    {"QTFrame:pc", "E01"},
+    {"QTFrame:tdp", "E01"},
+    {"QTFrame:range:80000000", "E01"},
+    {"QTFrame:outside:80000000", "E01"},
+    {"QTFrame:range:80000000:80001000", "F-1"},
+    {"QTFrame:-1", "F-1"},
+};
+
+int main () {
+    SystemHdlDb sys { 1 };
+    record(sys, NUM);
+
+    // reference console output of a 'dprintf' on the store with the condition (x1 == 3)
+    const XlenHdlDb store = memCore0HdlDb.base + STORE;
+    const rsp::ThreadId thread { 1, 1 };
+    auto reg = [&](const unsigned int regnum) {
+        XlenHdlDb val;
+        std::memcpy(&val, sys.reg_readOne(thread, regnum).data(), sizeof(val));
+        return val;
+    };
+    std::string console;
+    for (std::size_t i=0; i<NUM; i++) {
+        if (sys.address(i) != store)  continue;
+        sys.seek(i);
+        if (reg(1) != 3)  continue;
+        console += std::format("x4={}\n", reg(4));
+    }
+    expect(!console.empty(), "condition holds");
+    sys.seek(0);
+
+    std::vector<std::string> packets;
+    {
+        std::jthread peer { client, std::ref(packets) };
+        ProtocolHdlDb protocol { SOCKET, std::move(sys) };
+
+        // 'dprintf' (condition and commands), continue to the end of the trace
+        const std::string cond { expr({op(AgentOp::reg), 0x00, 0x01, op(AgentOp::const8), 3, op(AgentOp::equal), op(AgentOp::end)}) };
+        const std::string point { std::format("0,{:x},4", store) };
+        protocol.parse(std::format("Z{};{};cmds:0,{}", point, cond, dprintf(R"(x4=%d\n)", 4)));
+        protocol.parse("c");
+        // removed, reverse continue to the start of the trace
+        protocol.parse(std::format("z{}", point));
+        protocol.parse("bc");
+        // condition without commands stops
+        protocol.parse(std::format("Z{};{}", point, cond));
+        protocol.parse("c");
+        // resume only at the current PC (the signal is ignored)
+        protocol.parse(std::format("c{:x}", memCore0HdlDb.base));
+        protocol.parse(std::format("S05;{:x}", store));
+
+        // replies to packets without a run
+        for (const auto& [packet, reply] : replies)  protocol.parse(packet);
+    }
+
+    const XlenHdlDb next = store + 4;
+    const std::string pc { hex(std::as_bytes(std::span(&store, 1))) };
+    expect(packets.size() == 9 + replies.size(), "packet count");
+    if (packets.size() == 9 + replies.size()) {
+        expect(packets[0] == "OK", "dprintf inserted");
+        expect(packets[1] == "O" + hex(console), "dprintf console output");
+        expect(packets[2].contains("replaylog:end;"), "dprintf does not stop");
+        expect(packets[3] == "OK", "dprintf removed");
+        expect(packets[4].contains("replaylog:begin;"), "removed dprintf does not print");
+        expect(packets[5] == "OK", "conditional breakpoint inserted");
+        expect(packets[6].starts_with("T05") && packets[6].contains(std::format("20:{};", pc)), "conditional breakpoint stop");
+        expect(packets[7] == "E01", "continue at another address");
+        expect(packets[8].contains(std::format("20:{};", hex(std::as_bytes(std::span(&next, 1))))), "step at the current address");
+        for (std::size_t i=0; i<replies.size(); i++) {
+            expect(packets[9 + i] == replies[i].second, replies[i].first);
+        }
+    }
+
+    std::filesystem::remove(SOCKET);
+    return result("test-protocol");
+}
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB test: tracepoint runs over a recorded trace
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+
+// test includes
+#include "test.hpp"
+
+using namespace test;
+using shadow::AgentOp;
+using shadow::AgentExpr;
+
+constexpr std::size_t NUM = 1000;
+
+using TracepointHdlDb = shadow::Tracepoint<XlenHdlDb>;
+
+// condition bytecode
+AgentExpr expr (std::initializer_list<int> list) {
+    std::vector<std::byte> code;
+    for (const int b : list)  code.push_back(static_cast<std::byte>(b));
+    return AgentExpr(code);
+}
+
+constexpr int op (AgentOp op) { return static_cast<int>(op); }
+
+// run tracepoints from the given cursor, return frame positions
+std::vector<std::size_t> run (SystemHdlDb& sys, const std::size_t cursor) {
+    sys.seek(cursor);
+    sys.m_tracepoints.run(sys);
+    expect(sys.count() == cursor, "cursor restored");
+    std::vector<std::size_t> pos;
+    for (const auto& frame : sys.m_tracepoints.m_frames) {
+        expect(frame.addr == sys.address(frame.position), "frame address");
+        pos.push_back(frame.position);
+    }
+    return pos;
+}
+
+// trace positions of an instruction
+std::vector<std::size_t> positions (SystemHdlDb& sys, const std::size_t offset) {
+    std::vector<std::size_t> pos;
+    for (std::size_t i=0; i<sys.size(); i++) {
+        if (sys.address(i) == memCore0HdlDb.base + offset)  pos.push_back(i);
+    }
+    return pos;
+}
+
+int main () {
+    SystemHdlDb sys { 1 };
+    record(sys, NUM);
+    auto& tps = sys.m_tracepoints;
+
+    // every execution of the store instruction
+    const XlenHdlDb store = memCore0HdlDb.base + STORE;
+    tps.m_points[{1, store}] = TracepointHdlDb{1, store, true, 0, 0, {}, {}};
+    expect(run(sys, 0) == positions(sys, STORE), "unconditional frames");
+    expect(run(sys, 123) == positions(sys, STORE), "frames independent of the cursor");
+    expect(tps.m_running && tps.m_stop_pass == 0, "run without pass count");
+
+    // disabled tracepoints do not collect frames
+    tps.m_points[{1, store}].enabled = false;
+    expect(run(sys, 0).empty(), "disabled tracepoint");
+
+    // while-stepping frames are merged with frames of other tracepoints
+    tps.m_points[{1, store}].enabled = true;
+    const XlenHdlDb byte = memCore0HdlDb.base + BYTE;
+    tps.m_points[{2, byte}] = TracepointHdlDb{2, byte, true, 2, 0, {}, {}};
+    {
+        std::vector<std::size_t> ref { positions(sys, STORE) };
+        for (const auto pos : positions(sys, BYTE)) {
+            for (std::size_t i=0; i<=2 && pos+i<NUM; i++)  ref.push_back(pos+i);
+        }
+        std::sort(ref.begin(), ref.end());
+        expect(run(sys, NUM) == ref, "while-stepping frames");
+        expect(tps.m_points[{2, byte}].hits == positions(sys, BYTE).size(), "while-stepping hits");
+        for (const auto& frame : tps.m_frames) {
+            const bool stepped = frame.addr != store && frame.addr != byte;
+            expect(frame.number == ((frame.addr == store) ? 1 : 2) || stepped, "frame tracepoint number");
+        }
+    }
+    tps.m_points.erase({2, byte});
+
+    // condition (x1 == 5) holds in the 4th loop iteration of each pass
+    const XlenHdlDb load = memCore0HdlDb.base + LOAD;
+    tps.m_points.erase({1, store});
+    tps.m_points[{3, load}] = TracepointHdlDb{3, load, true, 0, 0, {expr({op(AgentOp::reg), 0x00, 0x01, op(AgentOp::const8), 5, op(AgentOp::equal), op(AgentOp::end)})}, {}};
+    {
+        std::vector<std::size_t> ref;
+        for (std::size_t pos = START + 2 + 3*BODY; pos < NUM; pos += CYCLE)  ref.push_back(pos);
+        expect(run(sys, 500) == ref, "conditional frames");
+    }
+
+    // a condition which fails to evaluate collects the frame
+    tps.m_points[{3, load}].cond = {expr({op(AgentOp::const8), 1, op(AgentOp::const8), 0, op(AgentOp::div_signed), op(AgentOp::end)})};
+    expect(run(sys, 0) == positions(sys, LOAD), "condition error");
+
+    // pass count stops the run
+    tps.m_points[{3, load}].cond.clear();
+    tps.m_points[{3, load}].pass = 3;
+    {
+        const auto ref { positions(sys, LOAD) };
+        expect(run(sys, 0) == std::vector<std::size_t>(ref.begin(), ref.begin() + 3), "pass count frames");
+        expect(!tps.m_running && tps.m_stop_pass == 3, "pass count stop");
+    }
+
+    // frame search after the selected frame
+    tps.m_frame = 0;
+    expect(tps.find([&](const auto& frame) { return frame.position == tps.m_frames[2].position; }) == 2, "frame search");
+    expect(tps.find([&](const auto& frame) { return frame.position == tps.m_frames[0].position; }) == -1, "frame search after selected");
+
+    return result("test-tracepoints");
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB behavior test helpers (checks and a recorded RV32 test program)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// C++ includes
+#include <print>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <source_location>
+
+// HDLDB includes
+#include <hdldb.hpp>
+
+namespace test {
+
+    using RetHdlDb = Retired<XlenHdlDb, FlenHdlDb, VlenHdlDb>;
+    using IssHdlDb = shadow::Iss<XlenHdlDb, FlenHdlDb, VlenHdlDb>;
+
+    // number of failed checks (the test exit status)
+    inline int failures = 0;
+
+    inline void expect (const bool cond, std::string_view what, const std::source_location loc = std::source_location::current()) {
+        if (cond)  return;
+        std::println("FAIL {}:{}: {}", loc.file_name(), loc.line(), what);
+        failures++;
+    }
+
+    // exit status
+    inline int result (std::string_view name) {
+        std::println("{} '{}'.", failures ? "Failed" : "Passed", name);
+        return failures ? 1 : 0;
+    }
+
+    ////////////////////////////////////////
+    // RV32 test program
+    ////////////////////////////////////////
+
+    constexpr std::uint32_t itype (int op, int f3, int rd, int rs1, int imm) { return (imm & 0xfff) << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op; }
+    constexpr std::uint32_t stype (int f3, int rs1, int rs2, int imm) { return ((imm >> 5) & 0x7f) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | (imm & 0x1f) << 7 | 0x23; }
+    constexpr std::uint32_t rtype (int f7, int f3, int rd, int rs1, int rs2) { return f7 << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | rd << 7 | 0x33; }
+    constexpr std::uint32_t utype (int op, int rd, std::uint32_t imm) { return (imm & 0xfffff000) | rd << 7 | op; }
+    constexpr std::uint32_t btype (int f3, int rs1, int rs2, int imm) {
+        return ((imm >> 12) & 1) << 31 | ((imm >> 5) & 0x3f) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | ((imm >> 1) & 0xf) << 8 | ((imm >> 11) & 1) << 7 | 0x63;
+    }
+
+    // endless loop summing a buffer in core memory, each 'period' passes
+    // the sum is written to and read back from system I/O (shared between harts)
+    // (offsets from the program start)
+    constexpr std::size_t LOOP  = 0x10;  // inner loop body
+    constexpr std::size_t LOAD  = 0x10;  // word load  from core memory 0x400 + 4*i
+    constexpr std::size_t STORE = 0x18;  // word store to   core memory 0x600 + 4*i
+    constexpr std::size_t BYTE  = 0x34;  // byte store to   system I/O  0x001 + 4*n
+    constexpr std::size_t IO    = 0x38;  // word load  from system I/O  0x000 + 4*n
+    // trace positions (of a single hart, with I/O in each pass)
+    constexpr std::size_t ITERATIONS = 8;                  // default inner loop iterations
+    constexpr std::size_t START = 2;                       // first pass
+    constexpr std::size_t BODY  = 6;                       // inner loop body length
+    constexpr std::size_t CYCLE = 2 + BODY*ITERATIONS + 7;  // pass length
+
+    inline std::vector<std::uint32_t> program (const int iterations = ITERATIONS, const int period = 1) {
+        return {
+            utype(0x37, 6, 0x80030000),     // lui   x6, 0x80030
+            itype(0x13, 0, 8, 0, 1),        // addi  x8, x0, 1
+            utype(0x37, 5, 0x80000000),     // lui   x5, 0x80000
+            itype(0x13, 0, 1, 0, iterations), // addi  x1, x0, iterations
+            itype(0x03, 2, 3, 5, 0x400),    // lw    x3, 0x400(x5)
+            rtype(0x00, 0, 4, 4, 3),        // add   x4, x4, x3
+            stype(2, 5, 4, 0x600),          // sw    x4, 0x600(x5)
+            itype(0x13, 0, 5, 5, 4),        // addi  x5, x5, 4
+            itype(0x13, 0, 1, 1, -1),       // addi  x1, x1, -1
+            btype(1, 1, 0, -20),            // bne   x1, x0, -20
+            itype(0x13, 0, 8, 8, -1),       // addi  x8, x8, -1
+            btype(1, 8, 0, 20),             // bne   x8, x0, 20
+            itype(0x13, 0, 8, 0, period),   // addi  x8, x0, period
+            stype(0, 6, 4, 1),              // sb    x4, 1(x6)
+            itype(0x03, 2, 7, 6, 0),        // lw    x7, 0(x6)
+            itype(0x13, 0, 6, 6, 4),        // addi  x6, x6, 4
+            btype(0, 0, 0, -56),            // beq   x0, x0, -56
+        };
+    }
+
+    // load the program into each hart and record 'num' instructions executed
+    // by the ISS (multiple harts are interleaved in irregular runs),
+    // the shadow is left at the trace end
+    inline void record (SystemHdlDb& sys, const std::size_t num, const int iterations = ITERATIONS, const int period = 1) {
+        const auto code { program(iterations, period) };
+        std::vector<std::byte> img (code.size() * 4);
+        std::memcpy(img.data(), code.data(), img.size());
+        for (std::size_t h=0; h<sys.harts(); h++) {
+            const rsp::ThreadId thread { 1, static_cast<int>(h)+1 };
+            sys.mem_write(thread, memCore0HdlDb.base, img);
+            // summed buffer (different in each hart)
+            std::vector<XlenHdlDb> buf (0x80);
+            for (std::size_t i=0; i<buf.size(); i++)  buf[i] = 0x100 * i + h + 1;
+            sys.mem_write(thread, memCore0HdlDb.base + 0x400, std::as_writable_bytes(std::span(buf)));
+            XlenHdlDb pc = memCore0HdlDb.base;
+            sys.reg_writeOne(thread, 32, std::as_writable_bytes(std::span(&pc, 1)));
+        }
+
+        std::uint32_t seed = 1;
+        std::size_t h = 0, run = 0;
+        for (std::size_t i=0; i<num; i++) {
+            if (run == 0) {
+                seed = seed * 1664525 + 1013904223;
+                h   = (seed >> 8) % sys.harts();
+                run = 1 + (seed >> 16) % 24;
+            }
+            run--;
+            const rsp::ThreadId thread { 1, static_cast<int>(h)+1 };
+            auto read = [&](const XlenHdlDb adr, const std::size_t size) { return sys.mem_read(thread, adr, size); };
+            RetHdlDb ret;
+            IssHdlDb::execute(sys.m_cores[h], read, read, ret);
+            ret.time = i;
+            sys.push(h, std::move(ret));
+            sys.seek(sys.size());
+        }
+    }
+
+}
@@ -0,0 +1,347 @@
+///////////////////////////////////////////////////////////////////////////////
+// RSP session recorder/replayer (latency measurement)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// A session is recorded once by placing the tool as a proxy between GDB and
+// the server (hdldb or the SV stub), it can then be replayed against either
+// server without GDB, while measuring the reply latency for each packet type.
+//
+// session file format (one client packet per line, binary payload allowed):
+//   <payload length> <payload>\n
+
+// C includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// C++ includes
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+// C++ libraries
+#include <cxxopts.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+////////////////////////////////////////
+// sockets
+////////////////////////////////////////
+
+// connect to 'host:port' (TCP) or a UNIX socket path
+int connectTo (const std::string& server) {
+    const auto colon = server.rfind(':');
+    if (colon == std::string::npos) {
+        struct sockaddr_un addr { };
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, server.c_str(), sizeof(addr.sun_path) - 1);
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "connect to " + server);
+        }
+        return fd;
+    }
+    struct addrinfo hints { };
+    struct addrinfo* res;
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    const std::string host { colon == 0 ? "localhost" : server.substr(0, colon) };
+    if (::getaddrinfo(host.c_str(), server.c_str() + colon + 1, &hints, &res) != 0) {
+        throw std::runtime_error("can not resolve " + server);
+    }
+    const int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    const int status = ::connect(fd, res->ai_addr, res->ai_addrlen);
+    ::freeaddrinfo(res);
+    if (status != 0)  throw std::system_error(errno, std::generic_category(), "connect to " + server);
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// listen on a UNIX socket path (GDB: target extended-remote <path>) and accept one client
+int acceptFrom (const std::string& name) {
+    struct sockaddr_un addr { };
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, name.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(name.c_str());
+    const int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (::bind(server, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(server, 1) != 0) {
+        throw std::system_error(errno, std::generic_category(), "listen on " + name);
+    }
+    std::println("Waiting for GDB on {}.", name);
+    const int fd = ::accept(server, nullptr, nullptr);
+    ::close(server);
+    return fd;
+}
+
+void sendAll (const int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t size = ::send(fd, data.data(), data.size(), 0);
+        if (size <= 0)  throw std::system_error(errno, std::generic_category(), "send");
+        data.remove_prefix(size);
+    }
+}
+
+////////////////////////////////////////
+// packet framing
+////////////////////////////////////////
+
+// incremental packet parser ('$payload#xx', acknowledges and interrupts are skipped)
+class Framer {
+    enum class State { idle, payload, checksum0, checksum1 } m_state = State::idle;
+    std::string m_payload;
+public:
+    // returns true when a complete packet was received
+    bool push (const char c, std::string& packet) {
+        switch (m_state) {
+            case State::idle:
+                if (c == '$') {
+                    m_payload.clear();
+                    m_state = State::payload;
+                }
+                break;
+            case State::payload:
+                if (c == '#')  m_state = State::checksum0;
+                else           m_payload += c;
+                break;
+            case State::checksum0:
+                m_state = State::checksum1;
+                break;
+            case State::checksum1:
+                m_state = State::idle;
+                packet = std::move(m_payload);
+                return true;
+        }
+        return false;
+    }
+};
+
+std::string frame (std::string_view payload) {
+    const std::uint8_t checksum = std::accumulate(payload.begin(), payload.end(), 0);
+    return std::format("${}#{:02x}", payload, checksum);
+}
+
+// statistics key: packet name for query/'v' packets, otherwise the command letter(s)
+std::string packetType (std::string_view packet) {
+    if (packet.empty())  return "";
+    switch (packet[0]) {
+        case 'q': case 'Q': case 'v':
+            return std::string(packet.substr(0, packet.find_first_of(":;,?")));
+        case 'b':  // 'bs' reverse step, 'bc' reverse continue
+        case 'Z': case 'z':
+            return std::string(packet.substr(0, 2));
+        default:
+            return std::string(packet.substr(0, 1));
+    }
+}
+
+////////////////////////////////////////
+// record
+////////////////////////////////////////
+
+// forward traffic between GDB and the server, log client packets
+void record (const std::string& listen, const std::string& server, const std::string& filename) {
+    std::ofstream file { filename, std::ios::binary };
+    if (!file)  throw std::runtime_error("can not open session file " + filename);
+    const int gdb = acceptFrom(listen);
+    const int srv = connectTo(server);
+
+    Framer framer;
+    std::string packet;
+    std::size_t count = 0;
+    std::array<char, 4096> buf;
+    std::array<struct pollfd, 2> fds { { {gdb, POLLIN, 0}, {srv, POLLIN, 0} } };
+    while (::poll(fds.data(), fds.size(), -1) > 0) {
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            const ssize_t size = ::recv(gdb, buf.data(), buf.size(), 0);
+            if (size <= 0)  break;
+            sendAll(srv, {buf.data(), static_cast<std::size_t>(size)});
+            for (ssize_t i=0; i<size; i++) {
+                if (framer.push(buf[i], packet)) {
+                    file << packet.size() << ' ' << packet << '\n';
+                    count++;
+                }
+            }
+        }
+        if (fds[1].revents & (POLLIN | POLLHUP)) {
+            const ssize_t size = ::recv(srv, buf.data(), buf.size(), 0);
+            if (size <= 0)  break;
+            sendAll(gdb, {buf.data(), static_cast<std::size_t>(size)});
+        }
+    }
+    ::close(gdb);
+    ::close(srv);
+    std::println("Recorded {} packets into {}.", count, filename);
+}
+
+////////////////////////////////////////
+// replay
+////////////////////////////////////////
+
+std::vector<std::string> load (const std::string& filename) {
+    std::ifstream file { filename, std::ios::binary };
+    if (!file)  throw std::runtime_error("can not open session file " + filename);
+    std::vector<std::string> session;
+    std::size_t size;
+    while (file >> size) {
+        file.get();  // separator
+        std::string packet (size, '\0');
+        file.read(packet.data(), size);
+        file.get();  // new line
+        session.push_back(std::move(packet));
+    }
+    return session;
+}
+
+class Client {
+    int         m_fd;
+    bool        m_ack = true;
+    Framer      m_framer;
+    std::string m_buf;
+    std::size_t m_pos = 0;
+public:
+    Client (const std::string& server) : m_fd(connectTo(server)) { };
+    ~Client () { ::close(m_fd); };
+
+    // receive one packet (acknowledged in ack mode)
+    std::string rx () {
+        std::string packet;
+        for (;;) {
+            while (m_pos < m_buf.size()) {
+                if (m_framer.push(m_buf[m_pos++], packet)) {
+                    if (m_ack)  sendAll(m_fd, "+");
+                    return packet;
+                }
+            }
+            std::array<char, 4096> buf;
+            const ssize_t size = ::recv(m_fd, buf.data(), buf.size(), 0);
+            if (size <= 0)  throw std::runtime_error("server closed the connection");
+            m_buf.assign(buf.data(), size);
+            m_pos = 0;
+        }
+    }
+
+    // send packet and wait for the final reply (console output packets are skipped)
+    std::string exchange (std::string_view packet) {
+        sendAll(m_fd, frame(packet));
+        // kill has no reply
+        if (packet == "k")  return "";
+        std::string reply;
+        do {
+            reply = rx();
+        } while (reply.size() > 1 && reply[0] == 'O' && reply != "OK" &&
+                 reply.find_first_not_of("0123456789abcdefABCDEF", 1) == std::string::npos);
+        if (packet == "QStartNoAckMode" && reply == "OK")  m_ack = false;
+        return reply;
+    }
+};
+
+void replay (const std::string& server, const std::string& filename, const std::size_t repeat, const bool json) {
+    const auto session { load(filename) };
+    std::map<std::string, std::vector<double>> latency;  // microseconds
+
+    // hdldb accepts a single connection, so repeats share it
+    // (detach/kill are only sent at the end of the last repeat)
+    const auto start { Clock::now() };
+    Client client { server };
+    for (std::size_t r=0; r<repeat; r++) {
+        for (const auto& packet : session) {
+            const bool last = (packet == "k") || (packet[0] == 'D');
+            if (last && (r+1 < repeat))  break;
+            const auto t0 { Clock::now() };
+            client.exchange(packet);
+            const auto t1 { Clock::now() };
+            latency[packetType(packet)].push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+            if (last)  break;
+        }
+    }
+    const double wall = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    auto percentile = [](const std::vector<double>& v, const double p) {
+        return v[std::min(v.size() - 1, static_cast<std::size_t>(p * v.size()))];
+    };
+    if (json) {
+        std::println("{{");
+        std::println("  \"session\": \"{}\", \"repeat\": {}, \"wall_ms\": {:.3f},", filename, repeat, wall);
+        std::println("  \"packets\": [");
+    } else {
+        std::println("{:<24} {:>8} {:>10} {:>10} {:>10} {:>10}", "type", "count", "p50 [us]", "p99 [us]", "p999 [us]", "max [us]");
+    }
+    std::size_t n = 0;
+    for (auto& [type, v] : latency) {
+        std::ranges::sort(v);
+        if (json) {
+            std::println("    {{\"type\": \"{}\", \"count\": {}, \"p50_us\": {:.3f}, \"p99_us\": {:.3f}, \"p999_us\": {:.3f}, \"max_us\": {:.3f}}}{}",
+                type, v.size(), percentile(v, 0.5), percentile(v, 0.99), percentile(v, 0.999), v.back(), (++n < latency.size()) ? "," : "");
+        } else {
+            std::println("{:<24} {:>8} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}",
+                type, v.size(), percentile(v, 0.5), percentile(v, 0.99), percentile(v, 0.999), v.back());
+        }
+    }
+    if (json) {
+        std::println("  ]");
+        std::println("}}");
+    } else {
+        std::println("session wall time {:.3f} ms ({} replays)", wall, repeat);
+    }
+}
+
+int main (int argc, char* argv[]) {
+    cxxopts::Options options("rsp-replay", "Record a GDB RSP session and replay it measuring packet latency.");
+    options.add_options()
+        ("h,help", "Print help")
+        ("mode", "'record' or 'replay'", cxxopts::value<std::string>())
+        ("f,file", "Session file name", cxxopts::value<std::string>()->default_value("session.rsp"))
+        ("s,server", "Server UNIX socket path or TCP [host]:port", cxxopts::value<std::string>()->default_value("unix-socket"))
+        ("l,listen", "UNIX socket for GDB to connect to while recording", cxxopts::value<std::string>()->default_value("rsp-replay-socket"))
+        ("n,repeat", "Number of session replays", cxxopts::value<std::size_t>()->default_value("1"))
+        ("j,json", "JSON output", cxxopts::value<bool>()->default_value("false"))
+    ;
+    options.parse_positional({"mode"});
+
+    // a server closing the connection is reported as a send error
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        auto result { options.parse(argc, argv) };
+        if (result.count("help") || !result.count("mode")) {
+            std::print("{}", options.help());
+            return 0;
+        }
+        const std::string mode { result["mode"].as<std::string>() };
+        if (mode == "record") {
+            record(result["listen"].as<std::string>(), result["server"].as<std::string>(), result["file"].as<std::string>());
+        } else if (mode == "replay") {
+            replay(result["server"].as<std::string>(), result["file"].as<std::string>(), result["repeat"].as<std::size_t>(), result["json"].as<bool>());
+        } else {
+            std::cerr << "Unknown mode '" << mode << "'." << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// HDLDB trace importer (Spike commit logs, RVFI-DII execution packets, waveforms)
+//
+// Copyright 2025 Iztok Jeras <iztok.jeras@gmail.com>
+//
+// Licensed under CERN-OHL-P v2 or later
+///////////////////////////////////////////////////////////////////////////////
+
+// C++ includes
+#include <print>
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+// C++ libraries
+#include <cxxopts.hpp>
+
+// HDLDB includes
+#include <hdldb.hpp>
+#include <Import.hpp>
+#include <Waveform.hpp>
+
+int main (int argc, char* argv[]) {
+    cxxopts::Options options("trace-import", "Convert retirement logs into the HDLDB trace format.");
+    options.add_options()
+        ("h,help", "Print help")
+        ("f,format", "Input format 'spike' (commit log), 'rvfi' (RVFI-DII execution packets), 'vcd' or 'fst' (waveform)", cxxopts::value<std::string>()->default_value("spike"))
+        ("i,input", "Input file name", cxxopts::value<std::string>())
+        ("o,output", "HDLDB trace output file name", cxxopts::value<std::string>())
+        ("n,harts", "Number of harts", cxxopts::value<std::size_t>()->default_value("1"))
+        ("s,scope", "Waveform scope of retirement interface signals", cxxopts::value<std::string>()->default_value(""))
+        ("m,map", "Waveform signal mapping 'key=name,...' (keys: clock, valid, pc_rdata, pc_wdata, insn, trap, rd_addr, rd_wdata, mem_addr, mem_rmask, mem_wmask, mem_rdata, mem_wdata)", cxxopts::value<std::string>()->default_value(""))
+        ("j,threads", "Parser threads", cxxopts::value<unsigned>()->default_value(std::to_string(std::thread::hardware_concurrency())))
+    ;
+
+    try {
+        auto result { options.parse(argc, argv) };
+        if (result.count("help") || !result.count("input") || !result.count("output")) {
+            std::print("{}", options.help());
+            return 0;
+        }
+        const std::string format { result["format"].as<std::string>() };
+        const std::string input  { result["input" ].as<std::string>() };
+        trace::WaveMap map;
+        map.scope = result["scope"].as<std::string>();
+        if (!result["map"].as<std::string>().empty())  map.set(result["map"].as<std::string>());
+
+        const auto start { std::chrono::steady_clock::now() };
+        SystemHdlDb shadow { result["harts"].as<std::size_t>() };
+        std::size_t num = 0;
+        std::size_t logged;
+        {
+            trace::Importer<XlenHdlDb, FlenHdlDb, VlenHdlDb, SystemHdlDb> importer { result["output"].as<std::string>(), shadow };
+            auto consume = [&](trace::Imported<XlenHdlDb, FlenHdlDb, VlenHdlDb>&& imp) {
+                importer.push(std::move(imp));
+                num++;
+            };
+            if (format == "spike") {
+                trace::readSpike<XlenHdlDb, FlenHdlDb, VlenHdlDb>(input, result["threads"].as<unsigned>(), consume);
+            } else if (format == "rvfi") {
+                trace::readRvfi<XlenHdlDb, FlenHdlDb, VlenHdlDb>(input, consume);
+            } else if (format == "vcd") {
+                trace::readVcd<XlenHdlDb, FlenHdlDb, VlenHdlDb>(input, map, result["threads"].as<unsigned>(), consume);
+#ifdef HDLDB_FST
+            } else if (format == "fst") {
+                trace::readFst<XlenHdlDb, FlenHdlDb, VlenHdlDb>(input, map, consume);
+#endif
+            } else {
+                std::cerr << "Unknown input format '" << format << "'." << std::endl;
+                return 1;
+            }
+            importer.finish();
+            logged = importer.writer().logged();
+        }
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::println("Imported {} instructions ({} logged records) in {:.3f} s.", num, logged, sec);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}